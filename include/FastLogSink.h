@@ -0,0 +1,158 @@
+#ifndef FAST_LOG_SINK_H
+#define FAST_LOG_SINK_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <freertos/FreeRTOS.h>
+
+// Configuration - modify these as needed
+#define FAST_SYSLOG_MAX_SINKS 4            // Sinks of the dispatcher, the UDP sink included
+#ifndef FAST_SYSLOG_BACKLOG_SIZE
+#define FAST_SYSLOG_BACKLOG_SIZE 8192      // Bytes of the backlog that catches up lagging sinks, power of 2, 0 = off
+#endif
+#ifndef FAST_SYSLOG_SERIAL_SINK
+#define FAST_SYSLOG_SERIAL_SINK 0          // main.cpp adds a FastLogSerialSink on Serial, see platformio.ini
+#endif
+#define FAST_SYSLOG_SERIAL_TX_BUFFER 4096  // TX buffer of Serial with the serial sink
+#define FAST_SYSLOG_SERIAL_FORMATS 128     // Format strings a serial sink remembers as sent, power of 2
+#define FAST_SYSLOG_SERIAL_ANNOUNCE_MS 30000 // Formats and schemas are sent again this often for a decoder started late
+#define FAST_SYSLOG_SERIAL_READY_BYTES 128   // Free bytes of the port before a serial sink takes entries again
+
+// A record as the syslog task hands it to the sinks. message is only valid during the call.
+struct FastLogEntry {
+    uint32_t sequence;    // Records dispatched since boot, a gap in a capture is a lost record
+    uint32_t ms;          // Uptime when the syslog task took the record
+    uint8_t priority;
+    uint8_t event;        // Event record: FastLogEventId + 1, 0 otherwise
+    uint16_t length;      // Bytes of message
+    const char* format;   // Deferred record: format string literal, nullptr otherwise
+    const char* message;  // Text with terminator, or packed arguments of a deferred or event record
+};
+
+// Destination of the records. Every sink is called by the syslog task only, a slow sink delays the others but never
+// a producer. A sink that cannot take an entry returns false and is caught up from the backlog once ready() again.
+class FastLogSink {
+public:
+    virtual ~FastLogSink() {}
+    virtual bool write(const FastLogEntry& entry) = 0;
+    virtual bool ready() { return true; }
+    // Send what is buffered and due at now, returns the ticks until the next flush is due
+    virtual TickType_t flush(TickType_t /*now*/) { return portMAX_DELAY; }
+};
+
+// RFC 5424 records with octet-counted framing (RFC 6587), several per datagram. Not ready while WiFi is down.
+class FastLogUdpSink : public FastLogSink {
+public:
+    FastLogUdpSink();
+    bool begin(const char* server, uint16_t port, const char* hostname, const char* appName);
+    void setServer(const char* server, uint16_t port);
+    void end();
+
+    bool write(const FastLogEntry& entry) override;
+    bool ready() override;
+    TickType_t flush(TickType_t now) override;
+
+    uint32_t getDatagramsSent() { return datagramsSent; }
+    uint32_t getRecordsSent() { return recordsSent; }
+
+private:
+    // Append a record to the datagram, a full datagram is sent first. text may be empty if data is given.
+    void appendRecord(uint8_t priority, const char* text, const char* msgId = "-", const char* data = "-");
+    void flushBatch();
+
+    WiFiUDP* udpClient;
+    const char* server;
+    uint16_t port;
+    const char* hostname;
+    const char* appName;
+    char* batch;                 // Datagram being filled
+    size_t batchLength;
+    TickType_t batchStart;       // Tick of the first record in batch
+    uint32_t datagramsSent;
+    uint32_t recordsSent;
+};
+
+// Compact binary frames for a UART or the USB CDC port, decoded on the host by scripts/serial_log_decode.py.
+// Deferred and event records are sent packed, their format strings and schemas once in FORMAT and SCHEMA frames.
+// Frames can share the port with Serial.print() text, the decoder passes the bytes between frames through.
+//
+//   0xFE 0xFA | kind << 4 | priority | length | payload | CRC-16/CCITT-FALSE of kind, length and payload
+//
+// length is one byte below 0x80, else two bytes big endian with bit 15 set. Integers of the payload are little endian:
+//   BOOT     1  version u8, pointer size u8, app name
+//   TEXT     2  sequence u16, ms u32, text
+//   DEFERRED 3  sequence u16, ms u32, format id u32, packed arguments (FastLogArgs)
+//   EVENT    4  sequence u16, ms u32, event u8, packed fields
+//   FORMAT   5  format id u32, format string
+//   SCHEMA   6  event u8, name, 0, field names separated by spaces
+// A frame is only written if the port has room for it, write() never blocks on a busy or unconnected port.
+class FastLogSerialSink : public FastLogSink {
+public:
+    enum Kind : uint8_t {
+        BOOT = 1,
+        TEXT,
+        DEFERRED,
+        EVENT,
+        FORMAT,
+        SCHEMA,
+    };
+    static const uint8_t VERSION = 1;
+
+    explicit FastLogSerialSink(Print& port, const char* appName = "FastApp");
+
+    bool write(const FastLogEntry& entry) override;
+    bool ready() override;
+
+    uint32_t getFramesSent() { return framesSent; }
+
+private:
+    size_t appendFrame(uint8_t* out, uint8_t kind, const uint8_t* payload, size_t length);
+    bool announced(uint32_t formatId, bool remember);
+
+    Print& port;
+    const char* appName;
+    uint32_t formats[FAST_SYSLOG_SERIAL_FORMATS];  // Format ids already sent, 0 is free
+    uint32_t schemas;                              // Bit per event whose schema was sent
+    bool booted;                                   // BOOT frame sent
+    TickType_t announceStart;                      // Forget what was sent at FAST_SYSLOG_SERIAL_ANNOUNCE_MS
+    uint32_t framesSent;
+};
+
+// The most recent entries in a byte ring, the oldest are overwritten. The dispatcher keeps one as backlog and replays
+// it to a sink that fell behind, so records are not lost while WiFi is down.
+class FastLogMemorySink : public FastLogSink {
+public:
+    explicit FastLogMemorySink(size_t capacity);
+    bool begin();
+    void end();
+
+    bool write(const FastLogEntry& entry) override;
+
+    // Write the entries from sequence on to sink, stops at the first one it does not take. Returns the sequence the
+    // sink needs next, lost counts the entries that were already overwritten.
+    uint32_t replay(FastLogSink& sink, uint32_t sequence, uint32_t& lost);
+    uint32_t entries() { return nextSequence - firstSequence; }
+
+private:
+    struct Header {
+        uint32_t sequence;
+        uint32_t ms;
+        uint8_t priority;
+        uint8_t event;
+        uint16_t length;
+        const char* format;
+    };
+
+    void copyIn(uint32_t position, const void* data, size_t length);
+    void copyOut(uint32_t position, void* data, size_t length);
+    static uint32_t sizeOf(size_t length) { return (sizeof(Header) + length + 3) & ~3u; }
+
+    size_t capacity;
+    char* ring;
+    uint32_t head;           // Position of the oldest entry
+    uint32_t tail;           // Position of the next entry
+    uint32_t firstSequence;  // Sequence of the entry at head
+    uint32_t nextSequence;   // Sequence after the newest entry
+};
+
+#endif // FAST_LOG_SINK_H
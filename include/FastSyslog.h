@@ -7,14 +7,34 @@
 #include <WiFi.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <atomic>
+#include <type_traits>
+#include "FastLogSink.h"
 
 // Configuration - modify these as needed
-#define FAST_SYSLOG_BUFFER_SIZE 64    // Must be power of 2
-#define FAST_SYSLOG_MESSAGE_SIZE 128  // Max message length
-#define FAST_SYSLOG_BUFFER_MASK (FAST_SYSLOG_BUFFER_SIZE - 1)
-#define FAST_SYSLOG_TASK_STACK_SIZE 2048
+#define FAST_SYSLOG_ARENA_SIZE 8192   // Bytes of the record ring, must be power of 2
+#define FAST_SYSLOG_ARENA_MASK (FAST_SYSLOG_ARENA_SIZE - 1)
+#define FAST_SYSLOG_MESSAGE_SIZE 256  // Max message length, a record only takes the bytes it uses
+#define FAST_SYSLOG_RECORD_ALIGN 8    // Records start at multiples of this, the low bits of a position are state flags
+#define FAST_SYSLOG_TASK_STACK_SIZE 5120
 #define FAST_SYSLOG_TASK_PRIORITY 1
 #define FAST_SYSLOG_TASK_CORE 0       // Run on core 0 (opposite of main)
+#define FAST_SYSLOG_BATCH_DELAY_MS 1   // After a wakeup the task waits this long so a burst is drained in one batch
+#define FAST_SYSLOG_DATAGRAM_SIZE 1400 // Max UDP payload, records are packed up to this size (below the WiFi MTU)
+#define FAST_SYSLOG_FLUSH_MS 200       // A datagram that is not full is sent this long after its first record
+#define FAST_SYSLOG_FACILITY 0         // Facility of the records (kern, as the Syslog library sent them)
+#define FAST_SYSLOG_DROP_REPORT_MS 5000 // Dropped messages are reported in one record at most this often
+#ifndef FAST_SYSLOG_DROP_POLICY
+#define FAST_SYSLOG_DROP_POLICY FastSyslog::DropPolicy::RESERVE_ERRORS  // What a full buffer drops, see DropPolicy
+#endif
+#define FAST_SYSLOG_RESERVED_BYTES 1024 // RESERVE_ERRORS: free bytes only ERR and above may take
+#ifndef FAST_SYSLOG_CRASH_RECORDS
+#define FAST_SYSLOG_CRASH_RECORDS 32   // Records kept in RTC memory across resets, power of 2, 0 = off
+#endif
+#define FAST_SYSLOG_CRASH_MESSAGE_SIZE 64  // Text or packed arguments kept per crash record
+#ifndef FAST_SYSLOG_TASK_STATS_INTERVAL_MS
+#define FAST_SYSLOG_TASK_STATS_INTERVAL_MS 0  // Period of logTaskStats() in wifi_loop, 0 = off
+#endif
 
 // Log level definitions (lower number = higher priority)
 #define FAST_SYSLOG_EMERG   0  // System is unusable
@@ -26,34 +46,249 @@
 #define FAST_SYSLOG_INFO    6  // Informational messages
 #define FAST_SYSLOG_DEBUG   7  // Debug-level messages
 
-// Max log level - define in main.cpp before including FastSyslog.h to filter logs
-// Example: #define FAST_SYSLOG_MAX_LEVEL FAST_SYSLOG_INFO
-// Only logs with priority <= FAST_SYSLOG_MAX_LEVEL will be sent
+// Max log level - set in build_flags of platformio.ini so every file uses the same ceiling
+// Example: -D FAST_SYSLOG_MAX_LEVEL=FAST_SYSLOG_INFO
+// Logs with priority > FAST_SYSLOG_MAX_LEVEL are removed at compile time, the rest is filtered by the module levels
 #ifndef FAST_SYSLOG_MAX_LEVEL
 #define FAST_SYSLOG_MAX_LEVEL FAST_SYSLOG_DEBUG  // Default: all logs enabled
 #endif
+#ifndef FAST_SYSLOG_DEFAULT_LEVEL
+#define FAST_SYSLOG_DEFAULT_LEVEL FAST_SYSLOG_ERR  // Runtime level of a module that was never set
+#endif
+#ifndef FAST_SYSLOG_EVENT_LEVEL
+#define FAST_SYSLOG_EVENT_LEVEL FAST_SYSLOG_INFO  // Runtime level of the events module while it was never set
+#endif
+#define FAST_SYSLOG_LEVELS_NAMESPACE "loglevels"   // NVS namespace of the module levels
+#ifndef FAST_SYSLOG_SD_ENTERPRISE
+#define FAST_SYSLOG_SD_ENTERPRISE 32473  // Private enterprise number of the event SD-IDs, 32473 is the documentation one
+#endif
+
+// Modules with their own runtime log level. A file sets its module before including FastSyslog.h:
+// #define FAST_SYSLOG_MODULE FAST_LOG_MODULE_MDB
+enum FastLogModule : uint8_t {
+    FAST_LOG_MODULE_APP,     // Everything else
+    FAST_LOG_MODULE_MDB,
+    FAST_LOG_MODULE_READER,
+    FAST_LOG_MODULE_API,
+    FAST_LOG_MODULE_OTA,
+    FAST_LOG_MODULE_EVENTS,  // FAST_LOG_EVENT, whatever module the file belongs to
+    FAST_LOG_MODULE_COUNT
+};
+#ifndef FAST_SYSLOG_MODULE
+#define FAST_SYSLOG_MODULE FAST_LOG_MODULE_APP
+#endif
+
+// Structured events, sent with the event name as MSGID and the fields as RFC 5424 structured data so the backend reads
+// them without parsing text. ms is the uptime when the event was logged:
+//   <14>1 - ESP32 cashless - vend_request [vend_request@32473 ms="81234" price="150" item="3"]
+// EVENT(name, priority, fields) with FIELD(type, name) per field. The list generates the event ids, a struct with the
+// typed fields of each event and the field names the syslog task prints, see FAST_LOG_EVENT.
+#define FAST_LOG_EVENTS(EVENT, FIELD) \
+    EVENT(vend_request,     FAST_SYSLOG_INFO, FIELD(uint16_t, price) FIELD(uint16_t, item)) \
+    EVENT(vend_cancel,      FAST_SYSLOG_INFO, ) \
+    EVENT(vend_success,     FAST_SYSLOG_INFO, FIELD(uint16_t, item)) \
+    EVENT(vend_failure,     FAST_SYSLOG_INFO, ) \
+    EVENT(session_complete, FAST_SYSLOG_INFO, ) \
+    EVENT(cash_sale,        FAST_SYSLOG_INFO, FIELD(uint16_t, price) FIELD(uint16_t, item))
+
+#define FAST_LOG_EVENT_ID(event, priority, fields) FAST_LOG_EVENT_##event,
+enum FastLogEventId : uint8_t {
+    FAST_LOG_EVENTS(FAST_LOG_EVENT_ID, )
+    FAST_LOG_EVENT_COUNT
+};
+#undef FAST_LOG_EVENT_ID
+
+// Schema of an event, fields are the names of the packed values separated by spaces
+struct FastLogEventSchema {
+    const char* name;
+    const char* fields;
+};
 
-// Log message structure
-struct FastLogMessage {
-    char message[FAST_SYSLOG_MESSAGE_SIZE];
+// Record of the ring, a header followed by the message and rounded up to FAST_SYSLOG_RECORD_ALIGN.
+// Positions are byte offsets counted since begin(), state tells who owns the record at position:
+//  - position | RECORD_PUBLISHED: published, the consumer may read it
+//  - position | RECORD_RELEASED:  read, its bytes are free once every older record is released
+//  - anything else:               being written by the producer that reserved position
+// Released records are zeroed behind the header, a stale state has bit 0 clear and never looks published.
+struct FastLogRecord {
+    std::atomic<uint32_t> state;
+    uint16_t size;       // Bytes of the record including the header
+    uint16_t length;     // Bytes of message: text with terminator or packed arguments, RECORD_PADDING at the arena end
     uint8_t priority;
-    volatile bool ready;
+    uint8_t event;       // Event record: FastLogEventId + 1 and packed fields in message, 0 otherwise
+    const char* format;  // Deferred record: format string literal, nullptr for a text message
+    char message[];
 };
 
+// Record of the crash log, a copy of the message truncated to FAST_SYSLOG_CRASH_MESSAGE_SIZE.
+// sequence is the persist count + 1 once the record is complete, 0 while it is written.
+struct FastCrashRecord {
+    uint32_t sequence;
+    uint8_t priority;
+    uint8_t length;      // Deferred record: bytes of packed arguments, 0 if they did not fit
+    uint8_t event;       // Event record: FastLogEventId + 1, 0 otherwise
+    const char* format;  // Deferred record: format string literal, nullptr for a text message
+    char message[FAST_SYSLOG_CRASH_MESSAGE_SIZE];
+};
+
+// Argument packing of deferred records (logDeferred()). Every argument is stored as a tag byte and its value after the
+// default promotions of printf, strings are copied because they may not outlive the call.
+namespace FastLogArgs {
+    enum Tag : uint8_t {
+        INT,     // int64_t
+        UINT,    // uint64_t
+        DOUBLE,
+        STRING,  // Length byte and characters
+        POINTER,
+        INT32,   // int32_t, integers up to 32 bits take half the bytes
+        UINT32,  // uint32_t
+    };
+
+    inline bool put(char* buffer, size_t& length, Tag tag, const void* value, size_t size) {
+        if (length + 1 + size > FAST_SYSLOG_MESSAGE_SIZE) return false;
+        buffer[length++] = tag;
+        memcpy(buffer + length, value, size);
+        length += size;
+        return true;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, bool>::type
+    pack(char* buffer, size_t& length, T value) {
+        if (sizeof(T) <= sizeof(int32_t)) {
+            int32_t v = value;
+            return put(buffer, length, INT32, &v, sizeof(v));
+        }
+        int64_t v = value;
+        return put(buffer, length, INT, &v, sizeof(v));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, bool>::type
+    pack(char* buffer, size_t& length, T value) {
+        if (sizeof(T) <= sizeof(uint32_t)) {
+            uint32_t v = value;
+            return put(buffer, length, UINT32, &v, sizeof(v));
+        }
+        uint64_t v = value;
+        return put(buffer, length, UINT, &v, sizeof(v));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value, bool>::type
+    pack(char* buffer, size_t& length, T value) {
+        return pack(buffer, length, (typename std::underlying_type<T>::type)value);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+    pack(char* buffer, size_t& length, T value) {
+        double v = value;
+        return put(buffer, length, DOUBLE, &v, sizeof(v));
+    }
+
+    inline bool pack(char* buffer, size_t& length, const char* value) {
+        if (!value) value = "(null)";
+        size_t size = strnlen(value, 255);
+        if (length + 2 + size > FAST_SYSLOG_MESSAGE_SIZE) return false;
+        buffer[length++] = STRING;
+        buffer[length++] = (char)size;
+        memcpy(buffer + length, value, size);
+        length += size;
+        return true;
+    }
+
+    inline bool pack(char* buffer, size_t& length, char* value) {
+        return pack(buffer, length, (const char*)value);
+    }
+
+    template <typename T>
+    bool pack(char* buffer, size_t& length, const T* value) {
+        const void* v = value;
+        return put(buffer, length, POINTER, &v, sizeof(v));
+    }
+
+    inline bool packAll(char* /*buffer*/, size_t& /*length*/) {
+        return true;
+    }
+
+    template <typename T, typename... Rest>
+    bool packAll(char* buffer, size_t& length, const T& value, const Rest&... rest) {
+        return pack(buffer, length, value) && packAll(buffer, length, rest...);
+    }
+}
+
+// A struct per event with its typed fields, FAST_LOG_EVENT brace-initializes it so an argument that does not fit its
+// field is a compile error. packEvent() copies the fields like the arguments of a deferred record.
+#define FAST_LOG_EVENT_MEMBER(type, name) type name;
+#define FAST_LOG_EVENT_STRUCT(event, priority_val, fields) \
+    struct FastLogEvent_##event { \
+        static const uint8_t id = FAST_LOG_EVENT_##event; \
+        static const uint8_t priority = priority_val; \
+        fields \
+    };
+FAST_LOG_EVENTS(FAST_LOG_EVENT_STRUCT, FAST_LOG_EVENT_MEMBER)
+#undef FAST_LOG_EVENT_STRUCT
+#undef FAST_LOG_EVENT_MEMBER
+
+namespace FastLogArgs {
+#define FAST_LOG_EVENT_FIELD(type, name) && pack(buffer, length, value.name)
+#define FAST_LOG_EVENT_PACK(event, priority_val, fields) \
+    inline bool packEvent(char* buffer, size_t& length, const FastLogEvent_##event& value) { \
+        (void)buffer, (void)length, (void)value; /* Unused by an event without fields */ \
+        return true fields; \
+    }
+FAST_LOG_EVENTS(FAST_LOG_EVENT_PACK, FAST_LOG_EVENT_FIELD)
+#undef FAST_LOG_EVENT_PACK
+#undef FAST_LOG_EVENT_FIELD
+}
+
+// Never called, lets the compiler check the arguments of FAST_LOGD against the format
+inline void fastLogFormatCheck(const char* format, ...) __attribute__((format(printf, 1, 2)));
+inline void fastLogFormatCheck(const char* /*format*/, ...) {}
+
 class FastSyslog {
 public:
-    // Ring buffer (public for macro access)
-    FastLogMessage* logBuffer;
-    volatile uint32_t writeIndex;
-    volatile uint32_t readIndex;
+    // What a producer does when the buffer is full. Every lost message is counted with its priority and reported.
+    enum class DropPolicy : uint8_t {
+        DROP_NEWEST,      // The new message is dropped
+        OVERWRITE_OLDEST, // The oldest message is dropped, unless it is more severe than the new one
+        RESERVE_ERRORS,   // Like DROP_NEWEST, but the last FAST_SYSLOG_RESERVED_BYTES are kept for ERR and above
+    };
 
 private:
+    // Record ring: producers on both cores reserve bytes with a CAS on writeIndex, readers claim records with a CAS on
+    // readIndex, freeIndex follows the released records in order
+    static const uint32_t RECORD_PUBLISHED = 1;
+    static const uint32_t RECORD_RELEASED = 2;
+    static const uint16_t RECORD_PADDING = 0xFFFF;
+    char* logBuffer;
+    std::atomic<uint32_t> writeIndex;
+    std::atomic<uint32_t> readIndex;
+    std::atomic<uint32_t> freeIndex;
+    std::atomic<uint32_t> droppedMessages[8];  // Messages lost to a full buffer, by priority
+    uint32_t reportedDropsByPriority[8];       // droppedMessages at the last report, syslog task only
+    uint32_t reportedDrops;
+    DropPolicy dropPolicy;
+    std::atomic<bool> consumerIdle;         // The syslog task waits for a notification
+    uint32_t consumerWakeups;               // Notifications the syslog task woke up for
+    uint32_t consumerAwakeUs;               // Time the syslog task spent outside its waits, wraps after 71 minutes
+
     // FreeRTOS task
     TaskHandle_t syslogTaskHandle;
     
-    // Syslog instance
-    WiFiUDP* udpClient;
-    Syslog* syslog;
+    // Dispatcher: every record goes to the backlog and to each sink. sinkNext is the sequence a sink needs next, a
+    // sink that did not take a record falls behind and gets the records it missed from the backlog.
+    FastLogUdpSink udpSink;
+    FastLogMemorySink backlog;
+    FastLogSink* sinks[FAST_SYSLOG_MAX_SINKS];
+    uint32_t sinkNext[FAST_SYSLOG_MAX_SINKS];
+    std::atomic<uint8_t> sinkCount;
+    uint32_t dispatchSequence;   // Records dispatched since begin()
+    uint32_t sinkLost;           // Records a lagging sink missed because the backlog had overwritten them
+
+    // Runtime levels, a byte per module so the check in the macros is one load and one branch
+    std::atomic<uint8_t> levels[FAST_LOG_MODULE_COUNT];
     
     // Task function (static wrapper)
     static void syslogTaskWrapper(void* parameter);
@@ -61,8 +296,39 @@ private:
     // Actual task implementation
     void syslogTask();
     
-    // Internal fast log implementation
-    void internalFastLog(const char* message, uint8_t priority);
+    // Internal fast log implementation, persist copies the message to the crash log
+    void internalFastLog(const char* message, uint8_t priority, bool persist = true);
+
+    // Crash log: the last FAST_SYSLOG_CRASH_RECORDS messages in RTC memory, which keeps its content across every reset
+    // but power-on. The records of the previous boot are taken out by the first begin() and sent after its reset reason.
+    void persistRecord(const FastLogRecord* record);
+    void recoverCrashLog();
+    void shipCrashLog();
+    std::atomic<uint32_t> crashIndex;  // Messages persisted since begin()
+    FastCrashRecord* crashRecords;  // Records of the previous boot, oldest first, until shipCrashLog()
+    uint8_t crashRecordCount;
+    bool crashSameImage;            // Same firmware, the format pointers of deferred records are valid
+
+    void dispatch(FastLogEntry& entry);
+    bool catchUp(uint8_t sink);
+    void reportDrops();
+
+    static const char formatTooLong[];
+    static const FastLogEventSchema events[FAST_LOG_EVENT_COUNT];
+
+    FastLogRecord* recordAt(uint32_t position) {
+        return reinterpret_cast<FastLogRecord*>(logBuffer + (position & FAST_SYSLOG_ARENA_MASK));
+    }
+    // Reserve a record for length bytes of message, nullptr if the message is dropped
+    FastLogRecord* reserve(uint32_t& position, size_t length, uint8_t priority);
+    // Hand a filled record to the consumer and wake it up if it sleeps
+    void publish(FastLogRecord* record, uint32_t position);
+    // Take the oldest published record, nullptr if there is none, and free its bytes after reading it
+    FastLogRecord* claim(uint32_t& position);
+    void release(FastLogRecord* record, uint32_t position);
+    bool discardOldest(uint8_t priority);
+    // Copy packed arguments into a record, for deferred and event records
+    void logPacked(uint8_t priority, const char* format, uint8_t event, const char* packed, size_t length);
 
 public:
     // Constructor
@@ -82,29 +348,110 @@ public:
     // Fast logging functions
     void log(const char* message, uint8_t priority = 6);  // Default to INFO level
     void logf(uint8_t priority, const char* format, ...);
+
+    // Deferred formatting: only the format pointer and the packed arguments are copied into the ring, the syslog task
+    // formats the message. Use FAST_LOGD, it checks the arguments and that format is a literal that stays valid.
+    template <typename... Args>
+    void logDeferred(uint8_t priority, const char* format, const Args&... args) {
+        if (!logBuffer || priority > FAST_SYSLOG_MAX_LEVEL) return;
+
+        char packed[FAST_SYSLOG_MESSAGE_SIZE];
+        size_t length = 0;
+        if (!FastLogArgs::packAll(packed, length, args...)) {
+            // Arguments do not fit a record, the format is sent as is
+            length = 0;
+            format = formatTooLong;
+        }
+        logPacked(priority, format, 0, packed, length);
+    }
+
+    // Structured event, the fields are packed like deferred arguments after the uptime. Use FAST_LOG_EVENT.
+    template <typename Event>
+    void logEvent(const Event& event) {
+        if (!logBuffer || Event::priority > FAST_SYSLOG_MAX_LEVEL) return;
+
+        char packed[FAST_SYSLOG_MESSAGE_SIZE];
+        size_t length = 0;
+        if (!FastLogArgs::pack(packed, length, (uint32_t)millis()) || !FastLogArgs::packEvent(packed, length, event)) {
+            length = 0;
+        }
+        logPacked(Event::priority, nullptr, Event::id + 1, packed, length);
+    }
+
+    // Format a deferred record like snprintf(), returns the length of the text
+    static size_t formatDeferred(char* text, size_t size, const char* format, const char* args, size_t length);
+    // Format the fields of an event as an RFC 5424 SD-ELEMENT, returns the length of the text
+    static size_t formatEvent(char* text, size_t size, uint8_t event, const char* args, size_t length);
+    static const char* eventName(uint8_t event) { return events[event].name; }
+    static const char* eventFields(uint8_t event) { return events[event].fields; }
+
+    // Another destination for the records, e.g. a FastLogSerialSink. It gets the records from now on.
+    bool addSink(FastLogSink* sink);
     
-    // Get buffer statistics
+    // Get buffer statistics, usage is in bytes of FAST_SYSLOG_ARENA_SIZE
     uint32_t getBufferUsage();
     uint32_t getDroppedMessages();
+    uint32_t getDroppedMessages(uint8_t priority);
     bool isBufferFull();
+    void setDropPolicy(DropPolicy policy) { dropPolicy = policy; }
+    uint32_t getConsumerWakeups() { return consumerWakeups; }
+    uint32_t getConsumerAwakeUs() { return consumerAwakeUs; }
+    uint32_t getDatagramsSent() { return udpSink.getDatagramsSent(); }
+    uint32_t getRecordsSent() { return udpSink.getRecordsSent(); }
+    uint32_t getSinkLost() { return sinkLost; }
+
+    // Runtime level of a module, messages with priority > level are dropped before they reach the ring
+    uint8_t level(uint8_t module) const { return levels[module].load(std::memory_order_relaxed); }
+    bool loadLevels();                              // Levels stored in NVS, call once at boot
+    bool setLevel(uint8_t module, uint8_t level);   // Changes and stores the level of a module
+    static const char* moduleName(uint8_t module);  // NVS key and name in the backend, nullptr if unknown
+    static uint8_t defaultLevel(uint8_t module);    // Level of a module that was never set
+
+    // Log the wakeups and awake time of the syslog task, with CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS also the CPU
+    // time of every task since boot
+    void logTaskStats();
 };
 
 // Global instance (optional - you can create your own)
 extern FastSyslog fastSyslog;
 
+// Levels above FAST_SYSLOG_MAX_LEVEL are removed at compile time, the runtime level of the module of the file costs
+// a byte load and a branch
+#define FAST_LOG_ENABLED(priority_val) \
+    ((priority_val) <= FAST_SYSLOG_MAX_LEVEL && (priority_val) <= fastSyslog.level(FAST_SYSLOG_MODULE))
+
 // Ultra-fast macro for constant strings (uses global instance)
-// Now includes compile-time log level filtering
+// Takes the same lock-free path as log() and is truncated to FAST_SYSLOG_MESSAGE_SIZE
 #define FAST_LOG(msg, priority_val) do { \
-    if ((priority_val) <= FAST_SYSLOG_MAX_LEVEL) { \
-        uint32_t cw = fastSyslog.writeIndex; \
-        uint32_t nw = (cw + 1) & FAST_SYSLOG_BUFFER_MASK; \
-        if (nw != (fastSyslog.readIndex & FAST_SYSLOG_BUFFER_MASK)) { \
-            FastLogMessage* m = &fastSyslog.logBuffer[cw & FAST_SYSLOG_BUFFER_MASK]; \
-            strcpy(m->message, msg); \
-            m->priority = (uint8_t)(priority_val); \
-            m->ready = true; \
-            fastSyslog.writeIndex = nw; \
-        } \
+    if (FAST_LOG_ENABLED(priority_val)) { \
+        fastSyslog.log(msg, (uint8_t)(priority_val)); \
+    } \
+} while(0)
+
+// Formatted message, the arguments are only evaluated and formatted if the level is enabled
+#define FAST_LOGF(priority_val, format, ...) do { \
+    if (FAST_LOG_ENABLED(priority_val)) { \
+        fastSyslog.logf((uint8_t)(priority_val), format, ##__VA_ARGS__); \
+    } \
+} while(0)
+
+// Deferred formatting for time-critical tasks: costs a copy of the arguments instead of a vsnprintf.
+// format must be a string literal, arguments are integers, floating point numbers, strings or pointers.
+// A char* argument is copied as a string, %p prints its text and not its address.
+#define FAST_LOGD(priority_val, format, ...) do { \
+    if (FAST_LOG_ENABLED(priority_val)) { \
+        if (false) fastLogFormatCheck("" format "", ##__VA_ARGS__); \
+        fastSyslog.logDeferred((uint8_t)(priority_val), "" format "", ##__VA_ARGS__); \
+    } \
+} while(0)
+
+// Structured event of FAST_LOG_EVENTS, the arguments initialize the fields in their order:
+// FAST_LOG_EVENT(vend_request, price, item)
+// Events have a level of their own, FAST_SYSLOG_EVENT_LEVEL: the backend needs them also while the module logs errors
+#define FAST_LOG_EVENT(event, ...) do { \
+    if (FastLogEvent_##event::priority <= FAST_SYSLOG_MAX_LEVEL && \
+        FastLogEvent_##event::priority <= fastSyslog.level(FAST_LOG_MODULE_EVENTS)) { \
+        fastSyslog.logEvent(FastLogEvent_##event{ __VA_ARGS__ }); \
     } \
 } while(0)
 
@@ -2,6 +2,9 @@
 
 #include <Arduino.h>
 
+#define UID_CACHE_SYNC_INTERVAL_MS 300000 // Whitelist and blocklist sync with the backend every 5 minutes
+#define UID_CACHE_SYNC_MAX_PAGES 16       // Pages of changes per sync, the rest follows with the next sync
+
 // Function declarations for API communication
 void connectToWiFi();
 void resolveServerHostname();
@@ -11,6 +14,12 @@ int getUserBalance(const char* uid);
 int makePurchase(const char* uid, int amount, int product, const char* machine_id);
 int makeCashPurchase(int amount, int product, const char* machine_id);
 bool confirmPurchase(int transactionId);
+bool syncUidCache();
+bool syncBlocklist();
+bool syncLogLevels();
 
 // Cash sale handler task
 void cashsale_handler(void *pvParameters);
+
+// Whitelist, blocklist and log level sync task
+void uid_cache_sync_loop(void *pvParameters);
@@ -4,9 +4,13 @@
 #include "cardreader.h"
 #include "mdb_protocol.h"
 
+#define RF_STATS_INTERVAL 32 // Reads between two RF statistics reports of a reader, changes are reported at once
+
 // Function declarations for reader handling
 void formatUidString(const CardReader::Uid& uid, char* uidString, size_t maxLen);
-void waitForCardRemoval();
+void waitForCardRemoval(CardReader& reader);
+void logRfStats(const CardReader& reader);
+void logReaderHealth(const CardReader& reader);
 bool waitForMachineState(MACHINE_STATE targetState, uint32_t timeoutMs);
 void processCardTransaction(const char* uidString, const char* itemType);
 bool getAndVerifyBalance(const char* uidString);
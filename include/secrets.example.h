@@ -13,6 +13,15 @@
 #define SYSLOG_SERVER "YOUR_SYSLOG_SERVER_IP"
 #define SYSLOG_PORT 5140
 
+// Card Configuration
+// 16 byte 3DES master key, the Ultralight C key and the NTAG21x password/PACK of each card are diversified from it
+// and the card UID
+#define CARD_MASTER_KEY { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+                          0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
+// 16 byte AES master key, the DESFire wallet key of each badge is diversified from it, the UID and the AID (AN10922)
+#define DESFIRE_MASTER_KEY { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+                             0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
+
 // Machine Configuration
 #define MACHINE_ID "YOUR_MACHINE_ID"
 
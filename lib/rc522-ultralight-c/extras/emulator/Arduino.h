@@ -0,0 +1,83 @@
+/**
+ * Arduino.h - The part of the Arduino API used by the MFRC522 library, for host builds with the MFRC522Emulator.
+ * Time is simulated: millis(), micros() and delay() use the clock of the emulator.
+ */
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define LOW		0x0
+#define HIGH	0x1
+#define INPUT	0x01
+#define OUTPUT	0x03
+
+#ifndef SS
+#define SS 5
+#endif
+
+// Serial prints to stdout, set output to nullptr to silence it
+class HostSerial {
+public:
+	FILE *output;
+
+	HostSerial() : output(stdout) {}
+	void begin(unsigned long baud) { (void)baud; }
+	operator bool() const { return true; }
+
+	size_t print(const char *str);
+	size_t print(const __FlashStringHelper *str) { return print(reinterpret_cast<const char *>(str)); }
+	size_t print(char c);
+	size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+	size_t print(int value, int base = DEC) { return print((long)value, base); }
+	size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+	size_t print(long value, int base = DEC);
+	size_t print(unsigned long value, int base = DEC);
+	size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+	size_t println() { return print('\n'); }
+	template <typename T>
+	size_t println(T value) { return print(value) + println(); }
+	template <typename T>
+	size_t println(T value, int base) { return print(value, base) + println(); }
+};
+extern HostSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// The ESP32 core brings FreeRTOS with Arduino.h
+typedef uint32_t TickType_t;
+#define portTICK_PERIOD_MS 1
+void vTaskDelay(TickType_t ticks);
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * ArduinoHost.cpp - Implementation of the host Arduino.h, SPI.h and esp_system.h on top of the MFRC522Emulator.
+ * Released into the public domain.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <esp_system.h>
+#include <stdarg.h>
+#include "MFRC522Emulator.h"
+
+HostSerial Serial;
+SPIClass SPI;
+
+static byte pinLevels[256];
+static uint32_t randomState = 1;
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Serial
+/////////////////////////////////////////////////////////////////////////////////////
+
+size_t HostSerial::print(const char *str) {
+	if (!output) {
+		return 0;
+	}
+	fputs(str, output);
+	return strlen(str);
+}
+
+size_t HostSerial::print(char c) {
+	if (!output) {
+		return 0;
+	}
+	fputc(c, output);
+	return 1;
+}
+
+size_t HostSerial::print(long value, int base) {
+	if (value < 0 && base == DEC) {
+		return print('-') + print((unsigned long)-value, base);
+	}
+	return print((unsigned long)value, base);
+}
+
+size_t HostSerial::print(unsigned long value, int base) {
+	char buffer[8 * sizeof(long) + 1];
+	char *str = &buffer[sizeof(buffer) - 1];
+	*str = '\0';
+	do {
+		byte digit = value % base;
+		*--str = digit < 10 ? '0' + digit : 'A' + digit - 10;
+		value /= base;
+	} while (value);
+	return print(str);
+}
+
+size_t HostSerial::printf(const char *format, ...) {
+	if (!output) {
+		return 0;
+	}
+	va_list args;
+	va_start(args, format);
+	int written = vfprintf(output, format, args);
+	va_end(args);
+	return written > 0 ? written : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Time, pins and random numbers
+/////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long millis() {
+	return MFRC522Emulator::now() / 1000000;
+}
+
+unsigned long micros() {
+	return MFRC522Emulator::now() / 1000;
+}
+
+void delay(unsigned long ms) {
+	MFRC522Emulator::advance(ms * 1000000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+	MFRC522Emulator::advance(us * 1000ULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+	delay(ticks * portTICK_PERIOD_MS);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+	pinLevels[pin] = level;
+	MFRC522Emulator::pinWritten(pin, level);
+}
+
+int digitalRead(uint8_t pin) {
+	return pinLevels[pin];
+}
+
+void randomSeed(unsigned long seed) {
+	randomState = seed ? seed : 1;
+}
+
+uint32_t esp_random(void) {
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+void esp_fill_random(void *buf, size_t len) {
+	byte *out = (byte *)buf;
+	for (size_t i = 0; i < len; i++) {
+		out[i] = esp_random() & 0xFF;
+	}
+}
+
+long random(long max) {
+	return max > 0 ? esp_random() % max : 0;
+}
+
+long random(long min, long max) {
+	return min < max ? min + random(max - min) : min;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// SPI
+/////////////////////////////////////////////////////////////////////////////////////
+
+void SPIClass::beginTransaction(SPISettings settings) {
+	MFRC522Emulator::beginTransaction(settings.clock);
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+	return MFRC522Emulator::transfer(data);
+}
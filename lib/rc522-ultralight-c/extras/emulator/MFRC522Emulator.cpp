@@ -0,0 +1,654 @@
+/*
+ * MFRC522Emulator.cpp - Register level model of the MFRC522 for host builds.
+ * NOTE: Please also check the comments in MFRC522Emulator.h.
+ * Released into the public domain.
+ */
+
+#include "MFRC522Emulator.h"
+#include "VirtualPicc.h"
+#include <algorithm>
+
+#define REG(name) (MFRC522::name >> 1)
+
+// ComIrqReg bits
+#define IRQ_TX		0x40
+#define IRQ_RX		0x20
+#define IRQ_IDLE	0x10
+#define IRQ_TIMER	0x01
+// ErrorReg bits
+#define ERR_BUFFER_OVFL	0x10
+#define ERR_COLL		0x08
+#define ERR_CRC			0x04
+#define ERR_PARITY		0x02
+
+static const uint64_t NS_PER_S = 1000000000ULL;
+static const uint64_t FC = 13560000;						// Carrier frequency
+static const uint64_t FRAME_DELAY_NS = 1172 * NS_PER_S / FC;	// ISO/IEC 14443-3 6.2.1.1, PICC frame delay time for n = 9
+
+uint64_t MFRC522Emulator::_clockNs = 0;
+uint32_t MFRC522Emulator::_spiClock = 4000000;
+MFRC522Emulator *MFRC522Emulator::_active = nullptr;
+std::vector<MFRC522Emulator *> MFRC522Emulator::_emulators;
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Frames
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * CRC with the CRC_A polynomial, calculated bit by bit on purpose to stay independent of the table used by the library.
+ */
+static uint16_t crcA(const byte *data, uint16_t length, uint16_t preset) {
+	uint16_t crc = preset;
+	for (uint16_t i = 0; i < length; i++) {
+		byte value = data[i];
+		for (byte bit = 0; bit < 8; bit++) {
+			bool mix = (crc ^ value) & 1;
+			crc >>= 1;
+			value >>= 1;
+			if (mix) {
+				crc ^= 0x8408;
+			}
+		}
+	}
+	return crc;
+} // End crcA()
+
+/**
+ * Appends count bits of value, LSB first.
+ */
+void MFRC522Emulator::Frame::append(	byte value,	///< The bits to append.
+										byte count	///< Number of bits, 1..8.
+									) {
+	for (byte i = 0; i < count; i++, bits++) {
+		if (bits % 8 == 0) {
+			data[bits / 8] = 0;
+		}
+		data[bits / 8] |= ((value >> i) & 1) << (bits % 8);
+	}
+} // End append()
+
+/**
+ * Appends the CRC_A of the frame.
+ */
+void MFRC522Emulator::Frame::appendCRC() {
+	uint16_t crc = crcA(data, length(), 0x6363);
+	append(crc & 0xFF);
+	append(crc >> 8);
+} // End appendCRC()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Setup and statistics
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Constructor.
+ * The chip is held in hard power down while resetPowerDownPin is LOW, like the real NRSTPD input.
+ */
+MFRC522Emulator::MFRC522Emulator(	byte chipSelectPin,		///< Pin the library uses as chip select.
+									byte resetPowerDownPin	///< Pin the library uses as NRSTPD, MFRC522::UNUSED_PIN if not connected.
+								) {
+	_chipSelectPin = chipSelectPin;
+	_resetPowerDownPin = resetPowerDownPin;
+	_hardPowerDown = (resetPowerDownPin != MFRC522::UNUSED_PIN && digitalRead(resetPowerDownPin) == LOW);
+	_field = false;
+	_selected = false;
+	_firstByte = false;
+	_read = false;
+	_address = 0;
+	_transactionOverheadNs = 1500;	// SPI.beginTransaction() and toggling chip select on an ESP32
+	reset();
+	resetStats();
+	_emulators.push_back(this);
+} // End constructor
+
+MFRC522Emulator::~MFRC522Emulator() {
+	_emulators.erase(std::remove(_emulators.begin(), _emulators.end(), this), _emulators.end());
+	if (_active == this) {
+		_active = nullptr;
+	}
+} // End destructor
+
+/**
+ * Brings a PICC into the field. It is powered as soon as the antenna is on.
+ */
+void MFRC522Emulator::addPicc(VirtualPicc *picc) {
+	_piccs.push_back(picc);
+	_responses.reserve(_piccs.size());
+	picc->setPowered(_field);
+} // End addPicc()
+
+/**
+ * Removes a PICC from the field, it loses power and all state.
+ */
+void MFRC522Emulator::removePicc(VirtualPicc *picc) {
+	_piccs.erase(std::remove(_piccs.begin(), _piccs.end(), picc), _piccs.end());
+	picc->setPowered(false);
+} // End removePicc()
+
+void MFRC522Emulator::resetStats() {
+	memset(&_stats, 0, sizeof(_stats));
+	_statsStartNs = _clockNs;
+} // End resetStats()
+
+MFRC522Emulator::Stats MFRC522Emulator::stats() const {
+	Stats result = _stats;
+	result.elapsedNs = _clockNs - _statsStartNs;
+	return result;
+} // End stats()
+
+bool MFRC522Emulator::fieldOn() const {
+	return !_hardPowerDown && !(_regs[REG(CommandReg)] & 0x10) && (_regs[REG(TxControlReg)] & 0x03);
+} // End fieldOn()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// SPI interface
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Called by digitalWrite() of the host Arduino.h for every pin change.
+ */
+void MFRC522Emulator::pinWritten(byte pin, byte level) {
+	for (size_t i = 0; i < _emulators.size(); i++) {
+		MFRC522Emulator *emulator = _emulators[i];
+		if (pin == emulator->_chipSelectPin) {
+			emulator->select(level == LOW);
+		}
+		if (pin == emulator->_resetPowerDownPin) {
+			if (level == LOW) {
+				emulator->_hardPowerDown = true;
+				emulator->setField(false);
+			}
+			else if (emulator->_hardPowerDown) {	// Rising edge triggers a hard reset
+				emulator->_hardPowerDown = false;
+				emulator->reset();
+			}
+		}
+	}
+} // End pinWritten()
+
+/**
+ * Called by SPI.beginTransaction() of the host SPI.h.
+ */
+void MFRC522Emulator::beginTransaction(uint32_t clock) {
+	_spiClock = clock;
+} // End beginTransaction()
+
+/**
+ * Called by SPI.transfer() of the host SPI.h. Routes the byte to the selected emulator and advances the clock.
+ */
+byte MFRC522Emulator::transfer(byte value) {
+	uint64_t byteNs = 8 * NS_PER_S / _spiClock;
+	_clockNs += byteNs;
+	if (_active == nullptr) {
+		return 0;
+	}
+	_active->_stats.bytes++;
+	_active->_stats.busTimeNs += byteNs;
+	return _active->transferByte(value);
+} // End transfer()
+
+void MFRC522Emulator::select(bool selected) {
+	if (selected) {
+		_active = this;
+		_selected = true;
+		_firstByte = true;
+		_stats.transactions++;
+		_stats.busTimeNs += _transactionOverheadNs;
+		_clockNs += _transactionOverheadNs;
+	}
+	else {
+		_selected = false;
+		if (_active == this) {
+			_active = nullptr;
+		}
+	}
+} // End select()
+
+/**
+ * Handles one byte of a SPI frame. The first byte is the address, datasheet section 8.1.2.3.
+ * When reading, every further byte on MOSI is the address of the next read.
+ */
+byte MFRC522Emulator::transferByte(byte value) {
+	if (_hardPowerDown) {
+		return 0;
+	}
+	update();
+	if (_firstByte) {
+		_firstByte = false;
+		_read = value & 0x80;
+		_address = (value >> 1) & 0x3F;
+		return 0;
+	}
+	if (_read) {
+		byte result = readRegister(_address);
+		_address = (value >> 1) & 0x3F;
+		return result;
+	}
+	writeRegister(_address, value);
+	return 0;
+} // End transferByte()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Registers
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Sets all registers to their reset values, datasheet section 9.3.
+ */
+void MFRC522Emulator::reset() {
+	memset(_regs, 0, sizeof(_regs));
+	_regs[REG(CommandReg)]		= 0x20;
+	_regs[REG(ComIEnReg)]		= 0x80;
+	_regs[REG(ComIrqReg)]		= 0x14;
+	_regs[REG(Status1Reg)]		= 0x21;
+	_regs[REG(WaterLevelReg)]	= 0x08;
+	_regs[REG(ControlReg)]		= 0x10;
+	_regs[REG(CollReg)]			= 0xA0;
+	_regs[REG(ModeReg)]			= 0x3F;
+	_regs[REG(TxControlReg)]	= 0x80;
+	_regs[REG(TxSelReg)]		= 0x10;
+	_regs[REG(RxSelReg)]		= 0x84;
+	_regs[REG(RxThresholdReg)]	= 0x84;
+	_regs[REG(DemodReg)]		= 0x4D;
+	_regs[REG(MfTxReg)]			= 0x62;
+	_regs[REG(SerialSpeedReg)]	= 0xEB;
+	_regs[REG(CRCResultRegH)]	= 0xFF;
+	_regs[REG(CRCResultRegL)]	= 0xFF;
+	_regs[REG(ModWidthReg)]		= 0x26;
+	_regs[REG(RFCfgReg)]		= 0x48;
+	_regs[REG(GsNReg)]			= 0x88;
+	_regs[REG(CWGsPReg)]		= 0x20;
+	_regs[REG(ModGsPReg)]		= 0x20;
+	_regs[REG(VersionReg)]		= VERSION;
+	_fifoLevel = 0;
+	_pending.active = false;
+	setField(fieldOn());
+} // End reset()
+
+byte MFRC522Emulator::readRegister(byte reg) {
+	switch (reg) {
+		case REG(FIFODataReg):
+			if (_fifoLevel == 0) {
+				return 0;
+			}
+			else {
+				byte value = _fifo[0];
+				memmove(_fifo, _fifo + 1, --_fifoLevel);
+				return value;
+			}
+		case REG(FIFOLevelReg):
+			return _fifoLevel;
+		default:
+			return _regs[reg];
+	}
+} // End readRegister()
+
+void MFRC522Emulator::writeRegister(byte reg, byte value) {
+	switch (reg) {
+		case REG(CommandReg): {
+			byte command = value & 0x0F;
+			if (command == MFRC522::PCD_NoCmdChange) {
+				command = _regs[reg] & 0x0F;
+			}
+			_regs[reg] = (value & 0x30) | command;
+			setField(fieldOn());
+			if ((value & 0x0F) != MFRC522::PCD_NoCmdChange) {
+				executeCommand(command);
+			}
+			break;
+		}
+		case REG(ComIrqReg):
+		case REG(DivIrqReg):
+			if (value & 0x80) {		// Set1/Set2: the marked bits are set, otherwise cleared
+				_regs[reg] |= value & 0x7F;
+			}
+			else {
+				_regs[reg] &= ~value;
+			}
+			break;
+		case REG(FIFODataReg):
+			if (_fifoLevel < FIFO_SIZE) {
+				_fifo[_fifoLevel++] = value;
+			}
+			else {
+				_regs[REG(ErrorReg)] |= ERR_BUFFER_OVFL;
+			}
+			break;
+		case REG(FIFOLevelReg):
+			if (value & 0x80) {		// FlushBuffer
+				_fifoLevel = 0;
+				_regs[REG(ErrorReg)] &= ~ERR_BUFFER_OVFL;
+			}
+			break;
+		case REG(BitFramingReg):
+			_regs[reg] = value & 0x7F;
+			if ((value & 0x80) && (_regs[REG(CommandReg)] & 0x0F) == MFRC522::PCD_Transceive) {	// StartSend
+				startTransmission(true);
+			}
+			break;
+		case REG(CollReg):
+			_regs[reg] = (_regs[reg] & 0x7F) | (value & 0x80);	// Only ValuesAfterColl is writable
+			break;
+		case REG(Status2Reg):
+			// MFCrypto1On can only be cleared by software
+			_regs[reg] = (value & 0xC0) | (_regs[reg] & value & 0x08) | (_regs[reg] & 0x07);
+			break;
+		case REG(TxControlReg):
+			_regs[reg] = value;
+			setField(fieldOn());
+			break;
+		case REG(ErrorReg):
+		case REG(Status1Reg):
+		case REG(ControlReg):
+		case REG(VersionReg):
+			break;					// Read only
+		default:
+			_regs[reg] = value;
+			break;
+	}
+} // End writeRegister()
+
+/**
+ * Applies the result of a running command once its completion time has passed.
+ */
+void MFRC522Emulator::update() {
+	if (!_pending.active || _clockNs < _pending.at) {
+		return;
+	}
+	_pending.active = false;
+	_regs[REG(ComIrqReg)] |= _pending.irq;
+	_regs[REG(ErrorReg)] |= _pending.error;
+	if (_pending.receive) {
+		// The first received bit is stored at bit position RxAlign of the first byte
+		byte rxAlign = (_regs[REG(BitFramingReg)] >> 4) & 0x07;
+		uint16_t bits = rxAlign + _pending.rx.bits;
+		uint16_t length = (bits + 7) / 8;
+		if (length > FIFO_SIZE) {
+			_regs[REG(ErrorReg)] |= ERR_BUFFER_OVFL;
+			length = FIFO_SIZE;
+		}
+		memset(_fifo, 0, length);
+		for (uint16_t i = 0; i < _pending.rx.bits && rxAlign + i < length * 8; i++) {
+			uint16_t pos = rxAlign + i;
+			_fifo[pos / 8] |= _pending.rx.bit(i) << (pos % 8);
+		}
+		_fifoLevel = length;
+		_regs[REG(ControlReg)] = (_regs[REG(ControlReg)] & ~0x07) | (bits % 8);
+		if (_pending.collPos == 0) {
+			_regs[REG(CollReg)] |= 0x20;	// CollPosNotValid
+		}
+		else if (_pending.collPos > 32) {
+			_regs[REG(CollReg)] |= 0x20;
+			_regs[REG(ErrorReg)] |= ERR_COLL;
+		}
+		else {
+			_regs[REG(CollReg)] = (_regs[REG(CollReg)] & 0x80) | (_pending.collPos & 0x1F);
+			_regs[REG(ErrorReg)] |= ERR_COLL;
+		}
+	}
+	if (_pending.crypto1On) {
+		_regs[REG(Status2Reg)] |= 0x08;
+	}
+	if (_pending.idle) {
+		_regs[REG(CommandReg)] &= ~0x0F;
+	}
+} // End update()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Commands
+/////////////////////////////////////////////////////////////////////////////////////
+
+void MFRC522Emulator::executeCommand(byte command) {
+	_pending.active = false;	// A new command stops the running one
+	switch (command) {
+		case MFRC522::PCD_Mem:
+			// Moves 25 bytes from the FIFO to the internal buffer
+			_fifoLevel = _fifoLevel > 25 ? _fifoLevel - 25 : 0;
+			_regs[REG(ComIrqReg)] |= IRQ_IDLE;
+			_regs[REG(CommandReg)] &= ~0x0F;
+			break;
+		case MFRC522::PCD_GenerateRandomID:
+			_regs[REG(ComIrqReg)] |= IRQ_IDLE;
+			_regs[REG(CommandReg)] &= ~0x0F;
+			break;
+		case MFRC522::PCD_CalcCRC:
+			calculateCRC();
+			break;
+		case MFRC522::PCD_Transmit:
+			startTransmission(false);
+			break;
+		case MFRC522::PCD_MFAuthent:
+			authenticate();
+			break;
+		case MFRC522::PCD_SoftReset:
+			reset();
+			break;
+		default:					// Idle, Receive and Transceive wait for StartSend or a PICC
+			break;
+	}
+} // End executeCommand()
+
+/**
+ * CalcCRC command. With AutoTestReg[3:0] = 9 the digital self test fills the FIFO with the reference data.
+ */
+void MFRC522Emulator::calculateCRC() {
+	if ((_regs[REG(AutoTestReg)] & 0x0F) == 0x09) {
+		memcpy(_fifo, MFRC522_firmware_referenceV2_0, FIFO_SIZE);
+		_fifoLevel = FIFO_SIZE;
+		return;
+	}
+	static const uint16_t presets[4] = { 0x0000, 0x6363, 0xA671, 0xFFFF };	// ModeReg CRCPreset[1:0]
+	uint16_t crc = crcA(_fifo, _fifoLevel, presets[_regs[REG(ModeReg)] & 0x03]);
+	_clockNs += _fifoLevel * 8 * NS_PER_S / FC;	// The coprocessor handles one bit per carrier cycle
+	_fifoLevel = 0;
+	_regs[REG(CRCResultRegL)] = crc & 0xFF;
+	_regs[REG(CRCResultRegH)] = crc >> 8;
+	_regs[REG(DivIrqReg)] |= 0x04;	// CRCIRq
+} // End calculateCRC()
+
+/**
+ * Sends the FIFO content to the PICCs and schedules the completion of the Transmit or Transceive command.
+ */
+void MFRC522Emulator::startTransmission(bool receive) {
+	Frame tx;
+	byte txLastBits = _regs[REG(BitFramingReg)] & 0x07;
+	for (byte i = 0; i < _fifoLevel; i++) {
+		tx.append(_fifo[i], (i == _fifoLevel - 1 && txLastBits) ? txLastBits : 8);
+	}
+	_fifoLevel = 0;
+	if (_regs[REG(TxModeReg)] & 0x80) {	// TxCRCEn
+		tx.appendCRC();
+	}
+	_regs[REG(ErrorReg)] &= ERR_BUFFER_OVFL;
+	_regs[REG(CollReg)] |= 0x20;
+	_stats.rfFrames++;
+
+	uint64_t txEnd = _clockNs + rfTimeNs(tx.bits, _regs[REG(TxModeReg)]);
+	Frame rx;
+	byte collPos = 0;
+	uint32_t processingUs = 0;
+	bool answered = false;
+	bool overdriven = false;
+	bool parityError = false;
+	exchange(tx, _regs[REG(Status2Reg)] & 0x08, rx, collPos, processingUs, answered, overdriven);
+	if (answered && (_regs[REG(TModeReg)] & 0x80) && FRAME_DELAY_NS + processingUs * 1000ULL > timerPeriodNs()) {
+		answered = false;	// The timer expires before the PICC answers
+	}
+	if (answered && overdriven) {
+		if (rx.bits >= 24) {
+			rx.data[0] ^= 0x10;	// Bit error, shows as wrong CRC_A
+		}
+		else {
+			parityError = true;
+		}
+	}
+
+	_pending = Pending();
+	_pending.active = true;
+	if (!receive) {
+		_pending.at = txEnd;
+		_pending.irq = IRQ_TX | IRQ_IDLE;
+		_pending.idle = true;
+		return;
+	}
+	if (answered) {
+		if ((_regs[REG(RxModeReg)] & 0x80) && rx.bits >= 24 && rx.lastBits() == 0) {	// RxCRCEn
+			Frame check;
+			for (uint16_t i = 0; i < rx.length() - 2; i++) {
+				check.append(rx.data[i]);
+			}
+			check.appendCRC();
+			if (memcmp(check.data, rx.data, rx.length()) != 0) {
+				_pending.error |= ERR_CRC;
+			}
+			rx.bits -= 16;
+		}
+		_pending.at = txEnd + FRAME_DELAY_NS + processingUs * 1000ULL + rfTimeNs(rx.bits, _regs[REG(RxModeReg)]);
+		_pending.irq = IRQ_TX | IRQ_RX;
+		_pending.error |= parityError ? ERR_PARITY : 0;
+		_pending.receive = true;
+		_pending.rx = rx;
+		_pending.collPos = collPos;
+	}
+	else if (_regs[REG(TModeReg)] & 0x80) {	// TAuto, the timer starts at the end of the transmission
+		_pending.at = txEnd + timerPeriodNs();
+		_pending.irq = IRQ_TX | IRQ_TIMER;
+	}
+	else {
+		_pending.at = txEnd;
+		_pending.irq = IRQ_TX;
+	}
+} // End startTransmission()
+
+/**
+ * MFAuthent command. The FIFO holds the authentication command, block address, 6 key bytes and 4 UID bytes.
+ * Takes the time of the four frames of the MIFARE Classic three pass authentication.
+ */
+void MFRC522Emulator::authenticate() {
+	byte data[12] = { 0 };
+	memcpy(data, _fifo, std::min<byte>(_fifoLevel, 12));
+	_fifoLevel = 0;
+	_stats.rfFrames += 2;
+
+	bool answered = false;
+	bool authenticated = false;
+	if (_field) {
+		for (size_t i = 0; i < _piccs.size(); i++) {
+			if (_piccs[i]->state() == VirtualPicc::ACTIVE) {
+				answered = true;
+				authenticated |= _piccs[i]->mifareAuthenticate(data[0], data[1], &data[2], &data[8]);
+			}
+		}
+	}
+
+	byte txMode = _regs[REG(TxModeReg)];
+	byte rxMode = _regs[REG(RxModeReg)];
+	uint64_t nonce = rfTimeNs(32, txMode) + FRAME_DELAY_NS + rfTimeNs(32, rxMode);	// Auth command, nT
+	uint64_t token = rfTimeNs(64, txMode) + FRAME_DELAY_NS + rfTimeNs(32, rxMode);	// nR aR, aT
+
+	_pending = Pending();
+	_pending.active = true;
+	if (authenticated) {
+		_pending.at = _clockNs + nonce + token;
+		_pending.irq = IRQ_IDLE;
+		_pending.idle = true;
+		_pending.crypto1On = true;
+	}
+	else if (answered) {	// The PICC does not answer the token of the wrong key
+		_pending.at = _clockNs + nonce + rfTimeNs(64, txMode) + timerPeriodNs();
+		_pending.irq = IRQ_TIMER;
+	}
+	else {
+		_pending.at = _clockNs + rfTimeNs(32, txMode) + timerPeriodNs();
+		_pending.irq = IRQ_TIMER;
+	}
+} // End authenticate()
+
+/**
+ * Hands a frame to all PICCs in the field and merges their answers like the receiver does.
+ * Bits where the PICCs disagree are a collision. CollPos counts from bit 0 of the first FIFO byte, ie includes
+ * RxAlign, as described for CollReg in the datasheet section 9.3.1.15.
+ */
+void MFRC522Emulator::exchange(const Frame &tx, bool crypto1, Frame &rx, byte &collPos, uint32_t &processingUs, bool &answered, bool &overdriven) {
+	answered = false;
+	overdriven = false;
+	collPos = 0;
+	processingUs = 0;
+	if (!_field) {
+		return;
+	}
+	uint16_t common = 0xFFFF;
+	std::vector<Frame> &responses = _responses;
+	responses.clear();
+	for (size_t i = 0; i < _piccs.size(); i++) {
+		Frame response;
+		uint32_t us = 0;
+		if (!_piccs[i]->hears(_regs[REG(ModWidthReg)])) {
+			continue;	// The PICC does not decode the pauses
+		}
+		if (_piccs[i]->receive(tx, crypto1, response, us) && _piccs[i]->heardWith(rxGainDb())) {
+			responses.push_back(response);
+			processingUs = std::max(processingUs, us + _piccs[i]->responseDelay());
+			overdriven |= _piccs[i]->overdrivenWith(rxGainDb());
+			common = std::min(common, response.bits);
+		}
+	}
+	if (responses.empty()) {
+		return;
+	}
+	answered = true;
+	rx = responses[0];
+	uint16_t first = common;	// First bit where any two answers differ, compared with the unmerged first answer
+	for (size_t i = 1; i < responses.size(); i++) {
+		const Frame &other = responses[i];
+		for (uint16_t pos = 0; pos < other.bits; pos++) {
+			if (pos < first && responses[0].bit(pos) != other.bit(pos)) {
+				first = pos;
+			}
+			if (pos >= rx.bits) {
+				rx.append(other.bit(pos), 1);
+			}
+			else if (other.bit(pos)) {
+				rx.data[pos / 8] |= 1 << (pos % 8);
+			}
+		}
+	}
+	if (first < common) {
+		collPos = std::min<uint16_t>((_regs[REG(BitFramingReg)] >> 4 & 0x07) + first + 1, 33);
+	}
+} // End exchange()
+
+void MFRC522Emulator::setField(bool on) {
+	if (on == _field) {
+		return;
+	}
+	_field = on;
+	for (size_t i = 0; i < _piccs.size(); i++) {
+		_piccs[i]->setPowered(on);
+	}
+} // End setField()
+
+/**
+ * Receiver gain of RFCfgReg RxGain[2:0], see table 98 of the datasheet.
+ */
+byte MFRC522Emulator::rxGainDb() const {
+	static const byte gains[8] = { 18, 23, 18, 23, 33, 38, 43, 48 };
+	return gains[(_regs[REG(RFCfgReg)] >> 4) & 0x07];
+} // End rxGainDb()
+
+/**
+ * Air time of a frame incl. start/end of communication and the parity bit after every byte.
+ */
+uint64_t MFRC522Emulator::rfTimeNs(uint16_t bits, byte speedReg) const {
+	uint64_t bitNs = 128 * NS_PER_S / (FC << ((speedReg >> 4) & 0x03));	// 106 kBd = fc / 128
+	return (2 + bits + bits / 8) * bitNs;
+} // End rfTimeNs()
+
+/**
+ * f_timer = 13.56 MHz / (2 * TPreScaler + 1), the timer runs TReload + 1 periods.
+ */
+uint64_t MFRC522Emulator::timerPeriodNs() const {
+	uint64_t prescaler = ((_regs[REG(TModeReg)] & 0x0F) << 8) | _regs[REG(TPrescalerReg)];
+	uint64_t reload = (_regs[REG(TReloadRegH)] << 8) | _regs[REG(TReloadRegL)];
+	return (2 * prescaler + 1) * (reload + 1) * NS_PER_S / FC;
+} // End timerPeriodNs()
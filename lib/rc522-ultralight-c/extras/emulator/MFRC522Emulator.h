@@ -0,0 +1,155 @@
+/**
+ * MFRC522Emulator.h - Register level model of the MFRC522 for host builds.
+ *
+ * The emulator sits behind the host versions of Arduino.h and SPI.h in this directory. The library talks to it
+ * through SPI.transfer() exactly like to the real chip, so MFRC522, MFRC522Extended and everything built on top
+ * of them (PICC_Select, MIFARE_UL_C_Auth, PCD_NTAG216_AUTH, the CardReader of the firmware, ...) run unmodified.
+ *
+ * Modelled are the parts of the chip the library uses:
+ * 		- SPI address/data framing, one emulator per chip select pin, NRSTPD hard power down
+ * 		- 64 byte FIFO incl. flush and BufferOvfl, FIFOLevelReg, WaterLevelReg
+ * 		- ComIrqReg/DivIrqReg incl. Set1/Set2 semantics, ErrorReg, CollReg, ControlReg RxLastBits, Status2Reg MFCrypto1On
+ * 		- Commands Idle, Mem, CalcCRC (incl. self test), Transmit, Transceive, MFAuthent, SoftReset, soft power down
+ * 		- Bit oriented frames (TxLastBits/RxAlign), TxCRCEn/RxCRCEn, TxSpeed/RxSpeed
+ * 		- The timer (TAuto, TPrescaler, TReload) which raises TimerIRq if no PICC answers
+ * 		- The RF field (TxControlReg): PICCs lose power when it is switched off
+ * 		- The RF link of every PICC (VirtualPicc::setLink): RxGain (RFCfgReg), ModWidthReg and a slow PICC vs. the timer
+ *
+ * The PICCs in the field are VirtualPicc instances (see VirtualPicc.h) handling REQA/WUPA, anticollision including
+ * bit collisions between several PICCs, SELECT and HLTA themselves.
+ *
+ * Time is simulated. Every SPI byte, RF frame and delay() advances the clock, so millis() and micros() follow the
+ * emulated bus. For every high-level operation the emulator reports the number of SPI transactions, SPI bytes, RF
+ * frames, the time spent on the SPI bus and the total simulated time, see Stats and measure().
+ *
+ * Build it together with the library sources on the host, e.g.:
+ * 		g++ -std=c++11 -Iextras/emulator -Isrc src/MFRC522.cpp src/des.c extras/emulator/MFRC522Emulator.cpp \
+ * 			extras/emulator/VirtualPicc.cpp extras/emulator/ArduinoHost.cpp my_program.cpp
+ * This directory must come first in the include path. It is not part of the Arduino/PlatformIO library build.
+ */
+#ifndef MFRC522Emulator_h
+#define MFRC522Emulator_h
+
+#include <Arduino.h>
+#include <MFRC522.h>
+#include <vector>
+
+class VirtualPicc;
+
+class MFRC522Emulator {
+public:
+	// Bit framed RF frame, LSB first like on air
+	struct Frame {
+		byte data[1024];
+		uint16_t bits;
+
+		Frame() : bits(0) {}
+		uint16_t length() const { return (bits + 7) / 8; }
+		byte lastBits() const { return bits % 8; }	// 0 for 8 valid bits in the last byte
+		bool bit(uint16_t pos) const { return (data[pos / 8] >> (pos % 8)) & 1; }
+		void append(byte value, byte count = 8);
+		void appendCRC();
+	};
+
+	// Counters for one high-level operation, see resetStats() and measure()
+	struct Stats {
+		uint32_t transactions;		// SPI transactions (chip select cycles)
+		uint32_t bytes;				// SPI bytes incl. address bytes
+		uint32_t rfFrames;			// Frames sent to the PICCs
+		uint64_t busTimeNs;			// Time the SPI bus was busy incl. transaction overhead
+		uint64_t elapsedNs;			// Simulated time incl. RF communication, polling and delay()
+	};
+
+	static constexpr byte FIFO_SIZE = 64;
+	static constexpr byte VERSION = 0x92;			// MFRC522 version 2.0
+
+	MFRC522Emulator(byte chipSelectPin, byte resetPowerDownPin = MFRC522::UNUSED_PIN);
+	~MFRC522Emulator();
+
+	// PICCs in the field
+	void addPicc(VirtualPicc *picc);
+	void removePicc(VirtualPicc *picc);
+
+	// Statistics
+	void resetStats();
+	Stats stats() const;
+	template <typename Operation>
+	Stats measure(Operation operation) {
+		resetStats();
+		operation();
+		return stats();
+	}
+
+	// Bus timing
+	void setTransactionOverhead(uint32_t ns) { _transactionOverheadNs = ns; }
+
+	// Simulated clock shared by all emulators, used by millis(), micros() and delay() of the host Arduino.h
+	static uint64_t now() { return _clockNs; }
+	static void advance(uint64_t ns) { _clockNs += ns; }
+
+	// Hooks of the host Arduino.h and SPI.h
+	static void pinWritten(byte pin, byte level);
+	static void beginTransaction(uint32_t clock);
+	static byte transfer(byte value);
+
+	// Direct register access for diagnostics, does not count as bus traffic
+	byte peekRegister(MFRC522::PCD_Register reg) const { return _regs[reg >> 1]; }
+	bool fieldOn() const;
+
+private:
+	struct Pending {
+		bool active;
+		uint64_t at;			// Completion time
+		byte irq;				// ComIrqReg bits to set on completion
+		byte error;				// ErrorReg bits to set on completion
+		bool receive;			// Copy rx into the FIFO
+		bool idle;				// Command terminates on completion
+		bool crypto1On;			// Set MFCrypto1On on completion
+		Frame rx;
+		byte collPos;			// First collision, 1 based incl. RxAlign. 0 for none, 33 if out of the CollPos range
+	};
+
+	void reset();
+	void select(bool selected);
+	byte transferByte(byte value);
+	void update();
+	byte readRegister(byte reg);
+	void writeRegister(byte reg, byte value);
+	void executeCommand(byte command);
+	void startTransmission(bool receive);
+	void authenticate();
+	void calculateCRC();
+	void setField(bool on);
+	void exchange(const Frame &tx, bool crypto1, Frame &rx, byte &collPos, uint32_t &processingUs, bool &answered, bool &overdriven);
+	byte rxGainDb() const;
+	uint64_t rfTimeNs(uint16_t bits, byte speedReg) const;
+	uint64_t timerPeriodNs() const;
+
+	byte _chipSelectPin;
+	byte _resetPowerDownPin;
+	bool _hardPowerDown;
+	bool _field;
+	byte _regs[64];
+	byte _fifo[FIFO_SIZE];
+	byte _fifoLevel;
+	Pending _pending;
+	std::vector<VirtualPicc *> _piccs;
+	std::vector<Frame> _responses;	// Answers of the PICCs in exchange(), kept so an exchange does not allocate
+
+	// SPI frame state
+	bool _selected;
+	bool _firstByte;
+	bool _read;
+	byte _address;
+
+	Stats _stats;
+	uint64_t _statsStartNs;
+	uint32_t _transactionOverheadNs;
+
+	static uint64_t _clockNs;
+	static uint32_t _spiClock;
+	static MFRC522Emulator *_active;
+	static std::vector<MFRC522Emulator *> _emulators;
+};
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * SPI.h - SPI for host builds, every transfer goes to the MFRC522Emulator selected by its chip select pin.
+ */
+#ifndef SPI_h
+#define SPI_h
+
+#include <Arduino.h>
+
+#define SPI_CLOCK_DIV4	4000000		// Arduino Uno: 16 MHz / 4
+#define LSBFIRST		0
+#define MSBFIRST		1
+#define SPI_MODE0		0x00
+
+class SPISettings {
+public:
+	SPISettings(uint32_t clock = 4000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0)
+		: clock(clock) { (void)bitOrder; (void)dataMode; }
+	uint32_t clock;
+};
+
+class SPIClass {
+public:
+	void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) { (void)sck; (void)miso; (void)mosi; (void)ss; }
+	void end() {}
+	void beginTransaction(SPISettings settings);
+	void endTransaction() {}
+	uint8_t transfer(uint8_t data);
+};
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,633 @@
+/*
+ * VirtualPicc.cpp - PICCs for the MFRC522Emulator.
+ * NOTE: Please also check the comments in VirtualPicc.h.
+ * Released into the public domain.
+ */
+
+#include "VirtualPicc.h"
+
+/////////////////////////////////////////////////////////////////////////////////////
+// ISO/IEC 14443-3 type A
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Constructor.
+ */
+VirtualPicc::VirtualPicc(	const byte *uid,	///< The UID, 4, 7 or 10 bytes.
+							byte uidSize,		///< Number of bytes in uid.
+							uint16_t atqa,		///< Answer to request, sent LSB first.
+							byte sak			///< Select acknowledge of the last cascade level.
+						) {
+	memcpy(_uid, uid, uidSize);
+	_uidSize = uidSize;
+	_atqa = atqa;
+	_sak = sak;
+	_state = POWER_OFF;
+	_cascadeLevel = 1;
+	_halted = false;
+	_minGainDb = 0;
+	_maxGainDb = 0xFF;
+	_minModWidth = 0x00;
+	_maxModWidth = 0x3F;
+	_responseDelayUs = 0;
+	_random = 0x811C9DC5;
+	for (byte i = 0; i < uidSize; i++) {	// Reproducible random numbers per UID
+		_random = (_random ^ uid[i]) * 0x01000193;
+	}
+} // End constructor
+
+void VirtualPicc::setLink(byte minGainDb, byte maxGainDb, byte minModWidth, byte maxModWidth) {
+	_minGainDb = minGainDb;
+	_maxGainDb = maxGainDb;
+	_minModWidth = minModWidth;
+	_maxModWidth = maxModWidth;
+} // End setLink()
+
+/**
+ * The PICC is powered by the field of the reader, losing it resets the PICC to state IDLE.
+ */
+void VirtualPicc::setPowered(bool powered) {
+	if (!powered) {
+		deselect();
+		_state = POWER_OFF;
+	}
+	else if (_state == POWER_OFF) {
+		_state = IDLE;
+		_halted = false;
+	}
+} // End setPowered()
+
+/**
+ * Handles a frame sent by the reader.
+ *
+ * @return true if the PICC answers with response.
+ */
+bool VirtualPicc::receive(	const Frame &frame,			///< The frame as sent on air.
+							bool crypto1,				///< True if the reader encrypts the frame with Crypto1.
+							Frame &response,			///< Out: The answer of the PICC.
+							uint32_t &processingUs		///< Out: Time the PICC needs before it answers, on top of the frame delay time.
+						) {
+	processingUs = 0;
+	response.bits = 0;
+	if (_state == POWER_OFF) {
+		return false;
+	}
+	if (crypto1 != crypto1Active()) {
+		// The frame is garbage for the PICC
+		if (_state == READY || _state == ACTIVE) {
+			deselect();
+			_state = _halted ? HALT : IDLE;
+		}
+		return false;
+	}
+
+	// REQA and WUPA are short frames of 7 bits
+	if (frame.bits == 7) {
+		byte command = frame.data[0] & 0x7F;
+		if ((command == MFRC522::PICC_CMD_REQA && _state == IDLE) ||
+			(command == MFRC522::PICC_CMD_WUPA && (_state == IDLE || _state == HALT))) {
+			_halted = (_state == HALT);
+			_state = READY;
+			_cascadeLevel = 1;
+			response.append(_atqa & 0xFF);
+			response.append(_atqa >> 8);
+			return true;
+		}
+		if (_state == READY || _state == ACTIVE) {
+			deselect();
+			_state = _halted ? HALT : IDLE;
+		}
+		return false;
+	}
+
+	if (_state == READY) {
+		return anticollision(frame, response);
+	}
+	if (_state != ACTIVE) {
+		return false;
+	}
+
+	// In state ACTIVE only complete frames with a valid CRC_A are accepted, everything else is ignored
+	if (frame.lastBits() != 0 || frame.length() < 3) {
+		return false;
+	}
+	byte length = frame.length() - 2;
+	Frame check;
+	for (byte i = 0; i < length; i++) {
+		check.append(frame.data[i]);
+	}
+	check.appendCRC();
+	if (check.data[length] != frame.data[length] || check.data[length + 1] != frame.data[length + 1]) {
+		return false;
+	}
+	if (frame.data[0] == MFRC522::PICC_CMD_HLTA && length == 2 && frame.data[1] == 0x00) {
+		deselect();
+		_state = HALT;
+		_halted = true;
+		return false;
+	}
+	return command(frame.data, length, response, processingUs);
+} // End receive()
+
+/**
+ * MIFARE Classic authentication requested by the MFAuthent command of the reader. Only MIFARE Classic PICCs support it.
+ *
+ * @return true if key and UID are correct.
+ */
+bool VirtualPicc::mifareAuthenticate(byte command, byte blockAddr, const byte *key, const byte *uid4) {
+	(void)command;
+	(void)blockAddr;
+	(void)key;
+	(void)uid4;
+	deselect();
+	_state = _halted ? HALT : IDLE;
+	return false;
+} // End mifareAuthenticate()
+
+/**
+ * ANTICOLLISION and SELECT of the current cascade level, ISO/IEC 14443-3 section 6.5.3.
+ * A PICC whose UID does not match the known bits stays silent, a PICC that is not selected leaves state READY.
+ */
+bool VirtualPicc::anticollision(const Frame &frame, Frame &response) {
+	byte level = 0;
+	switch (frame.data[0]) {
+		case MFRC522::PICC_CMD_SEL_CL1: level = 1; break;
+		case MFRC522::PICC_CMD_SEL_CL2: level = 2; break;
+		case MFRC522::PICC_CMD_SEL_CL3: level = 3; break;
+	}
+	if (level != _cascadeLevel || frame.bits < 16) {
+		deselect();
+		_state = _halted ? HALT : IDLE;
+		return false;
+	}
+	byte cl[5];
+	levelBytes(level, cl);
+	byte nvb = frame.data[1];
+
+	if (nvb == 0x70) {	// SELECT
+		if (frame.bits != 9 * 8 || memcmp(&frame.data[2], cl, 5) != 0) {
+			_state = _halted ? HALT : IDLE;
+			return false;
+		}
+		Frame check;
+		for (byte i = 0; i < 7; i++) {
+			check.append(frame.data[i]);
+		}
+		check.appendCRC();
+		if (memcmp(check.data, frame.data, 9) != 0) {
+			return false;
+		}
+		byte sak;
+		if ((level == 1 && _uidSize > 4) || (level == 2 && _uidSize > 7)) {
+			sak = 0x04;		// Cascade bit, UID not complete
+			_cascadeLevel++;
+		}
+		else {
+			sak = _sak;
+			_state = ACTIVE;
+		}
+		return respond(response, &sak, 1);
+	}
+
+	// ANTICOLLISION: compare the known bits, answer with the rest of UID CLn and BCC
+	uint16_t knownBits = ((nvb >> 4) - 2) * 8 + (nvb & 0x07);
+	if ((nvb >> 4) < 2 || knownBits >= 40 || frame.bits != 16 + knownBits) {
+		return false;
+	}
+	Frame clFrame;
+	for (byte i = 0; i < 5; i++) {
+		clFrame.append(cl[i]);
+	}
+	for (uint16_t i = 0; i < knownBits; i++) {
+		if (frame.bit(16 + i) != clFrame.bit(i)) {
+			return false;
+		}
+	}
+	for (uint16_t i = knownBits; i < 40; i++) {
+		response.append(clFrame.bit(i), 1);
+	}
+	return true;
+} // End anticollision()
+
+/**
+ * UID CLn and BCC of a cascade level, ISO/IEC 14443-3 section 6.5.4.
+ */
+void VirtualPicc::levelBytes(byte level, byte cl[5]) const {
+	bool cascade = (level == 1 && _uidSize > 4) || (level == 2 && _uidSize > 7);
+	byte start = (level - 1) * 3;
+	if (cascade) {
+		cl[0] = MFRC522::PICC_CMD_CT;
+		memcpy(&cl[1], &_uid[start], 3);
+	}
+	else {
+		memcpy(cl, &_uid[start], 4);
+	}
+	cl[4] = cl[0] ^ cl[1] ^ cl[2] ^ cl[3];
+} // End levelBytes()
+
+bool VirtualPicc::respond(Frame &response, const byte *data, byte length) {
+	for (byte i = 0; i < length; i++) {
+		response.append(data[i]);
+	}
+	response.appendCRC();
+	return true;
+} // End respond()
+
+bool VirtualPicc::ack(Frame &response) {
+	response.append(MFRC522::MF_ACK, 4);
+	return true;
+} // End ack()
+
+bool VirtualPicc::nak(Frame &response, byte code) {
+	deselect();
+	_state = _halted ? HALT : IDLE;
+	response.append(code, 4);
+	return true;
+} // End nak()
+
+byte VirtualPicc::nextRandom() {
+	_random ^= _random << 13;
+	_random ^= _random >> 17;
+	_random ^= _random << 5;
+	return _random & 0xFF;
+} // End nextRandom()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// MIFARE Ultralight family
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Constructor.
+ * Pages 0 to 2 hold the UID with its check bytes, all other pages are 00h.
+ */
+VirtualUltralight::VirtualUltralight(const byte uid[7], byte pageCount, uint16_t atqa)
+		: VirtualPicc(uid, 7, atqa, 0x00), _pageCount(pageCount), _pages(pageCount * 4, 0), _compatWritePage(-1) {
+	memcpy(page(0), uid, 3);
+	page(0)[3] = MFRC522::PICC_CMD_CT ^ uid[0] ^ uid[1] ^ uid[2];	// BCC0
+	memcpy(page(1), &uid[3], 4);
+	page(2)[0] = uid[3] ^ uid[4] ^ uid[5] ^ uid[6];					// BCC1
+	page(2)[1] = 0x48;												// Internal
+} // End constructor
+
+bool VirtualUltralight::command(const byte *data, byte length, Frame &response, uint32_t &processingUs) {
+	// Second part of a COMPATIBILITY WRITE: 16 bytes, the first 4 are written
+	if (_compatWritePage >= 0) {
+		byte target = _compatWritePage;
+		_compatWritePage = -1;
+		if (length != 16) {
+			return nak(response);
+		}
+		writePage(target, data);
+		processingUs = WRITE_TIME_US;
+		return ack(response);
+	}
+
+	switch (data[0]) {
+		case MFRC522::PICC_CMD_MF_READ: {
+			byte start = data[1];
+			if (length != 2 || start >= readablePages() || !canRead(start)) {
+				return nak(response);
+			}
+			byte buffer[16];
+			for (byte i = 0; i < 4; i++) {	// Rolls over to page 0, protected pages read as 00h
+				byte current = (start + i) % readablePages();
+				if (canRead(current)) {
+					readPage(current, &buffer[i * 4]);
+				}
+				else {
+					memset(&buffer[i * 4], 0, 4);
+				}
+			}
+			return respond(response, buffer, sizeof(buffer));
+		}
+		case MFRC522::PICC_CMD_UL_WRITE:
+			if (length != 6 || data[1] >= _pageCount || !canWrite(data[1])) {
+				return nak(response);
+			}
+			writePage(data[1], &data[2]);
+			processingUs = WRITE_TIME_US;
+			return ack(response);
+		case MFRC522::PICC_CMD_MF_WRITE:
+			if (length != 2 || data[1] >= _pageCount || !canWrite(data[1])) {
+				return nak(response);
+			}
+			_compatWritePage = data[1];
+			return ack(response);
+		default:
+			return nak(response);
+	}
+} // End command()
+
+void VirtualUltralight::deselect() {
+	_compatWritePage = -1;
+} // End deselect()
+
+/**
+ * Lock bytes and the OTP page can only be set, all other pages are overwritten.
+ */
+void VirtualUltralight::writePage(byte target, const byte *data) {
+	if (target == 2) {
+		page(2)[2] |= data[2];
+		page(2)[3] |= data[3];
+	}
+	else if (target == 3) {
+		for (byte i = 0; i < 4; i++) {
+			page(3)[i] |= data[i];
+		}
+	}
+	else {
+		memcpy(page(target), data, 4);
+	}
+} // End writePage()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// MIFARE Ultralight C
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Constructor.
+ * Without a key the factory key is used. Memory protection is disabled (AUTH0 = 30h).
+ */
+VirtualUltralightC::VirtualUltralightC(const byte uid[7], const byte *key)
+		: VirtualUltralight(uid, 48), _authStep(AUTH_NONE), _authenticated(false) {
+	static const byte factoryKey[16] = {	0x49, 0x45, 0x4D, 0x4B, 0x41, 0x45, 0x52, 0x42,
+											0x21, 0x4E, 0x41, 0x43, 0x55, 0x4F, 0x59, 0x46 };
+	setKey(key ? key : factoryKey);
+	setAuth0(0x30);
+	setAuth1(0x00);
+} // End constructor
+
+void VirtualUltralightC::setKey(const byte key[16]) {
+	memcpy(_key, key, 16);
+} // End setKey()
+
+/**
+ * 3DES mutual authentication, MF0ICU2 section 7.5.5:
+ *		1A 00		->	AF ek(RndB)
+ *		AF ek(RndA || RndB')	->	00 ek(RndA')
+ * CBC with IV 0 for the first message, afterwards the last cipher block sent on air is the IV.
+ */
+bool VirtualUltralightC::command(const byte *data, byte length, Frame &response, uint32_t &processingUs) {
+	if (_compatWritePage < 0) {
+		if (data[0] == MFRC522::PICC_CMD_UL_C_AUTH && length == 2 && data[1] == 0x00) {
+			_authenticated = false;
+			for (byte i = 0; i < 8; i++) {
+				_rndB[i] = nextRandom();
+			}
+			mbedtls_des3_context context;
+			byte iv[8] = { 0 };
+			mbedtls_des3_init(&context);
+			mbedtls_des3_set2key_enc(&context, _key);
+			mbedtls_des3_crypt_cbc(&context, MBEDTLS_DES_ENCRYPT, 8, iv, _rndB, _ekRndB);
+			mbedtls_des3_free(&context);
+			_authStep = AUTH_CHALLENGED;
+			byte answer[9] = { 0xAF };
+			memcpy(&answer[1], _ekRndB, 8);
+			return respond(response, answer, sizeof(answer));
+		}
+		if (data[0] == 0xAF && _authStep == AUTH_CHALLENGED && length == 17) {
+			_authStep = AUTH_NONE;
+			mbedtls_des3_context context;
+			byte iv[8];
+			byte plain[16];
+			memcpy(iv, _ekRndB, 8);
+			mbedtls_des3_init(&context);
+			mbedtls_des3_set2key_dec(&context, _key);
+			mbedtls_des3_crypt_cbc(&context, MBEDTLS_DES_DECRYPT, 16, iv, &data[1], plain);
+			mbedtls_des3_free(&context);
+			// plain = RndA || RndB rotated left by one byte
+			for (byte i = 0; i < 8; i++) {
+				if (plain[8 + i] != _rndB[(i + 1) % 8]) {
+					return nak(response);
+				}
+			}
+			byte rndAC[8];
+			for (byte i = 0; i < 8; i++) {
+				rndAC[i] = plain[(i + 1) % 8];
+			}
+			byte answer[9] = { 0x00 };
+			memcpy(iv, &data[9], 8);
+			mbedtls_des3_init(&context);
+			mbedtls_des3_set2key_enc(&context, _key);
+			mbedtls_des3_crypt_cbc(&context, MBEDTLS_DES_ENCRYPT, 8, iv, rndAC, &answer[1]);
+			mbedtls_des3_free(&context);
+			_authenticated = true;
+			return respond(response, answer, sizeof(answer));
+		}
+	}
+	_authStep = AUTH_NONE;
+	return VirtualUltralight::command(data, length, response, processingUs);
+} // End command()
+
+void VirtualUltralightC::deselect() {
+	VirtualUltralight::deselect();
+	_authStep = AUTH_NONE;
+	_authenticated = false;
+} // End deselect()
+
+bool VirtualUltralightC::isProtected(byte target) const {
+	return target >= _pages[0x2A * 4];
+} // End isProtected()
+
+bool VirtualUltralightC::canRead(byte target) const {
+	bool writeOnly = _pages[0x2B * 4] & 0x01;
+	return !isProtected(target) || writeOnly || _authenticated;
+} // End canRead()
+
+bool VirtualUltralightC::canWrite(byte target) const {
+	return target >= 2 && (!isProtected(target) || _authenticated);
+} // End canWrite()
+
+/**
+ * The key pages 2Ch to 2Fh are write only, see MFRC522::MIFARE_UL_C_WriteKey() for the byte order.
+ */
+void VirtualUltralightC::writePage(byte target, const byte *data) {
+	if (target >= 0x2C && target <= 0x2F) {
+		static const byte highestKeyByte[4] = { 7, 3, 15, 11 };
+		for (byte i = 0; i < 4; i++) {
+			_key[highestKeyByte[target - 0x2C] - i] = data[i];
+		}
+		return;
+	}
+	VirtualUltralight::writePage(target, data);
+} // End writePage()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// NTAG216
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Constructor.
+ * Delivery state: NDEF capability container, no password protection (AUTH0 = FFh), password FFFFFFFFh.
+ */
+VirtualNtag216::VirtualNtag216(const byte uid[7])
+		: VirtualUltralight(uid, 231), _authenticated(false) {
+	static const byte capabilityContainer[4] = { 0xE1, 0x10, 0x6D, 0x00 };
+	memcpy(page(3), capabilityContainer, 4);
+	page(CFG0)[3] = 0xFF;
+	memset(page(PWD), 0xFF, 4);
+} // End constructor
+
+void VirtualNtag216::setPassword(const byte password[4], const byte pack[2], byte auth0, bool protectRead) {
+	memcpy(page(PWD), password, 4);
+	memcpy(page(PACK), pack, 2);
+	page(CFG0)[3] = auth0;
+	page(CFG1)[0] = protectRead ? 0x80 : 0x00;	// ACCESS.PROT
+} // End setPassword()
+
+/**
+ * GET_VERSION, FAST_READ and PWD_AUTH, NTAG213/215/216 datasheet section 10.
+ */
+bool VirtualNtag216::command(const byte *data, byte length, Frame &response, uint32_t &processingUs) {
+	if (_compatWritePage < 0) {
+		switch (data[0]) {
+			case 0x60: {	// GET_VERSION
+				static const byte version[8] = { 0x00, 0x04, 0x04, 0x02, 0x01, 0x00, 0x13, 0x03 };
+				if (length != 1) {
+					return nak(response);
+				}
+				return respond(response, version, sizeof(version));
+			}
+			case MFRC522::PICC_CMD_UL_FAST_READ: {
+				byte start = data[1];
+				byte end = data[2];
+				if (length != 3 || start > end || end >= _pageCount) {
+					return nak(response);
+				}
+				for (uint16_t current = start; current <= end; current++) {
+					if (!canRead(current)) {
+						return nak(response);
+					}
+				}
+				for (uint16_t current = start; current <= end; current++) {
+					byte buffer[4];
+					readPage(current, buffer);
+					for (byte i = 0; i < 4; i++) {
+						response.append(buffer[i]);
+					}
+				}
+				response.appendCRC();
+				return true;
+			}
+			case 0x1B:		// PWD_AUTH
+				if (length != 5 || memcmp(&data[1], page(PWD), 4) != 0) {
+					return nak(response);
+				}
+				_authenticated = true;
+				return respond(response, page(PACK), 2);
+		}
+	}
+	return VirtualUltralight::command(data, length, response, processingUs);
+} // End command()
+
+void VirtualNtag216::deselect() {
+	VirtualUltralight::deselect();
+	_authenticated = false;
+} // End deselect()
+
+bool VirtualNtag216::isProtected(byte target) const {
+	return target >= _pages[CFG0 * 4 + 3];
+} // End isProtected()
+
+bool VirtualNtag216::canRead(byte target) const {
+	bool protectRead = _pages[CFG1 * 4] & 0x80;
+	return !protectRead || !isProtected(target) || _authenticated;
+} // End canRead()
+
+bool VirtualNtag216::canWrite(byte target) const {
+	return target >= 2 && (!isProtected(target) || _authenticated);
+} // End canWrite()
+
+/**
+ * PWD and PACK always read as 00h.
+ */
+void VirtualNtag216::readPage(byte target, byte *data) const {
+	if (target == PWD || target == PACK) {
+		memset(data, 0, 4);
+		return;
+	}
+	VirtualUltralight::readPage(target, data);
+} // End readPage()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// MIFARE Classic 1K
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Constructor.
+ * Block 0 holds UID, BCC, SAK and ATQA, the sector trailers the transport configuration.
+ */
+VirtualClassic1K::VirtualClassic1K(const byte uid[4])
+		: VirtualPicc(uid, 4, 0x0004, 0x08), _authSector(-1), _writeBlock(-1) {
+	static const byte trailer[16] = {	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07,
+										0x80, 0x69, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	memset(_blocks, 0, sizeof(_blocks));
+	memcpy(_blocks[0], uid, 4);
+	_blocks[0][4] = uid[0] ^ uid[1] ^ uid[2] ^ uid[3];
+	_blocks[0][5] = 0x08;
+	_blocks[0][6] = 0x04;
+	for (byte sector = 0; sector < 16; sector++) {
+		memcpy(_blocks[sector * 4 + 3], trailer, 16);
+	}
+} // End constructor
+
+/**
+ * Checks key A or key B of the sector holding blockAddr and the UID the reader used.
+ * On success the PICC expects Crypto1 encrypted frames until it leaves state ACTIVE.
+ */
+bool VirtualClassic1K::mifareAuthenticate(byte command, byte blockAddr, const byte *key, const byte *uid4) {
+	if (_state != ACTIVE || blockAddr >= 64 || memcmp(uid4, _uid, 4) != 0 ||
+		(command != MFRC522::PICC_CMD_MF_AUTH_KEY_A && command != MFRC522::PICC_CMD_MF_AUTH_KEY_B)) {
+		return VirtualPicc::mifareAuthenticate(command, blockAddr, key, uid4);
+	}
+	const byte *trailer = _blocks[(blockAddr / 4) * 4 + 3];
+	const byte *sectorKey = (command == MFRC522::PICC_CMD_MF_AUTH_KEY_A) ? &trailer[0] : &trailer[10];
+	if (memcmp(key, sectorKey, MFRC522::MF_KEY_SIZE) != 0) {
+		return VirtualPicc::mifareAuthenticate(command, blockAddr, key, uid4);
+	}
+	_authSector = blockAddr / 4;
+	return true;
+} // End mifareAuthenticate()
+
+bool VirtualClassic1K::command(const byte *data, byte length, Frame &response, uint32_t &processingUs) {
+	// Second part of a WRITE: the 16 data bytes
+	if (_writeBlock >= 0) {
+		byte target = _writeBlock;
+		_writeBlock = -1;
+		if (length != 16) {
+			return nak(response, 0x4);
+		}
+		memcpy(_blocks[target], data, 16);
+		processingUs = WRITE_TIME_US;
+		return ack(response);
+	}
+
+	byte target = data[1];
+	bool allowed = _authSector >= 0 && length == 2 && target < 64 && target / 4 == _authSector;
+	switch (data[0]) {
+		case MFRC522::PICC_CMD_MF_READ: {
+			if (!allowed) {
+				return nak(response, 0x4);
+			}
+			byte buffer[16];
+			memcpy(buffer, _blocks[target], 16);
+			if (target % 4 == 3) {
+				memset(buffer, 0, MFRC522::MF_KEY_SIZE);	// Key A is never readable
+			}
+			return respond(response, buffer, sizeof(buffer));
+		}
+		case MFRC522::PICC_CMD_MF_WRITE:
+			if (!allowed || target == 0) {	// Block 0 is read only
+				return nak(response, 0x4);
+			}
+			_writeBlock = target;
+			return ack(response);
+		default:
+			return nak(response, 0x4);
+	}
+} // End command()
+
+void VirtualClassic1K::deselect() {
+	_authSector = -1;
+	_writeBlock = -1;
+} // End deselect()
@@ -0,0 +1,194 @@
+/**
+ * VirtualPicc.h - PICCs for the MFRC522Emulator.
+ *
+ * VirtualPicc implements the ISO/IEC 14443-3 type A state machine (IDLE, READY, ACTIVE, HALT), REQA/WUPA,
+ * bit oriented anticollision and SELECT for 4 and 7 byte UIDs and HLTA. Frames in state ACTIVE with a valid
+ * CRC_A are handed to command() of the concrete PICC:
+ * 		VirtualUltralightC	MF0ICU2, 48 pages, 3DES authentication, AUTH0/AUTH1 protection
+ * 		VirtualNtag216		NTAG216, 231 pages, GET_VERSION, FAST_READ, PWD_AUTH with PACK
+ * 		VirtualClassic1K	MF1S503x, 64 blocks, MFAuthent with key A/B, READ and WRITE
+ *
+ * Crypto1 is not modelled on air: the emulator hands key and UID of the MFAuthent command to the PICC and
+ * afterwards passes frames in plain text while MFCrypto1On is set.
+ */
+#ifndef VirtualPicc_h
+#define VirtualPicc_h
+
+#include "MFRC522Emulator.h"
+
+class VirtualPicc {
+public:
+	typedef MFRC522Emulator::Frame Frame;
+
+	enum State { POWER_OFF, IDLE, READY, ACTIVE, HALT };
+
+	VirtualPicc(const byte *uid, byte uidSize, uint16_t atqa, byte sak);
+	virtual ~VirtualPicc() {}
+
+	State state() const { return _state; }
+	const byte *uid() const { return _uid; }
+	byte uidSize() const { return _uidSize; }
+
+	// RF link to the PCD, eg for the distance to the antenna. Answers only reach the PCD with an RxGain of at least
+	// minGainDb, above maxGainDb the receiver is overdriven and gets a bit error. The PICC only decodes frames sent
+	// with a ModWidthReg value from minModWidth to maxModWidth. The defaults accept every setting.
+	void setLink(byte minGainDb, byte maxGainDb, byte minModWidth = 0x00, byte maxModWidth = 0x3F);
+	// Extra time the PICC needs for every answer, the PCD timer has to wait for it
+	void setResponseDelay(uint32_t us) { _responseDelayUs = us; }
+	bool hears(byte modWidth) const { return modWidth >= _minModWidth && modWidth <= _maxModWidth; }
+	bool heardWith(byte gainDb) const { return gainDb >= _minGainDb; }
+	bool overdrivenWith(byte gainDb) const { return gainDb > _maxGainDb; }
+	uint32_t responseDelay() const { return _responseDelayUs; }
+
+	// Called by the emulator
+	void setPowered(bool powered);
+	bool receive(const Frame &frame, bool crypto1, Frame &response, uint32_t &processingUs);
+	virtual bool mifareAuthenticate(byte command, byte blockAddr, const byte *key, const byte *uid4);
+
+protected:
+	// True while the PICC expects Crypto1 encrypted frames
+	virtual bool crypto1Active() const { return false; }
+	// Handles a frame in state ACTIVE. The CRC_A is already checked and removed.
+	// Returns false if the PICC does not answer.
+	virtual bool command(const byte *data, byte length, Frame &response, uint32_t &processingUs) = 0;
+	// Called when the PICC leaves state ACTIVE, drops authentication and pending commands.
+	virtual void deselect() {}
+
+	// Helpers for command()
+	static bool respond(Frame &response, const byte *data, byte length);	// Appends CRC_A
+	static bool ack(Frame &response);
+	bool nak(Frame &response, byte code = 0x0);									// Also returns to IDLE
+	byte nextRandom();
+
+	byte _uid[10];
+	byte _uidSize;
+	uint16_t _atqa;
+	byte _sak;
+	State _state;
+	byte _cascadeLevel;		// Cascade level in state READY, 1 based
+	bool _halted;			// Return to HALT instead of IDLE after leaving READY
+	uint32_t _random;
+	byte _minGainDb;
+	byte _maxGainDb;
+	byte _minModWidth;
+	byte _maxModWidth;
+	uint32_t _responseDelayUs;
+
+private:
+	bool anticollision(const Frame &frame, Frame &response);
+	void levelBytes(byte level, byte cl[5]) const;
+};
+
+/**
+ * Common part of the MIFARE Ultralight family: 4 byte pages, READ, WRITE, COMPATIBILITY WRITE.
+ */
+class VirtualUltralight : public VirtualPicc {
+public:
+	VirtualUltralight(const byte uid[7], byte pageCount, uint16_t atqa = 0x0044);
+
+	byte pageCount() const { return _pageCount; }
+	byte *page(byte page) { return &_pages[page * 4]; }
+
+protected:
+	virtual bool command(const byte *data, byte length, Frame &response, uint32_t &processingUs);
+	virtual void deselect();
+	virtual byte readablePages() const { return _pageCount; }	// READ addresses, beyond that the PICC NAKs
+	virtual bool canRead(byte page) const { (void)page; return true; }
+	virtual bool canWrite(byte page) const { return page >= 2; }
+	virtual void readPage(byte page, byte *data) const { memcpy(data, &_pages[page * 4], 4); }
+	virtual void writePage(byte page, const byte *data);
+
+	static constexpr uint32_t WRITE_TIME_US = 4100;	// EEPROM programming time
+
+	byte _pageCount;
+	std::vector<byte> _pages;
+	int _compatWritePage;	// Page of a pending COMPATIBILITY WRITE, -1 if none
+};
+
+/**
+ * MIFARE Ultralight C (MF0ICU2).
+ * The key is passed in the byte order of MFRC522::MIFARE_UL_C_Auth(), the factory key is "BREAKMEIFYOUCAN!".
+ */
+class VirtualUltralightC : public VirtualUltralight {
+public:
+	VirtualUltralightC(const byte uid[7], const byte *key = nullptr);
+
+	void setKey(const byte key[16]);
+	void setAuth0(byte firstPage) { page(0x2A)[0] = firstPage; }	// First protected page, 0x30 disables protection
+	void setAuth1(byte value) { page(0x2B)[0] = value; }			// Bit 0: 0 read and write protected, 1 write protected
+	bool authenticated() const { return _authenticated; }
+
+protected:
+	virtual bool command(const byte *data, byte length, Frame &response, uint32_t &processingUs);
+	virtual void deselect();
+	virtual byte readablePages() const { return 0x2C; }
+	virtual bool canRead(byte page) const;
+	virtual bool canWrite(byte page) const;
+	virtual void writePage(byte page, const byte *data);
+
+private:
+	bool isProtected(byte page) const;
+
+	enum AuthStep { AUTH_NONE, AUTH_CHALLENGED };
+	byte _key[16];
+	AuthStep _authStep;
+	byte _rndB[8];
+	byte _ekRndB[8];
+	bool _authenticated;
+};
+
+/**
+ * NTAG216 (NT2H1611).
+ */
+class VirtualNtag216 : public VirtualUltralight {
+public:
+	VirtualNtag216(const byte uid[7]);
+
+	// Protection starting at page auth0 with the password and the PACK returned by PWD_AUTH
+	void setPassword(const byte password[4], const byte pack[2], byte auth0, bool protectRead);
+	bool authenticated() const { return _authenticated; }
+
+	static constexpr byte CFG0 = 0xE3;
+	static constexpr byte CFG1 = 0xE4;
+	static constexpr byte PWD = 0xE5;
+	static constexpr byte PACK = 0xE6;
+
+protected:
+	virtual bool command(const byte *data, byte length, Frame &response, uint32_t &processingUs);
+	virtual void deselect();
+	virtual bool canRead(byte page) const;
+	virtual bool canWrite(byte page) const;
+	virtual void readPage(byte page, byte *data) const;
+
+private:
+	bool isProtected(byte page) const;
+
+	bool _authenticated;
+};
+
+/**
+ * MIFARE Classic 1K (MF1S503x). All sectors use the transport configuration: keys FFFFFFFFFFFFh, access bits
+ * FF0780h. Authentication with key A or key B allows reading and writing the data blocks of the sector.
+ */
+class VirtualClassic1K : public VirtualPicc {
+public:
+	VirtualClassic1K(const byte uid[4]);
+
+	byte *block(byte block) { return _blocks[block]; }
+	virtual bool mifareAuthenticate(byte command, byte blockAddr, const byte *key, const byte *uid4);
+	int authenticatedSector() const { return _authSector; }
+
+protected:
+	virtual bool crypto1Active() const { return _authSector >= 0; }
+	virtual bool command(const byte *data, byte length, Frame &response, uint32_t &processingUs);
+	virtual void deselect();
+
+private:
+	static constexpr uint32_t WRITE_TIME_US = 2500;
+
+	byte _blocks[64][16];
+	int _authSector;		// -1 if not authenticated
+	int _writeBlock;		// Block of a pending WRITE, -1 if none
+};
+
+#endif
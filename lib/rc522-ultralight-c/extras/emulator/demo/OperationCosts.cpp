@@ -0,0 +1,108 @@
+/*
+ * OperationCosts.cpp - Prints the SPI and RF cost of the high-level operations of the MFRC522 library.
+ *
+ * Build from the library root:
+ * 		g++ -std=c++11 -Iextras/emulator -Isrc src/MFRC522.cpp src/des.c extras/emulator/MFRC522Emulator.cpp \
+ * 			extras/emulator/VirtualPicc.cpp extras/emulator/ArduinoHost.cpp extras/emulator/demo/OperationCosts.cpp \
+ * 			-o operation_costs
+ * Compile with -DMFRC522_CRC_MODE=MFRC522_CRC_HARDWARE to compare against the CRC coprocessor.
+ */
+
+#include "MFRC522Emulator.h"
+#include "VirtualPicc.h"
+
+static const byte CS_PIN = 10;
+
+static MFRC522Emulator emulator(CS_PIN);
+static MFRC522 mfrc522(CS_PIN, MFRC522::UNUSED_PIN);
+
+static void report(const char *operation, MFRC522::StatusCode status, const MFRC522Emulator::Stats &stats) {
+	printf("%-30s %-26s %5u %6u %4u %9.1f %9.1f\n", operation, reinterpret_cast<const char *>(MFRC522::GetStatusCodeName(status)),
+		stats.transactions, stats.bytes, stats.rfFrames, stats.busTimeNs / 1000.0, stats.elapsedNs / 1000.0);
+}
+
+// Runs operation and reports its status together with the emulator counters
+template <typename Operation>
+static void measure(const char *name, Operation operation) {
+	MFRC522::StatusCode status = MFRC522::STATUS_OK;
+	MFRC522Emulator::Stats stats = emulator.measure([&]() { status = operation(); });
+	report(name, status, stats);
+}
+
+static void activate() {
+	Serial.output = nullptr;
+	mfrc522.PICC_IsNewCardPresent();
+	mfrc522.PICC_ReadCardSerial();
+	Serial.output = stdout;
+}
+
+int main() {
+	static const byte ulcUid[7] = { 0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x80 };
+	static const byte ntagUid[7] = { 0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0x81 };
+	static const byte classicUid[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+	byte ulcKey[16] = {	0x49, 0x45, 0x4D, 0x4B, 0x41, 0x45, 0x52, 0x42,
+						0x21, 0x4E, 0x41, 0x43, 0x55, 0x4F, 0x59, 0x46 };
+	byte password[4] = { 0x12, 0x34, 0x56, 0x78 };
+	byte pack[2] = { 0xAB, 0xCD };
+	byte buffer[64];
+	byte bufferSize;
+
+	VirtualUltralightC ulc(ulcUid);
+	VirtualNtag216 ntag(ntagUid);
+	VirtualClassic1K classic(classicUid);
+	ntag.setPassword(password, pack, 0x04, true);
+
+	printf("%-30s %-26s %5s %6s %4s %9s %9s\n", "operation", "status", "xfers", "bytes", "rf", "bus [us]", "time [us]");
+	measure("PCD_Init", [&]() { mfrc522.PCD_Init(); return MFRC522::STATUS_OK; });
+	measure("PICC_IsNewCardPresent", [&]() { return mfrc522.PICC_IsNewCardPresent() ? MFRC522::STATUS_OK : MFRC522::STATUS_TIMEOUT; });
+
+	// MIFARE Ultralight C
+	emulator.addPicc(&ulc);
+	measure("PICC_IsNewCardPresent", [&]() { return mfrc522.PICC_IsNewCardPresent() ? MFRC522::STATUS_OK : MFRC522::STATUS_TIMEOUT; });
+	measure("PICC_Select (7 byte UID)", [&]() { return mfrc522.PICC_Select(&mfrc522.uid); });
+	measure("MIFARE_UL_C_Auth", [&]() { return mfrc522.MIFARE_UL_C_Auth(ulcKey); });
+	measure("ReadPages 8 (READ)", [&]() { return mfrc522.MIFARE_Ultralight_ReadPages(0x20, 8, buffer, sizeof(buffer), false); });
+	measure("ReadPages 8 (FAST_READ NAK)", [&]() { return mfrc522.MIFARE_Ultralight_ReadPages(0x20, 8, buffer, sizeof(buffer)); });
+	measure("MIFARE_Ultralight_Write", [&]() { return mfrc522.MIFARE_Ultralight_Write(0x20, buffer, 4); });
+	measure("PICC_HaltA", [&]() { return mfrc522.PICC_HaltA(); });
+	emulator.removePicc(&ulc);
+
+	// NTAG216
+	emulator.addPicc(&ntag);
+	activate();
+	measure("MIFARE_Ultralight_GetVersion", [&]() { bufferSize = sizeof(buffer); return mfrc522.MIFARE_Ultralight_GetVersion(buffer, &bufferSize); });
+	measure("PCD_NTAG216_AUTH", [&]() {
+		byte pACK[2];
+		MFRC522::StatusCode status = mfrc522.PCD_NTAG216_AUTH(password, pACK);
+		return (status == MFRC522::STATUS_OK && memcmp(pACK, pack, 2) != 0) ? MFRC522::STATUS_ERROR : status;
+	});
+	measure("ReadPages 8 (FAST_READ)", [&]() { return mfrc522.MIFARE_Ultralight_ReadPages(0x04, 8, buffer, sizeof(buffer)); });
+	measure("MIFARE_Ultralight_FastRead 15", [&]() { bufferSize = sizeof(buffer); return mfrc522.MIFARE_Ultralight_FastRead(0x04, 0x12, buffer, &bufferSize); });
+	measure("MIFARE_Read", [&]() { bufferSize = sizeof(buffer); return mfrc522.MIFARE_Read(0x04, buffer, &bufferSize); });
+	emulator.removePicc(&ntag);
+
+	// MIFARE Classic 1K
+	emulator.addPicc(&classic);
+	activate();
+	MFRC522::MIFARE_Key key;
+	memset(key.keyByte, 0xFF, sizeof(key.keyByte));
+	measure("PCD_Authenticate", [&]() { return mfrc522.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, 4, &key, &mfrc522.uid); });
+	measure("MIFARE_Read", [&]() { bufferSize = sizeof(buffer); return mfrc522.MIFARE_Read(4, buffer, &bufferSize); });
+	measure("MIFARE_Write", [&]() { return mfrc522.MIFARE_Write(5, buffer, 16); });
+	measure("PICC_HaltA", [&]() { return mfrc522.PICC_HaltA(); });
+	mfrc522.PCD_StopCrypto1();
+	emulator.removePicc(&classic);
+
+	// Two PICCs in the field
+	emulator.addPicc(&ulc);
+	emulator.addPicc(&classic);
+	measure("PICC_IsNewCardPresent (2)", [&]() { return mfrc522.PICC_IsNewCardPresent() ? MFRC522::STATUS_OK : MFRC522::STATUS_TIMEOUT; });
+	measure("PICC_Select (collision)", [&]() { return mfrc522.PICC_Select(&mfrc522.uid); });
+	MFRC522::Uid uids[4];
+	byte uidCount;
+	measure("PICC_Enumerate (2)", [&]() { uidCount = 4; return mfrc522.PICC_Enumerate(uids, &uidCount); });
+	measure("PICC_SelectByUid", [&]() { return mfrc522.PICC_SelectByUid(&uids[uidCount - 1]); });
+
+	measure("PCD_PerformSelfTest", [&]() { return mfrc522.PCD_PerformSelfTest() ? MFRC522::STATUS_OK : MFRC522::STATUS_ERROR; });
+	return 0;
+}
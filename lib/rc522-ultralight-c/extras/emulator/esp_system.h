@@ -0,0 +1,12 @@
+/**
+ * esp_system.h - Random numbers of the ESP-IDF for host builds. Reproducible, see randomSeed().
+ */
+#ifndef esp_system_h
+#define esp_system_h
+
+#include <Arduino.h>
+
+uint32_t esp_random(void);
+void esp_fill_random(void *buf, size_t len);
+
+#endif
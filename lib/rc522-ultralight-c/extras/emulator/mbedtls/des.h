@@ -0,0 +1,4 @@
+/**
+ * mbedtls/des.h - Host builds use the DES implementation bundled with the library.
+ */
+#include "../../../src/des.h"
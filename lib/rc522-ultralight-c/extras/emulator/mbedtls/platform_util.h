@@ -0,0 +1,16 @@
+/**
+ * mbedtls/platform_util.h - The part used by the bundled DES implementation, for host builds.
+ */
+#ifndef MBEDTLS_PLATFORM_UTIL_H
+#define MBEDTLS_PLATFORM_UTIL_H
+
+#include <string.h>
+
+static inline void mbedtls_platform_zeroize(void *buf, size_t len) {
+	volatile unsigned char *p = (volatile unsigned char *)buf;
+	while (len--) {
+		*p++ = 0;
+	}
+}
+
+#endif
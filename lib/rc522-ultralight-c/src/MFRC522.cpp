@@ -6,20 +6,7 @@
 
 #include <Arduino.h>
 #include "MFRC522.h"
-#include "des.h"
-
-void MFRC522::debug(String str) {
-    Serial.print("[RC522] ");
-    Serial.println(str);
-}
-
-void MFRC522::dump_byte_array(byte *buffer, byte bufferSize) {
-    for (byte i = 0; i < bufferSize; i++) {
-        Serial.print(buffer[i] < 0x10 ? " 0" : " ");
-        Serial.print(buffer[i], HEX);
-    }
-    Serial.println();
-}
+#include "mfrc522_log.h"
 
 /////////////////////////////////////////////////////////////////////////////////////
 // Functions for setting up the Arduino
@@ -47,6 +34,13 @@ MFRC522::MFRC522(	byte chipSelectPin,		///< Arduino pin connected to MFRC522's S
 				) {
 	_chipSelectPin = chipSelectPin;
 	_resetPowerDownPin = resetPowerDownPin;
+	_modWidth = 0x26;
+	_timeoutMs = 25;
+	_selectCollision = false;
+	_ulcKeyScheduleUses = 0;
+	for (byte i = 0; i < MFRC522_UL_C_KEY_CACHE_SIZE; i++) {
+		_ulcKeySchedules[i].valid = false;
+	}
 } // End constructor
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -163,7 +157,9 @@ void MFRC522::PCD_ClearRegisterBitMask(	PCD_Register reg,	///< The register to u
 
 
 /**
- * Use the CRC coprocessor in the MFRC522 to calculate a CRC_A.
+ * Calculates a CRC_A.
+ * Depending on MFRC522_CRC_MODE this uses the CRC coprocessor in the MFRC522 or CalculateCRC_A() on the host.
+ * The software variants cannot fail and save all SPI traffic of the coprocessor round trip.
  * 
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
@@ -171,6 +167,10 @@ MFRC522::StatusCode MFRC522::PCD_CalculateCRC(	byte *data,		///< In: Pointer to
 												byte length,	///< In: The number of bytes to transfer.
 												byte *result	///< Out: Pointer to result buffer. Result is written to result[0..1], low byte first.
 					 ) {
+#if MFRC522_CRC_MODE != MFRC522_CRC_HARDWARE
+	CalculateCRC_A(data, length, result);
+	return STATUS_OK;
+#else
 	PCD_WriteRegister(CommandReg, PCD_Idle);		// Stop any active command.
 	PCD_WriteRegister(DivIrqReg, 0x04);				// Clear the CRCIRq interrupt request bit
 	PCD_WriteRegister(FIFOLevelReg, 0x80);			// FlushBuffer = 1, FIFO initialization
@@ -194,6 +194,7 @@ MFRC522::StatusCode MFRC522::PCD_CalculateCRC(	byte *data,		///< In: Pointer to
 	}
 	// 89ms passed and nothing happend. Communication with the MFRC522 might be down.
 	return STATUS_TIMEOUT;
+#endif
 } // End PCD_CalculateCRC()
 
 
@@ -235,15 +236,14 @@ void MFRC522::PCD_Init() {
 	PCD_WriteRegister(TxModeReg, 0x00);
 	PCD_WriteRegister(RxModeReg, 0x00);
 	// Reset ModWidthReg
-	PCD_WriteRegister(ModWidthReg, 0x26);
+	PCD_WriteRegister(ModWidthReg, _modWidth);
 
 	// When communicating with a PICC we need a timeout if something goes wrong.
 	// f_timer = 13.56 MHz / (2*TPreScaler+1) where TPreScaler = [TPrescaler_Hi:TPrescaler_Lo].
 	// TPrescaler_Hi are the four low bits in TModeReg. TPrescaler_Lo is TPrescalerReg.
 	PCD_WriteRegister(TModeReg, 0x80);			// TAuto=1; timer starts automatically at the end of the transmission in all communication modes at all speeds
 	PCD_WriteRegister(TPrescalerReg, 0xA9);		// TPreScaler = TModeReg[3..0]:TPrescalerReg, ie 0x0A9 = 169 => f_timer=40kHz, ie a timer period of 25μs.
-	PCD_WriteRegister(TReloadRegH, 0x03);		// Reload timer with 0x3E8 = 1000, ie 25ms before timeout.
-	PCD_WriteRegister(TReloadRegL, 0xE8);
+	PCD_SetTimeout(_timeoutMs);					// Reload timer with 40 periods per ms, 25ms by default.
 	
 	PCD_WriteRegister(TxASKReg, 0x40);		// Default 0x00. Force a 100 % ASK modulation independent of the ModGsPReg register setting
 	PCD_WriteRegister(ModeReg, 0x3D);		// Default 0x3F. Set the preset value for the CRC coprocessor for the CalcCRC command to 0x6363 (ISO 14443-3 part 6.2.4)
@@ -332,6 +332,38 @@ void MFRC522::PCD_SetAntennaGain(byte mask) {
 	}
 } // End PCD_SetAntennaGain()
 
+/**
+ * Set the width of the modulation pause at 106 kBd, ModWidthReg. The default 0x26 gives a pause of 39 / fc = 2.9 μs.
+ * ISO/IEC 14443-2 allows 28 / fc to 40.5 / fc, ie values from 0x1B to 0x27.
+ * The value is kept and written again whenever the library switches back to 106 kBd, eg by PCD_Init() or PICC_Select().
+ */
+void MFRC522::PCD_SetModWidth(byte modWidth) {
+	_modWidth = modWidth;
+	PCD_WriteRegister(ModWidthReg, modWidth);
+} // End PCD_SetModWidth()
+
+/**
+ * Set the time the timer waits for the answer of a PICC, 25ms by default. The timer runs at 40kHz, see PCD_Init().
+ * The value is kept and written again by PCD_Init().
+ */
+void MFRC522::PCD_SetTimeout(uint16_t ms) {
+	if (ms == 0 || ms > 1638) {	// TReloadReg is 16 bit
+		ms = 25;
+	}
+	_timeoutMs = ms;
+	PCD_WriteTimerReload(ms);
+} // End PCD_SetTimeout()
+
+/**
+ * Writes the timer reload value for a timeout of ms without changing the timeout set by PCD_SetTimeout().
+ * Used to shorten the timer for single frames, write _timeoutMs again afterwards.
+ */
+void MFRC522::PCD_WriteTimerReload(uint16_t ms) {
+	uint16_t reload = ms * 40;
+	PCD_WriteRegister(TReloadRegH, reload >> 8);
+	PCD_WriteRegister(TReloadRegL, reload & 0xFF);
+} // End PCD_WriteTimerReload()
+
 /**
  * Performs a self-test of the MFRC522
  * See 16.1.1 in http://www.nxp.com/documents/data_sheet/MFRC522.pdf
@@ -499,20 +531,26 @@ MFRC522::StatusCode MFRC522::PCD_CommunicateWithPICC(	byte command,		///< The co
 	
 	// Wait for the command to complete.
 	// In PCD_Init() we set the TAuto flag in TModeReg. This means the timer automatically starts when the PCD stops transmitting.
-	// Each iteration of the do-while-loop takes 17.86μs.
-	// TODO check/modify for other architectures than Arduino Uno 16bit
-	uint16_t i;
-	for (i = 2000; i > 0; i--) {
+	// The deadline is based on the time instead of a number of polls, a poll takes 17.86μs on an Arduino Uno but only a few μs on faster SPI buses.
+	// After MFRC522_POLL_SPIN_US the polls are 1 ms apart, so waiting for the timer does not keep the SPI bus and the CPU busy.
+	const uint32_t start = micros();
+	const uint32_t deadline = millis() + _timeoutMs + 11;
+	bool completed = false;
+	do {
 		byte n = PCD_ReadRegister(ComIrqReg);	// ComIrqReg[7..0] bits are: Set1 TxIRq RxIRq IdleIRq HiAlertIRq LoAlertIRq ErrIRq TimerIRq
 		if (n & waitIRq) {					// One of the interrupts that signal success has been set.
+			completed = true;
 			break;
 		}
-		if (n & 0x01) {						// Timer interrupt - nothing received in 25ms
+		if (n & 0x01) {						// Timer interrupt - nothing received within the timeout
 			return STATUS_TIMEOUT;
 		}
-	}
-	// 35.7ms and nothing happend. Communication with the MFRC522 might be down.
-	if (i == 0) {
+		if ((uint32_t)(micros() - start) >= MFRC522_POLL_SPIN_US) {
+			delay(1);
+		}
+	} while ((int32_t)(millis() - deadline) < 0);
+	// The timer should have fired long ago. Communication with the MFRC522 might be down.
+	if (!completed) {
 		return STATUS_TIMEOUT;
 	}
 	
@@ -619,6 +657,21 @@ MFRC522::StatusCode MFRC522::PICC_REQA_or_WUPA(	byte command, 		///< The command
 	return STATUS_OK;
 } // End PICC_REQA_or_WUPA()
 
+/**
+ * Transmits REQA or WUPA with the timer set to MFRC522_SHORT_TIMEOUT_MS, for polls that usually stay unanswered.
+ * 
+ * @return STATUS_OK on success, STATUS_TIMEOUT if no PICC answered, STATUS_??? otherwise.
+ */
+MFRC522::StatusCode MFRC522::PICC_ProbeA(	byte command, 		///< The command to send - PICC_CMD_REQA or PICC_CMD_WUPA
+											byte *bufferATQA,	///< The buffer to store the ATQA (Answer to request) in
+											byte *bufferSize	///< Buffer size, at least two bytes. Also number of bytes returned if STATUS_OK.
+										) {
+	PCD_WriteTimerReload(MFRC522_SHORT_TIMEOUT_MS);
+	MFRC522::StatusCode result = PICC_REQA_or_WUPA(command, bufferATQA, bufferSize);
+	PCD_WriteTimerReload(_timeoutMs);
+	return result;
+} // End PICC_ProbeA()
+
 /**
  * Transmits SELECT/ANTICOLLISION commands to select a single PICC.
  * Before calling this function the PICCs must be placed in the READY(*) state by calling PICC_RequestA() or PICC_WakeupA().
@@ -685,6 +738,7 @@ MFRC522::StatusCode MFRC522::PICC_Select(	Uid *uid,			///< Pointer to Uid struct
 	
 	// Prepare MFRC522
 	PCD_ClearRegisterBitMask(CollReg, 0x80);		// ValuesAfterColl=1 => Bits received after collision are cleared.
+	_selectCollision = false;
 	
 	// Repeat Cascade Level loop until we have a complete UID.
 	uidComplete = false;
@@ -778,6 +832,7 @@ MFRC522::StatusCode MFRC522::PICC_Select(	Uid *uid,			///< Pointer to Uid struct
 			// Transmit the buffer and receive the response.
 			result = PCD_TransceiveData(buffer, bufferUsed, responseBuffer, &responseLength, &txLastBits, rxAlign);
 			if (result == STATUS_COLLISION) { // More than one PICC in the field => collision.
+				_selectCollision = true;
 				byte valueOfCollReg = PCD_ReadRegister(CollReg); // CollReg[7..0] bits are: ValuesAfterColl reserved CollPosNotValid CollPos[4:0]
 				if (valueOfCollReg & 0x20) { // CollPosNotValid
 					return STATUS_COLLISION; // Without a valid collision position we cannot continue
@@ -786,7 +841,10 @@ MFRC522::StatusCode MFRC522::PICC_Select(	Uid *uid,			///< Pointer to Uid struct
 				if (collisionPos == 0) {
 					collisionPos = 32;
 				}
-				if (collisionPos <= currentLevelKnownBits) { // No progress - should not happen 
+				// CollPos counts from the first bit of the first received byte, including the RxAlign bits we sent
+				// ourselves. Make it relative to the start of the Cascade Level again, like currentLevelKnownBits.
+				collisionPos += 8 * (currentLevelKnownBits / 8);
+				if (collisionPos <= currentLevelKnownBits || collisionPos > 32) { // No progress - should not happen 
 					return STATUS_INTERNAL_ERROR;
 				}
 				// Choose the PICC with the bit set.
@@ -870,8 +928,10 @@ MFRC522::StatusCode MFRC522::PICC_HaltA() {
 	// The standard says:
 	//		If the PICC responds with any modulation during a period of 1 ms after the end of the frame containing the
 	//		HLTA command, this response shall be interpreted as 'not acknowledge'.
-	// We interpret that this way: Only STATUS_TIMEOUT is a success.
+	// We interpret that this way: Only STATUS_TIMEOUT is a success. So there is no point in waiting longer than 1 ms.
+	PCD_WriteTimerReload(MFRC522_SHORT_TIMEOUT_MS);
 	result = PCD_TransceiveData(buffer, sizeof(buffer), nullptr, 0);
+	PCD_WriteTimerReload(_timeoutMs);
 	if (result == STATUS_TIMEOUT) {
 		return STATUS_OK;
 	}
@@ -881,6 +941,136 @@ MFRC522::StatusCode MFRC522::PICC_HaltA() {
 	return result;
 } // End PICC_HaltA()
 
+/**
+ * Finds all PICCs in the field.
+ * A single PICC is found without switching the field: HLTA, WUPA and one anticollision that sees no collision.
+ * The HLTA returns PICCs in state READY or ACTIVE to IDLE/HALT first, e.g. after PICC_IsNewCardPresent(), so every
+ * PICC in the field answers the WUPA.
+ * With several PICCs the RF field is switched off and on, so every PICC starts in state IDLE. A PICC woken from HALT
+ * by WUPA would return to HALT after losing the anticollision and miss the following rounds.
+ * Every round selects the PICC that wins the anticollision and sends it to state HALT, so it no longer answers the
+ * REQA of the next round. The rounds end when no PICC answers anymore.
+ * HLTA and the REQA/WUPA polls, which end unanswered, wait MFRC522_SHORT_TIMEOUT_MS instead of the PCD_SetTimeout().
+ * Afterwards all found PICCs are in state HALT, use PICC_SelectByUid() to continue with one of them. If active is given
+ * and only one PICC was found, that PICC stays in state ACTIVE and *active is set, there is no need to select it again.
+ * 
+ * @return STATUS_OK if at least one PICC was found, STATUS_TIMEOUT if there is none, STATUS_NO_ROOM if there are more PICCs than *count, STATUS_??? otherwise.
+ */
+MFRC522::StatusCode MFRC522::PICC_Enumerate(	Uid *uids,		///< Array of Uid structs for the found PICCs.
+												byte *count,	///< In: Number of Uid structs in uids. Out: Number of PICCs found.
+												bool *active	///< nullptr or Out: True if the single found PICC was left in state ACTIVE and is in mfrc522.uid.
+											) {
+	MFRC522::StatusCode result;
+	byte bufferATQA[2];
+	byte bufferSize;
+	byte maxCount;
+	byte found = 0;
+	byte failures = 0;
+	
+	if (uids == nullptr || count == nullptr || *count == 0) {
+		return STATUS_NO_ROOM;
+	}
+	maxCount = *count;
+	*count = 0;
+	if (active) {
+		*active = false;
+	}
+	
+	// Reset baud rates and ModWidthReg, the anticollision runs at 106 kBd
+	PCD_WriteRegister(TxModeReg, 0x00);
+	PCD_WriteRegister(RxModeReg, 0x00);
+	PCD_WriteRegister(ModWidthReg, _modWidth);
+	
+	// Single PICC: no power cycle. HLTA returns PICCs in state READY or ACTIVE to IDLE/HALT, so all answer the WUPA.
+	PICC_HaltA();
+	bufferSize = sizeof(bufferATQA);
+	result = PICC_ProbeA(PICC_CMD_WUPA, bufferATQA, &bufferSize);
+	if (result == STATUS_TIMEOUT) {
+		return STATUS_TIMEOUT;
+	}
+	if (result == STATUS_OK) { // No collision in the ATQA
+		result = MFRC522::PICC_Select(&uids[0]); // Only ISO/IEC 14443-3, no RATS from MFRC522Extended
+		if (result == STATUS_OK && !_selectCollision) {
+			*count = 1;
+			if (active) {
+				uid = uids[0];
+				*active = true;
+			}
+			else {
+				PICC_HaltA();
+			}
+			return STATUS_OK;
+		}
+	}
+	
+	// Power cycle the PICCs: at least 5.1 ms without field (ISO/IEC 14443-2 t_RESET), 5 ms field before the first REQA
+	PCD_AntennaOff();
+	delay(6);
+	PCD_AntennaOn();
+	delay(5);
+	bufferSize = sizeof(bufferATQA);
+	result = PICC_ProbeA(PICC_CMD_REQA, bufferATQA, &bufferSize);
+	
+	while (true) {
+		if (result == STATUS_TIMEOUT) {
+			break; // No PICC left in state IDLE
+		}
+		if (result != STATUS_OK && result != STATUS_COLLISION) {
+			return result;
+		}
+		if (found == maxCount) {
+			*count = found;
+			return STATUS_NO_ROOM;
+		}
+		
+		result = MFRC522::PICC_Select(&uids[found]); // Only ISO/IEC 14443-3, no RATS from MFRC522Extended
+		if (result == STATUS_OK) {
+			PICC_HaltA();
+			found++;
+		}
+		else if (++failures > 2) { // A failed PICC returns to IDLE and takes part in the next round again
+			*count = found;
+			return result;
+		}
+		
+		bufferSize = sizeof(bufferATQA);
+		result = PICC_ProbeA(PICC_CMD_REQA, bufferATQA, &bufferSize);
+	}
+	
+	*count = found;
+	return found ? STATUS_OK : STATUS_TIMEOUT;
+} // End PICC_Enumerate()
+
+/**
+ * Selects the PICC with a known UID, e.g. one returned by PICC_Enumerate().
+ * Wakes up all PICCs in the field, also those in state HALT. Only the PICC with the UID gets to state ACTIVE,
+ * the other PICCs return to state IDLE/HALT.
+ * Like PICC_Enumerate() this stays on ISO/IEC 14443-3 level, also in MFRC522Extended: no RATS is sent.
+ * 
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+MFRC522::StatusCode MFRC522::PICC_SelectByUid(Uid *uid	///< The UID to select. uid->size must be set, uid->sak is updated.
+											) {
+	MFRC522::StatusCode result;
+	byte bufferATQA[2];
+	byte bufferSize = sizeof(bufferATQA);
+	
+	// Back to 106 kBd, an ISO/IEC 14443-4 session may have switched the bit rate
+	PCD_WriteRegister(TxModeReg, 0x00);
+	PCD_WriteRegister(RxModeReg, 0x00);
+	PCD_WriteRegister(ModWidthReg, _modWidth);
+	
+	result = PICC_WakeupA(bufferATQA, &bufferSize);
+	if (result == STATUS_TIMEOUT) { // PICCs in state READY or ACTIVE only return to IDLE on the first WUPA
+		bufferSize = sizeof(bufferATQA);
+		result = PICC_WakeupA(bufferATQA, &bufferSize);
+	}
+	if (result != STATUS_OK && result != STATUS_COLLISION) {
+		return result;
+	}
+	return MFRC522::PICC_Select(uid, 8 * uid->size);
+} // End PICC_SelectByUid()
+
 /////////////////////////////////////////////////////////////////////////////////////
 // Functions for communicating with MIFARE PICCs
 /////////////////////////////////////////////////////////////////////////////////////
@@ -1043,10 +1233,175 @@ MFRC522::StatusCode MFRC522::MIFARE_Ultralight_Write(	byte page, 		///< The page
 	return STATUS_OK;
 } // End MIFARE_Ultralight_Write()
 
+/**
+ * Reads the pages startPage to endPage from the active NTAG21x or MIFARE Ultralight EV1 PICC in a single frame.
+ * 
+ * MIFARE Ultralight and Ultralight C do not know FAST_READ. They answer with a NAK and fall back to state IDLE,
+ * which also ends a previous authentication.
+ * 
+ * The buffer must be at least 4 * (endPage - startPage + 1) + 2 bytes because a CRC_A is also returned.
+ * At most UL_FAST_READ_MAX_PAGES pages can be read per call because the response must fit in the FIFO.
+ * Checks the CRC_A before returning STATUS_OK.
+ * 
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+MFRC522::StatusCode MFRC522::MIFARE_Ultralight_FastRead(	byte startPage,		///< The first page to return data from.
+															byte endPage,		///< The last page to return data from.
+															byte *buffer,		///< The buffer to store the data in
+															byte *bufferSize	///< Buffer size, at least 4 bytes per page plus 2. Also number of bytes returned if STATUS_OK.
+														) {
+	MFRC522::StatusCode result;
+	
+	// Sanity check
+	if (endPage < startPage || endPage - startPage >= UL_FAST_READ_MAX_PAGES) {
+		return STATUS_INVALID;
+	}
+	byte expected = 4 * (endPage - startPage + 1) + 2;
+	if (buffer == nullptr || *bufferSize < expected) {
+		return STATUS_NO_ROOM;
+	}
+	
+	// Build command buffer
+	buffer[0] = PICC_CMD_UL_FAST_READ;
+	buffer[1] = startPage;
+	buffer[2] = endPage;
+	// Calculate CRC_A
+	result = PCD_CalculateCRC(buffer, 3, &buffer[3]);
+	if (result != STATUS_OK) {
+		return result;
+	}
+	
+	// Transmit the buffer and receive the response, validate CRC_A.
+	result = PCD_TransceiveData(buffer, 5, buffer, bufferSize, nullptr, 0, true);
+	if (result != STATUS_OK) {
+		return result;
+	}
+	if (*bufferSize != expected) {
+		return STATUS_ERROR;
+	}
+	return STATUS_OK;
+} // End MIFARE_Ultralight_FastRead()
+
+/**
+ * Reads the version information of the active NTAG21x or MIFARE Ultralight EV1 PICC, eg. to tell it from an Ultralight C
+ * which has the same SAK. The 8 bytes are fixed header, vendor ID (04h NXP), product type (03h Ultralight EV1, 04h NTAG),
+ * product subtype, major and minor product version, storage size and protocol type.
+ * 
+ * MIFARE Ultralight and Ultralight C do not know GET_VERSION. They answer with a NAK and fall back to state IDLE.
+ * 
+ * The buffer must be at least 10 bytes because a CRC_A is also returned. Checks the CRC_A before returning STATUS_OK.
+ * 
+ * @return STATUS_OK on success, STATUS_MIFARE_NACK if the PICC does not know GET_VERSION, STATUS_??? otherwise.
+ */
+MFRC522::StatusCode MFRC522::MIFARE_Ultralight_GetVersion(	byte *buffer,		///< The buffer to store the data in
+															byte *bufferSize	///< Buffer size, at least 10 bytes. Also number of bytes returned if STATUS_OK.
+														) {
+	MFRC522::StatusCode result;
+	
+	if (buffer == nullptr || *bufferSize < 10) {
+		return STATUS_NO_ROOM;
+	}
+	
+	buffer[0] = PICC_CMD_UL_GET_VERSION;
+	result = PCD_CalculateCRC(buffer, 1, &buffer[1]);
+	if (result != STATUS_OK) {
+		return result;
+	}
+	
+	result = PCD_TransceiveData(buffer, 3, buffer, bufferSize, nullptr, 0, true);
+	if (result != STATUS_OK) {
+		return result;
+	}
+	if (*bufferSize != 10) {
+		return STATUS_ERROR;
+	}
+	return STATUS_OK;
+} // End MIFARE_Ultralight_GetVersion()
+
+/**
+ * Reads pageCount pages starting at startPage from the active MIFARE Ultralight or NTAG PICC into buffer.
+ * 
+ * With useFastRead the pages are fetched with FAST_READ, one RF exchange per UL_FAST_READ_MAX_PAGES pages.
+ * If the PICC rejects FAST_READ it is reactivated with WUPA and SELECT of the UID in the member variable uid
+ * and the pages are read with READ, one RF exchange per 4 pages. Any authentication is lost in this case,
+ * so pass useFastRead = false for PICCs known not to support it, eg. an authenticated Ultralight C.
+ * 
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+MFRC522::StatusCode MFRC522::MIFARE_Ultralight_ReadPages(	byte startPage,		///< The first page to read.
+															byte pageCount,		///< The number of 4 byte pages to read.
+															byte *buffer,		///< The buffer to store the data in. No CRC_A is stored.
+															byte bufferSize,	///< Buffer size, at least 4 * pageCount bytes.
+															bool useFastRead	///< True => Try FAST_READ first. Default true.
+														) {
+	MFRC522::StatusCode result;
+	byte frame[4 * UL_FAST_READ_MAX_PAGES + 2];
+	byte frameSize;
+	byte done = 0;		// Pages copied to buffer
+	
+	// Sanity check
+	if (buffer == nullptr || pageCount == 0 || bufferSize < 4 * pageCount) {
+		return STATUS_NO_ROOM;
+	}
+	
+	if (useFastRead) {
+		while (done < pageCount) {
+			byte chunk = pageCount - done;
+			if (chunk > UL_FAST_READ_MAX_PAGES) {
+				chunk = UL_FAST_READ_MAX_PAGES;
+			}
+			frameSize = sizeof(frame);
+			result = MIFARE_Ultralight_FastRead(startPage + done, startPage + done + chunk - 1, frame, &frameSize);
+			if (result != STATUS_OK) {
+				break;
+			}
+			memcpy(&buffer[4 * done], frame, 4 * chunk);
+			done += chunk;
+		}
+		if (done == pageCount) {
+			return STATUS_OK;
+		}
+		if (done > 0 || (result != STATUS_MIFARE_NACK && result != STATUS_TIMEOUT)) {
+			return result; // The PICC knows FAST_READ, this is a real error.
+		}
+		
+		// FAST_READ is not supported. The PICC went to IDLE, wake and select it again before using READ.
+		if (uid.size == 0) {
+			return result;
+		}
+		byte bufferATQA[2];
+		byte bufferATQASize = sizeof(bufferATQA);
+		result = PICC_WakeupA(bufferATQA, &bufferATQASize);
+		if (result != STATUS_OK) {
+			return result;
+		}
+		result = PICC_Select(&uid, 8 * uid.size);
+		if (result != STATUS_OK) {
+			return result;
+		}
+	}
+	
+	// READ returns 4 pages per exchange.
+	while (done < pageCount) {
+		byte chunk = pageCount - done;
+		if (chunk > 4) {
+			chunk = 4;
+		}
+		frameSize = sizeof(frame);
+		result = MIFARE_Read(startPage + done, frame, &frameSize);
+		if (result != STATUS_OK) {
+			return result;
+		}
+		memcpy(&buffer[4 * done], frame, 4 * chunk);
+		done += chunk;
+	}
+	return STATUS_OK;
+} // End MIFARE_Ultralight_ReadPages()
+
 void MFRC522::sample() {
 	byte key[16] = {0x49, 0x45, 0x4D, 0x4B, 0x41, 0x45, 0x52, 0x42, 0x21, 0x4E, 0x41, 0x43, 0x55, 0x4F, 0x59, 0x46};
 
-	debug("BLA");
+	MFRC522_LOG_DEBUG(F("BLA"));
 
     byte rndB[8] = {0x51, 0xE7, 0x64, 0x60, 0x26, 0x78, 0xDF, 0x2B};
     
@@ -1063,16 +1418,16 @@ void MFRC522::sample() {
     mbedtls_des3_set2key_enc(&des, key);
     mbedtls_des3_crypt_cbc(&des, MBEDTLS_DES_ENCRYPT, 8, ivPicc, rndB, ekRndB);
 
-    debug("ekRndB: ");
-    dump_byte_array(ekRndB, 8);
+    MFRC522_LOG_DEBUG(F("ekRndB: "));
+    MFRC522_LOG_DUMP(ekRndB, 8);
 
     // decrypt
     mbedtls_des3_init(&des);
     mbedtls_des3_set2key_dec(&des, key);
     mbedtls_des3_crypt_cbc(&des, MBEDTLS_DES_DECRYPT, 8, ivPcd, ekRndB, dekRndB);
 
-    debug("dekRndB: ");
-    dump_byte_array(dekRndB, 8);
+    MFRC522_LOG_DEBUG(F("dekRndB: "));
+    MFRC522_LOG_DUMP(dekRndB, 8);
 
     // rotate and concatenate
     byte rndARndBC[16] = {0xA8, 0xAF, 0x3B, 0x25, 0x6C, 0x75, 0xED, 0x40, 
@@ -1080,11 +1435,11 @@ void MFRC522::sample() {
     memcpy(&rndARndBC[8], &dekRndB[1],7);  // bytes 1 to 7
     rndARndBC[15] = dekRndB[0];           // byte 0
 
-    debug("rndARndBC: ");
-    dump_byte_array(rndARndBC, 16);
+    MFRC522_LOG_DEBUG(F("rndARndBC: "));
+    MFRC522_LOG_DUMP(rndARndBC, 16);
 
-    debug("ivPcd: ");
-    dump_byte_array(ivPcd, 8);
+    MFRC522_LOG_DEBUG(F("ivPcd: "));
+    MFRC522_LOG_DUMP(ivPcd, 8);
 
     // encrypt
     byte ekRndARndBC[16];
@@ -1092,18 +1447,21 @@ void MFRC522::sample() {
     mbedtls_des3_set2key_enc(&des, key);
     mbedtls_des3_crypt_cbc(&des, MBEDTLS_DES_ENCRYPT, 16, ivPcd, rndARndBC, ekRndARndBC);
 
-    debug("ekRndARndBC: ");
-    dump_byte_array(ekRndARndBC, 16);
+    MFRC522_LOG_DEBUG(F("ekRndARndBC: "));
+    MFRC522_LOG_DUMP(ekRndARndBC, 16);
 }
 
 /**
  * Authenticates agains the active MIFARE Ultralight C PICC.
+ * The random challenge RndA should come from a hardware RNG. If none is supplied random() is used,
+ * which is the hardware RNG on ESP32 but a PRNG on other architectures.
  */
-MFRC522::StatusCode MFRC522::MIFARE_UL_C_Auth(	byte *key ///< The 3DES key. Exactly 16 byte long.
+MFRC522::StatusCode MFRC522::MIFARE_UL_C_Auth(	byte *key,			///< The 3DES key. Exactly 16 byte long.
+												const byte *rndA	///< The 8 byte random challenge RndA. Default nullptr.
 									) {
 	MFRC522::StatusCode result;
 
-	debug("MIFARE_UL_C_Auth");
+	MFRC522_LOG_DEBUG(F("MIFARE_UL_C_Auth"));
 
 	if (key == nullptr) {
 		return STATUS_INVALID;
@@ -1129,52 +1487,57 @@ MFRC522::StatusCode MFRC522::MIFARE_UL_C_Auth(	byte *key ///< The 3DES key. Exac
 	sendLen += 2;
 
 	// send #1
-	debug("Sending (#1)...");
-	dump_byte_array(cmdBuffer, sendLen);
+	MFRC522_LOG_DEBUG(F("Sending (#1)..."));
+	MFRC522_LOG_DUMP(cmdBuffer, sendLen);
 	waitIRq = 0x30;		// RxIRq and IdleIRq
 	cmdBufferSize = 64;
 	validBits = 0;
 	result = PCD_CommunicateWithPICC(PCD_Transceive, waitIRq, cmdBuffer, sendLen, cmdBuffer, &cmdBufferSize, &validBits);
 	if (result != STATUS_OK) {
-		debug("ERROR: Could not transceive (#1).");
+		MFRC522_LOG_ERROR(F("Could not transceive (#1)."));
 		return result;
 	}
-	debug("recieved (#2): ");
-	dump_byte_array(cmdBuffer, cmdBufferSize);
+	MFRC522_LOG_DEBUG(F("recieved (#2): "));
+	MFRC522_LOG_DUMP(cmdBuffer, cmdBufferSize);
 
 	if (cmdBuffer[0] != 0xAF) {
-		debug("ERROR: received (#2) does not start with 0xAF.");
+		MFRC522_LOG_ERROR(F("received (#2) does not start with 0xAF."));
 		return STATUS_ERROR;
 	}
 	if (cmdBufferSize != 11) {
-		debug("ERROR: received (#2) is not of length 11.");
+		MFRC522_LOG_ERROR(F("received (#2) is not of length 11."));
 		return STATUS_ERROR;
 	}
 
 	byte ekRndB[8];
 	memcpy(ekRndB, cmdBuffer + 1, 8);
-	debug("ek(RndB)");
-	dump_byte_array(ekRndB, 8);
+	MFRC522_LOG_DEBUG(F("ek(RndB)"));
+	MFRC522_LOG_DUMP(ekRndB, 8);
 
 	// build command buffer #3
 
 	byte ivPcd[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
     byte dekRndB[8];
 
-    mbedtls_des3_context des;
+	// The key schedules are derived once per key and reused for all three cipher operations below.
+	MIFARE_UL_C_KeySchedule *schedule = MIFARE_UL_C_GetKeySchedule(key);
 
 	// decrypt
-    mbedtls_des3_init(&des);
-    mbedtls_des3_set2key_dec(&des, key);
-    mbedtls_des3_crypt_cbc(&des, MBEDTLS_DES_DECRYPT, 8, ivPcd, ekRndB, dekRndB);
+    mbedtls_des3_crypt_cbc(&schedule->dec, MBEDTLS_DES_DECRYPT, 8, ivPcd, ekRndB, dekRndB);
 
-    debug("dekRndB: ");
-    dump_byte_array(dekRndB, 8);
+    MFRC522_LOG_DEBUG(F("dekRndB: "));
+    MFRC522_LOG_DUMP(dekRndB, 8);
 
 	// generate rndA
-    byte rndA[8] = {0xA8, 0xAF, 0x3B, 0x25, 0x6C, 0x75, 0xED, 0x40};
-    debug("rndA: ");
-    dump_byte_array(rndA, 8);
+	byte randomA[8];
+	if (rndA == nullptr) {
+		for (byte i = 0; i < 8; i++) {
+			randomA[i] = random(0x100);
+		}
+		rndA = randomA;
+	}
+    MFRC522_LOG_DEBUG(F("rndA: "));
+    MFRC522_LOG_DUMP(rndA, 8);
 
     // rotate and concatenate
     byte rndARndBC[16];
@@ -1182,20 +1545,18 @@ MFRC522::StatusCode MFRC522::MIFARE_UL_C_Auth(	byte *key ///< The 3DES key. Exac
     memcpy(&rndARndBC[8], &dekRndB[1],7);  // bytes 1 through 7
     rndARndBC[15] = dekRndB[0];            // byte 0
 
-    debug("rndARndBC: ");
-    dump_byte_array(rndARndBC, 16);
+    MFRC522_LOG_DEBUG(F("rndARndBC: "));
+    MFRC522_LOG_DUMP(rndARndBC, 16);
 
-    debug("ivPcd: ");
-    dump_byte_array(ivPcd, 8);
+    MFRC522_LOG_DEBUG(F("ivPcd: "));
+    MFRC522_LOG_DUMP(ivPcd, 8);
 
     // encrypt
     byte ekRndARndBC[16];
-    mbedtls_des3_init(&des);
-    mbedtls_des3_set2key_enc(&des, key);
-    mbedtls_des3_crypt_cbc(&des, MBEDTLS_DES_ENCRYPT, 16, ivPcd, rndARndBC, ekRndARndBC);
+    mbedtls_des3_crypt_cbc(&schedule->enc, MBEDTLS_DES_ENCRYPT, 16, ivPcd, rndARndBC, ekRndARndBC);
 
-    debug("ekRndARndBC: ");
-    dump_byte_array(ekRndARndBC, 16);
+    MFRC522_LOG_DEBUG(F("ekRndARndBC: "));
+    MFRC522_LOG_DUMP(ekRndARndBC, 16);
 
 	// finally build #3
 	memset(cmdBuffer, 0, 64);
@@ -1211,18 +1572,18 @@ MFRC522::StatusCode MFRC522::MIFARE_UL_C_Auth(	byte *key ///< The 3DES key. Exac
 	sendLen += 2;
 
 	// send #3
-	debug("Sending (#3)...");
-	dump_byte_array(cmdBuffer, sendLen);
+	MFRC522_LOG_DEBUG(F("Sending (#3)..."));
+	MFRC522_LOG_DUMP(cmdBuffer, sendLen);
 	waitIRq = 0x30;		// RxIRq and IdleIRq
 	cmdBufferSize = 64;
 	validBits = 0;
 	result = PCD_CommunicateWithPICC(PCD_Transceive, waitIRq, cmdBuffer, sendLen, cmdBuffer, &cmdBufferSize, &validBits);
 	if (result != STATUS_OK) {
-		debug("ERROR: Could not transceive (#3).");
+		MFRC522_LOG_ERROR(F("Could not transceive (#3)."));
 		return result;
 	}
-	debug("recieved (#4): ");
-	dump_byte_array(cmdBuffer, cmdBufferSize);
+	MFRC522_LOG_DEBUG(F("recieved (#4): "));
+	MFRC522_LOG_DUMP(cmdBuffer, cmdBufferSize);
 
 	// fake decipher
     memcpy(ivPcd, &ekRndARndBC[8], 8);
@@ -1231,27 +1592,64 @@ MFRC522::StatusCode MFRC522::MIFARE_UL_C_Auth(	byte *key ///< The 3DES key. Exac
     byte rndAC[8];
     memcpy(&rndAC, &rndA[1], 7);
     rndAC[7] = rndA[0];
-    debug("rndAC");
-    dump_byte_array(rndAC, 8);
+    MFRC522_LOG_DEBUG(F("rndAC"));
+    MFRC522_LOG_DUMP(rndAC, 8);
 
     // encrypt to verify
     byte ekRndAC[8];
-    mbedtls_des3_init(&des);
-    mbedtls_des3_set2key_enc(&des, key);
-    mbedtls_des3_crypt_cbc(&des, MBEDTLS_DES_ENCRYPT, 8, ivPcd, rndAC, ekRndAC);
+    mbedtls_des3_crypt_cbc(&schedule->enc, MBEDTLS_DES_ENCRYPT, 8, ivPcd, rndAC, ekRndAC);
 
-    debug("ekRndAC: ");
-    dump_byte_array(ekRndAC, 8);
+    MFRC522_LOG_DEBUG(F("ekRndAC: "));
+    MFRC522_LOG_DUMP(ekRndAC, 8);
 
 	// actually verify
-	if (memcmp(&cmdBuffer[1], &ekRndAC, 8) == 0) {
-		debug("AUTHENTICATION SUCCESSFULL");
+	if (cmdBufferSize >= 9 && memcmp(&cmdBuffer[1], &ekRndAC, 8) == 0) {
+		MFRC522_LOG_DEBUG(F("AUTHENTICATION SUCCESSFULL"));
 		return STATUS_OK;
 	} else {
 		return STATUS_ERROR;
 	}
 }
 
+/**
+ * Returns the cached 3DES key schedules for an Ultralight C key.
+ * On a miss the least recently used entry is replaced. Deriving a 2-key 3DES schedule
+ * costs several times more than encrypting a block, so repeated taps of the same card
+ * or a fixed key only pay for it once.
+ */
+MFRC522::MIFARE_UL_C_KeySchedule *MFRC522::MIFARE_UL_C_GetKeySchedule(	const byte *key ///< The 3DES key. Exactly 16 byte long.
+									) {
+	MIFARE_UL_C_KeySchedule *entry = &_ulcKeySchedules[0];
+	_ulcKeyScheduleUses++;
+	for (byte i = 0; i < MFRC522_UL_C_KEY_CACHE_SIZE; i++) {
+		MIFARE_UL_C_KeySchedule *candidate = &_ulcKeySchedules[i];
+		if (candidate->valid && memcmp(candidate->key, key, 16) == 0) {
+			candidate->lastUsed = _ulcKeyScheduleUses;
+			return candidate;
+		}
+		if (!candidate->valid || (entry->valid && candidate->lastUsed < entry->lastUsed)) {
+			entry = candidate;
+		}
+	}
+	
+	mbedtls_des3_init(&entry->enc);
+	mbedtls_des3_init(&entry->dec);
+	mbedtls_des3_set2key_enc(&entry->enc, key);
+#if MFRC522_PLATFORM_DES
+	mbedtls_des3_set2key_dec(&entry->dec, key);
+#else
+	// The EDE decryption schedule is the encryption schedule with the round key pairs in reverse order.
+	for (byte i = 0; i < 96; i += 2) {
+		entry->dec.sk[i]     = entry->enc.sk[94 - i];
+		entry->dec.sk[i + 1] = entry->enc.sk[95 - i];
+	}
+#endif
+	memcpy(entry->key, key, 16);
+	entry->valid = true;
+	entry->lastUsed = _ulcKeyScheduleUses;
+	return entry;
+} // End MIFARE_UL_C_GetKeySchedule()
+
 /**
  * Writes new key to MIFARE Ultralight C PICC.
  */
@@ -1274,12 +1672,12 @@ MFRC522::StatusCode MFRC522::MIFARE_UL_C_WriteKey(	byte *key ///< The 3DES key.
 	writeBuffer[1] = key[6];
 	writeBuffer[2] = key[5];
 	writeBuffer[3] = key[4];
-	debug("2C ");
-	dump_byte_array(writeBuffer, 4);
+	MFRC522_LOG_DEBUG(F("2C "));
+	MFRC522_LOG_DUMP(writeBuffer, 4);
 	status = MIFARE_Ultralight_Write(0x2C, writeBuffer, 4);
     if (status != MFRC522::STATUS_OK) {
-        debug("WriteKey (page 0x2C) failed: ");
-        debug(MFRC522::GetStatusCodeName(status));
+        MFRC522_LOG_ERROR(F("WriteKey (page 0x2C) failed: "));
+        MFRC522_LOG_ERROR(MFRC522::GetStatusCodeName(status));
         return status;
     }
 
@@ -1288,12 +1686,12 @@ MFRC522::StatusCode MFRC522::MIFARE_UL_C_WriteKey(	byte *key ///< The 3DES key.
 	writeBuffer[1] = key[2];
 	writeBuffer[2] = key[1];
 	writeBuffer[3] = key[0];
-	debug("2D ");
-	dump_byte_array(writeBuffer, 4);
+	MFRC522_LOG_DEBUG(F("2D "));
+	MFRC522_LOG_DUMP(writeBuffer, 4);
 	status = MIFARE_Ultralight_Write(0x2D, writeBuffer, 4);
     if (status != MFRC522::STATUS_OK) {
-        debug("WriteKey (page 0x2D) failed: ");
-        debug(MFRC522::GetStatusCodeName(status));
+        MFRC522_LOG_ERROR(F("WriteKey (page 0x2D) failed: "));
+        MFRC522_LOG_ERROR(MFRC522::GetStatusCodeName(status));
         return status;
     }
 
@@ -1302,12 +1700,12 @@ MFRC522::StatusCode MFRC522::MIFARE_UL_C_WriteKey(	byte *key ///< The 3DES key.
 	writeBuffer[1] = key[14];
 	writeBuffer[2] = key[13];
 	writeBuffer[3] = key[12];
-	debug("2E ");
-	dump_byte_array(writeBuffer, 4);
+	MFRC522_LOG_DEBUG(F("2E "));
+	MFRC522_LOG_DUMP(writeBuffer, 4);
 	status = MIFARE_Ultralight_Write(0x2E, writeBuffer, 4);
     if (status != MFRC522::STATUS_OK) {
-        debug("WriteKey (page 0x2E) failed: ");
-        debug(MFRC522::GetStatusCodeName(status));
+        MFRC522_LOG_ERROR(F("WriteKey (page 0x2E) failed: "));
+        MFRC522_LOG_ERROR(MFRC522::GetStatusCodeName(status));
         return status;
     }
 
@@ -1316,12 +1714,12 @@ MFRC522::StatusCode MFRC522::MIFARE_UL_C_WriteKey(	byte *key ///< The 3DES key.
 	writeBuffer[1] = key[10];
 	writeBuffer[2] = key[9];
 	writeBuffer[3] = key[8];
-	debug("2F ");
-	dump_byte_array(writeBuffer, 4);
+	MFRC522_LOG_DEBUG(F("2F "));
+	MFRC522_LOG_DUMP(writeBuffer, 4);
 	status = MIFARE_Ultralight_Write(0x2F, writeBuffer, 4);
     if (status != MFRC522::STATUS_OK) {
-        debug("WriteKey (page 0x2F) failed: ");
-        debug(MFRC522::GetStatusCodeName(status));
+        MFRC522_LOG_ERROR(F("WriteKey (page 0x2F) failed: "));
+        MFRC522_LOG_ERROR(MFRC522::GetStatusCodeName(status));
         return status;
     }
 	
@@ -1490,13 +1888,12 @@ MFRC522::StatusCode MFRC522::MIFARE_SetValue(byte blockAddr, int32_t value) {
  */
 MFRC522::StatusCode MFRC522::PCD_NTAG216_AUTH(byte* passWord, byte pACK[]) //Authenticate with 32bit password
 {
-	// TODO: Fix cmdBuffer length and rxlength. They really should match.
-	//       (Better still, rxlength should not even be necessary.)
-
 	MFRC522::StatusCode result;
-	byte				cmdBuffer[18]; // We need room for 16 bytes data and 2 bytes CRC_A.
+	byte				cmdBuffer[7];	// PWD_AUTH, 4 bytes password and 2 bytes CRC_A
+	byte				response[4];	// PACK and CRC_A
+	byte				responseSize = sizeof(response);
 	
-	cmdBuffer[0] = 0x1B; //Comando de autentificacion
+	cmdBuffer[0] = PICC_CMD_UL_PWD_AUTH;
 	
 	for (byte i = 0; i<4; i++)
 		cmdBuffer[i+1] = passWord[i];
@@ -1507,19 +1904,17 @@ MFRC522::StatusCode MFRC522::PCD_NTAG216_AUTH(byte* passWord, byte pACK[]) //Aut
 		return result;
 	}
 	
-	// Transceive the data, store the reply in cmdBuffer[]
-	byte waitIRq		= 0x30;	// RxIRq and IdleIRq
-//	byte cmdBufferSize	= sizeof(cmdBuffer);
-	byte validBits		= 0;
-	byte rxlength		= 5;
-	result = PCD_CommunicateWithPICC(PCD_Transceive, waitIRq, cmdBuffer, 7, cmdBuffer, &rxlength, &validBits);
-	
-	pACK[0] = cmdBuffer[0];
-	pACK[1] = cmdBuffer[1];
-	
+	// Transceive the data and validate the CRC_A of the PACK. A wrong password is answered with a NAK.
+	result = PCD_TransceiveData(cmdBuffer, 7, response, &responseSize, nullptr, 0, true);
 	if (result!=STATUS_OK) {
 		return result;
 	}
+	if (responseSize != sizeof(response)) {
+		return STATUS_ERROR;
+	}
+	
+	pACK[0] = response[0];
+	pACK[1] = response[1];
 	
 	return STATUS_OK;
 } // End PCD_NTAG216_AUTH()
@@ -1576,6 +1971,67 @@ MFRC522::StatusCode MFRC522::PCD_MIFARE_Transceive(	byte *sendData,		///< Pointe
 	return STATUS_OK;
 } // End PCD_MIFARE_Transceive()
 
+#if MFRC522_CRC_MODE == MFRC522_CRC_TABLE
+// CRC_A lookup table: x^16 + x^12 + x^5 + 1, bit reversed (0x8408), one entry per input byte.
+static const uint16_t CRC_A_TABLE[256] PROGMEM = {
+	0x0000, 0x1189, 0x2312, 0x329B, 0x4624, 0x57AD, 0x6536, 0x74BF,
+	0x8C48, 0x9DC1, 0xAF5A, 0xBED3, 0xCA6C, 0xDBE5, 0xE97E, 0xF8F7,
+	0x1081, 0x0108, 0x3393, 0x221A, 0x56A5, 0x472C, 0x75B7, 0x643E,
+	0x9CC9, 0x8D40, 0xBFDB, 0xAE52, 0xDAED, 0xCB64, 0xF9FF, 0xE876,
+	0x2102, 0x308B, 0x0210, 0x1399, 0x6726, 0x76AF, 0x4434, 0x55BD,
+	0xAD4A, 0xBCC3, 0x8E58, 0x9FD1, 0xEB6E, 0xFAE7, 0xC87C, 0xD9F5,
+	0x3183, 0x200A, 0x1291, 0x0318, 0x77A7, 0x662E, 0x54B5, 0x453C,
+	0xBDCB, 0xAC42, 0x9ED9, 0x8F50, 0xFBEF, 0xEA66, 0xD8FD, 0xC974,
+	0x4204, 0x538D, 0x6116, 0x709F, 0x0420, 0x15A9, 0x2732, 0x36BB,
+	0xCE4C, 0xDFC5, 0xED5E, 0xFCD7, 0x8868, 0x99E1, 0xAB7A, 0xBAF3,
+	0x5285, 0x430C, 0x7197, 0x601E, 0x14A1, 0x0528, 0x37B3, 0x263A,
+	0xDECD, 0xCF44, 0xFDDF, 0xEC56, 0x98E9, 0x8960, 0xBBFB, 0xAA72,
+	0x6306, 0x728F, 0x4014, 0x519D, 0x2522, 0x34AB, 0x0630, 0x17B9,
+	0xEF4E, 0xFEC7, 0xCC5C, 0xDDD5, 0xA96A, 0xB8E3, 0x8A78, 0x9BF1,
+	0x7387, 0x620E, 0x5095, 0x411C, 0x35A3, 0x242A, 0x16B1, 0x0738,
+	0xFFCF, 0xEE46, 0xDCDD, 0xCD54, 0xB9EB, 0xA862, 0x9AF9, 0x8B70,
+	0x8408, 0x9581, 0xA71A, 0xB693, 0xC22C, 0xD3A5, 0xE13E, 0xF0B7,
+	0x0840, 0x19C9, 0x2B52, 0x3ADB, 0x4E64, 0x5FED, 0x6D76, 0x7CFF,
+	0x9489, 0x8500, 0xB79B, 0xA612, 0xD2AD, 0xC324, 0xF1BF, 0xE036,
+	0x18C1, 0x0948, 0x3BD3, 0x2A5A, 0x5EE5, 0x4F6C, 0x7DF7, 0x6C7E,
+	0xA50A, 0xB483, 0x8618, 0x9791, 0xE32E, 0xF2A7, 0xC03C, 0xD1B5,
+	0x2942, 0x38CB, 0x0A50, 0x1BD9, 0x6F66, 0x7EEF, 0x4C74, 0x5DFD,
+	0xB58B, 0xA402, 0x9699, 0x8710, 0xF3AF, 0xE226, 0xD0BD, 0xC134,
+	0x39C3, 0x284A, 0x1AD1, 0x0B58, 0x7FE7, 0x6E6E, 0x5CF5, 0x4D7C,
+	0xC60C, 0xD785, 0xE51E, 0xF497, 0x8028, 0x91A1, 0xA33A, 0xB2B3,
+	0x4A44, 0x5BCD, 0x6956, 0x78DF, 0x0C60, 0x1DE9, 0x2F72, 0x3EFB,
+	0xD68D, 0xC704, 0xF59F, 0xE416, 0x90A9, 0x8120, 0xB3BB, 0xA232,
+	0x5AC5, 0x4B4C, 0x79D7, 0x685E, 0x1CE1, 0x0D68, 0x3FF3, 0x2E7A,
+	0xE70E, 0xF687, 0xC41C, 0xD595, 0xA12A, 0xB0A3, 0x8238, 0x93B1,
+	0x6B46, 0x7ACF, 0x4854, 0x59DD, 0x2D62, 0x3CEB, 0x0E70, 0x1FF9,
+	0xF78F, 0xE606, 0xD49D, 0xC514, 0xB1AB, 0xA022, 0x92B9, 0x8330,
+	0x7BC7, 0x6A4E, 0x58D5, 0x495C, 0x3DE3, 0x2C6A, 0x1EF1, 0x0F78
+};
+#endif
+
+/**
+ * Calculates a CRC_A (ISO/IEC 14443-3 Annex B) on the host.
+ * Preset 0x6363, no final inversion, same result as the CalcCRC command of the MFRC522 with ModeReg = 0x3D.
+ * Example: HLTA 50h 00h gives 57h CDh.
+ */
+void MFRC522::CalculateCRC_A(	const byte *data,	///< In: Pointer to the data to calculate the CRC_A for.
+								byte length,		///< In: The number of bytes in data.
+								byte *result		///< Out: Pointer to result buffer. Result is written to result[0..1], low byte first.
+							) {
+	uint16_t crc = 0x6363;
+	for (byte i = 0; i < length; i++) {
+#if MFRC522_CRC_MODE == MFRC522_CRC_TABLE
+		crc = (crc >> 8) ^ pgm_read_word(&CRC_A_TABLE[(crc ^ data[i]) & 0xFF]);
+#else
+		byte b = data[i] ^ (byte)(crc & 0xFF);
+		b ^= (byte)(b << 4);
+		crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+#endif
+	}
+	result[0] = crc & 0xFF;
+	result[1] = crc >> 8;
+} // End CalculateCRC_A()
+
 /**
  * Returns a __FlashStringHelper pointer to a status code name.
  * 
@@ -2218,7 +2674,7 @@ bool MFRC522::PICC_IsNewCardPresent() {
 	PCD_WriteRegister(TxModeReg, 0x00);
 	PCD_WriteRegister(RxModeReg, 0x00);
 	// Reset ModWidthReg
-	PCD_WriteRegister(ModWidthReg, 0x26);
+	PCD_WriteRegister(ModWidthReg, _modWidth);
 
 	MFRC522::StatusCode result = PICC_RequestA(bufferATQA, &bufferSize);
 	return (result == STATUS_OK || result == STATUS_COLLISION);
@@ -83,10 +83,47 @@
 #include <Arduino.h>
 #include <SPI.h>
 
+// Use the mbed TLS DES of the platform (eg. ESP-IDF) instead of the bundled des.c for Ultralight C authentication.
+#ifndef MFRC522_PLATFORM_DES
+#define MFRC522_PLATFORM_DES 0
+#endif
+#if MFRC522_PLATFORM_DES
+#include <mbedtls/des.h>
+#else
+#include "des.h"
+#endif
+
+// Number of Ultralight C keys whose 3DES key schedules are kept by MIFARE_UL_C_Auth().
+#ifndef MFRC522_UL_C_KEY_CACHE_SIZE
+#define MFRC522_UL_C_KEY_CACHE_SIZE 2
+#endif
+
+// Timer timeout in ms of the frames that are expected to stay unanswered: HLTA and the REQA/WUPA polls of PICC_Enumerate().
+// ISO/IEC 14443-3 treats any answer within 1 ms after HLTA as NAK, the ATQA follows REQA/WUPA after about 90 us.
+#ifndef MFRC522_SHORT_TIMEOUT_MS
+#define MFRC522_SHORT_TIMEOUT_MS 1
+#endif
+
+// PCD_CommunicateWithPICC() polls ComIrqReg back to back for this long, most PICC answers arrive within it. Afterwards,
+// eg. while the timer runs out for an unanswered REQA, it sleeps 1 ms with delay() between the polls.
+#ifndef MFRC522_POLL_SPIN_US
+#define MFRC522_POLL_SPIN_US 2000
+#endif
+
 #ifndef MFRC522_SPICLOCK
 #define MFRC522_SPICLOCK SPI_CLOCK_DIV4			// MFRC522 accept upto 10MHz
 #endif
 
+// Implementation used by PCD_CalculateCRC() to compute the CRC_A (ISO/IEC 14443-3 Annex B).
+// The CRC coprocessor of the MFRC522 costs 5 register writes, at least one DivIrqReg poll and
+// 2 register reads per call. The software variants give the identical result without touching the SPI bus.
+#define MFRC522_CRC_HARDWARE	0		// Use the CRC coprocessor of the MFRC522
+#define MFRC522_CRC_SOFTWARE	1		// Shift/xor per byte, no table
+#define MFRC522_CRC_TABLE		2		// 256 entry lookup table (512 bytes flash)
+#ifndef MFRC522_CRC_MODE
+#define MFRC522_CRC_MODE MFRC522_CRC_TABLE
+#endif
+
 // Firmware data for self-test
 // Reference values based on firmware version
 // Hint: if needed, you can remove unused self-test data to save flash memory
@@ -278,13 +315,18 @@ public:
 		// The commands used for MIFARE Ultralight (from http://www.nxp.com/documents/data_sheet/MF0ICU1.pdf, Section 8.6)
 		// The PICC_CMD_MF_READ and PICC_CMD_MF_WRITE can also be used for MIFARE Ultralight.
 		PICC_CMD_UL_C_AUTH		= 0x1A,		// Perform authentication agains Ultralight C (MF0ICU2)
-		PICC_CMD_UL_WRITE		= 0xA2		// Writes one 4 byte page to the PICC.
+		PICC_CMD_UL_WRITE		= 0xA2,		// Writes one 4 byte page to the PICC.
+		// The commands used for NTAG21x and MIFARE Ultralight EV1 (from https://www.nxp.com/docs/en/data-sheet/NTAG213_215_216.pdf, Section 10)
+		PICC_CMD_UL_FAST_READ	= 0x3A,		// Reads a range of pages in one frame. Not supported by MIFARE Ultralight and Ultralight C.
+		PICC_CMD_UL_GET_VERSION	= 0x60,		// Returns vendor, product type and storage size. Not supported by MIFARE Ultralight and Ultralight C.
+		PICC_CMD_UL_PWD_AUTH	= 0x1B		// Authenticates with the 32 bit password, the PICC answers with the 16 bit PACK.
 	};
 	
 	// MIFARE constants that does not fit anywhere else
 	enum MIFARE_Misc {
 		MF_ACK					= 0xA,		// The MIFARE Classic uses a 4 bit ACK/NAK. Any other value than 0xA is NAK.
-		MF_KEY_SIZE				= 6			// A Mifare Crypto1 key is 6 bytes.
+		MF_KEY_SIZE				= 6,		// A Mifare Crypto1 key is 6 bytes.
+		UL_FAST_READ_MAX_PAGES	= 15		// Pages per FAST_READ response that fit in the FIFO together with the CRC_A.
 	};
 	
 	// PICC types we can detect. Remember to update PICC_GetTypeName() if you add more.
@@ -328,6 +370,15 @@ public:
 	typedef struct {
 		byte		keyByte[MF_KEY_SIZE];
 	} MIFARE_Key;
+
+	// A struct used for caching the 3DES key schedules of a MIFARE Ultralight C key
+	typedef struct {
+		byte					key[16];
+		bool					valid;
+		uint32_t				lastUsed;
+		mbedtls_des3_context	enc;
+		mbedtls_des3_context	dec;
+	} MIFARE_UL_C_KeySchedule;
 	
 	// Member variables
 	Uid uid;								// Used by PICC_ReadCardSerial().
@@ -363,6 +414,10 @@ public:
 	void PCD_AntennaOff();
 	byte PCD_GetAntennaGain();
 	void PCD_SetAntennaGain(byte mask);
+	byte PCD_GetModWidth() const { return _modWidth; }
+	void PCD_SetModWidth(byte modWidth);
+	uint16_t PCD_GetTimeout() const { return _timeoutMs; }
+	void PCD_SetTimeout(uint16_t ms);
 	bool PCD_PerformSelfTest();
 	
 	/////////////////////////////////////////////////////////////////////////////////////
@@ -381,6 +436,8 @@ public:
 	StatusCode PICC_REQA_or_WUPA(byte command, byte *bufferATQA, byte *bufferSize);
 	virtual StatusCode PICC_Select(Uid *uid, byte validBits = 0);
 	StatusCode PICC_HaltA();
+	StatusCode PICC_Enumerate(Uid *uids, byte *count, bool *active = nullptr);
+	StatusCode PICC_SelectByUid(Uid *uid);
 
 	/////////////////////////////////////////////////////////////////////////////////////
 	// Functions for communicating with MIFARE PICCs
@@ -390,6 +447,9 @@ public:
 	StatusCode MIFARE_Read(byte blockAddr, byte *buffer, byte *bufferSize);
 	StatusCode MIFARE_Write(byte blockAddr, byte *buffer, byte bufferSize);
 	StatusCode MIFARE_Ultralight_Write(byte page, byte *buffer, byte bufferSize);
+	StatusCode MIFARE_Ultralight_FastRead(byte startPage, byte endPage, byte *buffer, byte *bufferSize);
+	StatusCode MIFARE_Ultralight_ReadPages(byte startPage, byte pageCount, byte *buffer, byte bufferSize, bool useFastRead = true);
+	StatusCode MIFARE_Ultralight_GetVersion(byte *buffer, byte *bufferSize);
 	StatusCode MIFARE_Decrement(byte blockAddr, int32_t delta);
 	StatusCode MIFARE_Increment(byte blockAddr, int32_t delta);
 	StatusCode MIFARE_Restore(byte blockAddr);
@@ -401,7 +461,7 @@ public:
 	/////////////////////////////////////////////////////////////////////////////////////
 	// Functions for communicating with MIFARE Ultralight C specifically
 	/////////////////////////////////////////////////////////////////////////////////////
-	StatusCode MIFARE_UL_C_Auth(byte *key);
+	StatusCode MIFARE_UL_C_Auth(byte *key, const byte *rndA = nullptr);
 	StatusCode MIFARE_UL_C_WriteKey(byte *key);
 	
 	/////////////////////////////////////////////////////////////////////////////////////
@@ -415,6 +475,7 @@ public:
 	// old function used too much memory, now name moved to flash; if you need char, copy from flash to memory
 	//const char *PICC_GetTypeName(byte type);
 	static const __FlashStringHelper *PICC_GetTypeName(PICC_Type type);
+	static void CalculateCRC_A(const byte *data, byte length, byte *result);
 	
 	// Support functions for debuging
 	void PCD_DumpVersionToSerial();
@@ -443,12 +504,18 @@ public:
 protected:
 	byte _chipSelectPin;		// Arduino pin connected to MFRC522's SPI slave select input (Pin 24, NSS, active low)
 	byte _resetPowerDownPin;	// Arduino pin connected to MFRC522's reset and power down input (Pin 6, NRSTPD, active low)
+	byte _modWidth;				// ModWidthReg at 106 kBd, restored whenever the library returns to 106 kBd
+	uint16_t _timeoutMs;		// Timeout of the timer for PICC answers
+	bool _selectCollision;		// Set by PICC_Select() if it resolved a collision, ie there were several PICCs in state READY
+	MIFARE_UL_C_KeySchedule _ulcKeySchedules[MFRC522_UL_C_KEY_CACHE_SIZE];	// Cache used by MIFARE_UL_C_Auth()
+	uint32_t _ulcKeyScheduleUses;
+	void PCD_WriteTimerReload(uint16_t ms);
+	StatusCode PICC_ProbeA(byte command, byte *bufferATQA, byte *bufferSize);
 	StatusCode MIFARE_TwoStepHelper(byte command, byte blockAddr, int32_t data);
+	MIFARE_UL_C_KeySchedule *MIFARE_UL_C_GetKeySchedule(const byte *key);
 
 private:
 	void sample();
-	void debug(String str);
-	void dump_byte_array(byte *buffer, byte bufferSize);
 };
 
 #endif
@@ -76,6 +76,7 @@ MFRC522::StatusCode MFRC522Extended::PICC_Select(	Uid *uid,			///< Pointer to Ui
 	
 	// Prepare MFRC522
 	PCD_ClearRegisterBitMask(CollReg, 0x80);		// ValuesAfterColl=1 => Bits received after collision are cleared.
+	_selectCollision = false;
 	
 	// Repeat Cascade Level loop until we have a complete UID.
 	uidComplete = false;
@@ -169,6 +170,7 @@ MFRC522::StatusCode MFRC522Extended::PICC_Select(	Uid *uid,			///< Pointer to Ui
 			// Transmit the buffer and receive the response.
 			result = PCD_TransceiveData(buffer, bufferUsed, responseBuffer, &responseLength, &txLastBits, rxAlign);
 			if (result == STATUS_COLLISION) { // More than one PICC in the field => collision.
+				_selectCollision = true;
 				byte valueOfCollReg = PCD_ReadRegister(CollReg); // CollReg[7..0] bits are: ValuesAfterColl reserved CollPosNotValid CollPos[4:0]
 				if (valueOfCollReg & 0x20) { // CollPosNotValid
 					return STATUS_COLLISION; // Without a valid collision position we cannot continue
@@ -177,7 +179,10 @@ MFRC522::StatusCode MFRC522Extended::PICC_Select(	Uid *uid,			///< Pointer to Ui
 				if (collisionPos == 0) {
 					collisionPos = 32;
 				}
-				if (collisionPos <= currentLevelKnownBits) { // No progress - should not happen 
+				// CollPos counts from the first bit of the first received byte, including the RxAlign bits we sent
+				// ourselves. Make it relative to the start of the Cascade Level again, like currentLevelKnownBits.
+				collisionPos += 8 * (currentLevelKnownBits / 8);
+				if (collisionPos <= currentLevelKnownBits || collisionPos > 32) { // No progress - should not happen 
 					return STATUS_INTERNAL_ERROR;
 				}
 				// Choose the PICC with the bit set.
@@ -587,7 +592,8 @@ MFRC522::StatusCode MFRC522Extended::PICC_PPS(TagBitRates sendBitRate,
 	// Bit 8 - Set to '0' as MFRC522 allows different bit rates for send and receive
 	// Bit 4 - Set to '0' as it is Reserved for future use.
 	//ppsBuffer[2] = (((sendBitRate & 0x03) << 4) | (receiveBitRate & 0x03)) & 0xE7;
-	ppsBuffer[2] = (((sendBitRate & 0x03) << 2) | (receiveBitRate & 0x03)) & 0xE7;
+	// PPS1: b8-b5 RFU, b4-b3 DSI, b2-b1 DRI. Masking with 0xE7 used to clear DSI and requested 106 kBd from the PICC.
+	ppsBuffer[2] = (((sendBitRate & 0x03) << 2) | (receiveBitRate & 0x03)) & 0x0F;
 
 	// Calculate CRC_A
 	result = PCD_CalculateCRC(ppsBuffer, 3, &ppsBuffer[3]);
@@ -636,7 +642,7 @@ MFRC522::StatusCode MFRC522Extended::PICC_PPS(TagBitRates sendBitRate,
 					break;
 				default:
 					{
-						PCD_WriteRegister(ModWidthReg, 0x26); // Default value
+						PCD_WriteRegister(ModWidthReg, _modWidth);
 					}
 					break;
 			}
@@ -821,7 +827,7 @@ MFRC522::StatusCode MFRC522Extended::TCL_Transceive(TagInfo *tag, byte *sendData
 	// Swap block number on success
 	tag->blockNumber = !tag->blockNumber;
 
-	if (backData && (backLen > 0)) {
+	if (backData && backLen) {
 		if (*backLen < in.inf.size)
 			return STATUS_NO_ROOM;
 
@@ -844,7 +850,7 @@ MFRC522::StatusCode MFRC522Extended::TCL_Transceive(TagInfo *tag, byte *sendData
 		if (result != STATUS_OK)
 			return result;
 
-		if (backData && (backLen > 0)) {
+		if (backData && backLen) {
 			if ((*backLen + ackDataSize) > totalBackLen)
 				return STATUS_NO_ROOM;
 
@@ -1107,7 +1113,7 @@ bool MFRC522Extended::PICC_IsNewCardPresent() {
 	PCD_WriteRegister(TxModeReg, 0x00);
 	PCD_WriteRegister(RxModeReg, 0x00);
 	// Reset ModWidthReg
-	PCD_WriteRegister(ModWidthReg, 0x26);
+	PCD_WriteRegister(ModWidthReg, _modWidth);
 
 	MFRC522::StatusCode result = PICC_RequestA(bufferATQA, &bufferSize);
 
@@ -27,7 +27,8 @@
 
 #include "des.h"
 
-#if defined(MBEDTLS_DES_C)
+// Not needed when MFRC522.h is configured to use the DES of the platform
+#if defined(MBEDTLS_DES_C) && !MFRC522_PLATFORM_DES
 
 #include "mbedtls/des.h"
 #include "mbedtls/platform_util.h"
@@ -0,0 +1,46 @@
+/**
+ * Compile time log levels for the MFRC522 library.
+ * Statements above MFRC522_LOG_LEVEL expand to an empty statement: the arguments are not evaluated,
+ * no Arduino String is constructed and the message text is not linked in.
+ * Messages are printed straight from flash, pass them wrapped in F().
+ */
+#ifndef MFRC522_LOG_H
+#define MFRC522_LOG_H
+
+#define MFRC522_LOG_LEVEL_NONE		0	// No output
+#define MFRC522_LOG_LEVEL_ERROR		1	// Failed protocol steps
+#define MFRC522_LOG_LEVEL_DEBUG		2	// Protocol trace
+#define MFRC522_LOG_LEVEL_DUMP		3	// Protocol trace with hex dumps of the frames. Includes key material!
+
+#ifndef MFRC522_LOG_LEVEL
+#define MFRC522_LOG_LEVEL MFRC522_LOG_LEVEL_NONE
+#endif
+
+#define MFRC522_LOG_PRINT(msg)	do { Serial.print(F("[RC522] ")); Serial.println(msg); } while (0)
+
+#if MFRC522_LOG_LEVEL >= MFRC522_LOG_LEVEL_ERROR
+#define MFRC522_LOG_ERROR(msg)	MFRC522_LOG_PRINT(msg)
+#else
+#define MFRC522_LOG_ERROR(msg)	do {} while (0)
+#endif
+
+#if MFRC522_LOG_LEVEL >= MFRC522_LOG_LEVEL_DEBUG
+#define MFRC522_LOG_DEBUG(msg)	MFRC522_LOG_PRINT(msg)
+#else
+#define MFRC522_LOG_DEBUG(msg)	do {} while (0)
+#endif
+
+#if MFRC522_LOG_LEVEL >= MFRC522_LOG_LEVEL_DUMP
+static inline void MFRC522_LogDump(const byte *buffer, byte bufferSize) {
+	for (byte i = 0; i < bufferSize; i++) {
+		Serial.print(buffer[i] < 0x10 ? F(" 0") : F(" "));
+		Serial.print(buffer[i], HEX);
+	}
+	Serial.println();
+}
+#define MFRC522_LOG_DUMP(buffer, size)	MFRC522_LogDump(buffer, size)
+#else
+#define MFRC522_LOG_DUMP(buffer, size)	do {} while (0)
+#endif
+
+#endif // MFRC522_LOG_H
@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""
+Decoder for the binary log frames of FastLogSerialSink
+Reads the serial port (needs pyserial) or a raw capture file, checks the framing and CRC of every frame, formats
+deferred records and events like the firmware does and passes the Serial.print() text between frames through.
+
+Build with FAST_SYSLOG_SERIAL_SINK=1 (env esp32-s3-devkitc-1-seriallog in platformio.ini), then:
+    python3 scripts/serial_log_decode.py --port /dev/ttyUSB0 --save capture.bin
+    python3 scripts/serial_log_decode.py --file capture.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+import time
+
+SYNC = b'\xfe\xfa'
+BOOT, TEXT, DEFERRED, EVENT, FORMAT, SCHEMA = range(1, 7)
+SEVERITIES = ("emerg", "alert", "crit", "err", "warning", "notice", "info", "debug")
+
+# Tags of FastLogArgs in FastSyslog.h
+INT, UINT, DOUBLE, STRING, POINTER, INT32, UINT32 = range(7)
+
+CONVERSION = re.compile(r'%([-+ #0]*\d*(?:\.\d*)?)(?:hh|h|ll|l|L|q|j|z|t)?([diouxXeEfFgGaAcspn%])')
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE"""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def unpack_args(data, pointer_size):
+    """Packed arguments of a deferred record or an event as a list of (tag, value)"""
+    values = []
+    pos = 0
+    while pos < len(data):
+        tag = data[pos]
+        pos += 1
+        if tag == STRING:
+            length = data[pos]
+            values.append((tag, data[pos + 1:pos + 1 + length].decode(errors='replace')))
+            pos += 1 + length
+        elif tag in (INT32, UINT32):
+            values.append((tag, struct.unpack_from('<i' if tag == INT32 else '<I', data, pos)[0]))
+            pos += 4
+        elif tag == POINTER:
+            values.append((tag, int.from_bytes(data[pos:pos + pointer_size], 'little')))
+            pos += pointer_size
+        elif tag in (INT, UINT, DOUBLE):
+            values.append((tag, struct.unpack_from({INT: '<q', UINT: '<Q', DOUBLE: '<d'}[tag], data, pos)[0]))
+            pos += 8
+        else:
+            raise ValueError(f"unknown argument tag {tag}")
+    return values
+
+
+def format_deferred(fmt, values):
+    """Format like FastSyslog::formatDeferred(): each conversion takes the next value, length modifiers are ignored"""
+    values = list(values)
+
+    def convert(match):
+        flags, conversion = match.group(1), match.group(2)
+        if conversion == '%':
+            return '%'
+        if not values:
+            return '?'
+        tag, value = values.pop(0)
+        if tag == STRING:
+            return ('%' + flags + 's') % value
+        if conversion in 'fFeEgGaA':
+            return ('%' + flags + ('f' if conversion in 'aA' else conversion)) % float(value)
+        if conversion == 'p' or tag == POINTER:
+            return '0x%x' % value
+        if conversion == 'c':
+            return chr(int(value) & 0xFF)
+        value = int(value)
+        # A negative int printed with %x or %u shows its 32 bit value like printf does
+        if value < 0 and value >= -2**31 and conversion in 'uxXo':
+            value &= 0xFFFFFFFF
+        return ('%' + flags + {'i': 'd', 'u': 'd', 's': 'd', 'n': 'd'}.get(conversion, conversion)) % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def format_event(name, fields, values):
+    """The SD-ELEMENT of FastSyslog::formatEvent(), without the enterprise number"""
+    parts = [name]
+    for field, (tag, value) in zip(fields, values):
+        if tag == STRING:
+            value = value.replace('\\', '\\\\').replace('"', '\\"').replace(']', '\\]')
+        elif tag == DOUBLE:
+            value = '%g' % value
+        parts.append(f'{field}="{value}"')
+    return '[' + ' '.join(parts) + ']'
+
+
+class Decoder:
+    def __init__(self, out):
+        self.out = out
+        self.buffer = b''
+        self.formats = {}
+        self.schemas = {}
+        self.pointer_size = 4
+        self.sequence = None
+        self.frames = self.records = self.errors = self.gaps = 0
+
+    def feed(self, data):
+        self.buffer += data
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                # Keep a possible first sync byte, the rest is console text
+                keep = 1 if self.buffer.endswith(SYNC[:1]) else 0
+                self.text(self.buffer[:len(self.buffer) - keep])
+                self.buffer = self.buffer[len(self.buffer) - keep:]
+                return
+            self.text(self.buffer[:start])
+            self.buffer = self.buffer[start:]
+
+            header = self.buffer[2:5]
+            if len(header) < 2:
+                return
+            length = header[1]
+            size = 2
+            if length & 0x80:
+                if len(header) < 3:
+                    return
+                length = ((length & 0x7F) << 8) | header[2]
+                size = 3
+            end = 2 + size + length + 2
+            if len(self.buffer) < end:
+                if length > 4096:
+                    self.resync()
+                    continue
+                return
+            body = self.buffer[2:end - 2]
+            crc = struct.unpack_from('<H', self.buffer, end - 2)[0]
+            if crc16(body) != crc:
+                self.resync()
+                continue
+            self.buffer = self.buffer[end:]
+            self.frames += 1
+            try:
+                self.frame(body[0] >> 4, body[0] & 0x07, body[size:])
+            except (ValueError, IndexError, struct.error) as e:
+                self.errors += 1
+                print(f"bad frame: {e}", file=sys.stderr)
+
+    def resync(self):
+        """CRC or length error, the sync bytes were part of something else"""
+        self.errors += 1
+        self.text(self.buffer[:1])
+        self.buffer = self.buffer[1:]
+
+    def text(self, data):
+        if data:
+            self.out.write(data.decode(errors='replace'))
+
+    def frame(self, kind, priority, payload):
+        if kind == BOOT:
+            self.pointer_size = payload[1]
+            self.formats.clear()
+            self.schemas.clear()
+            self.sequence = None
+            self.out.write(f"== boot of {payload[2:].decode(errors='replace')}, frame version {payload[0]}\n")
+        elif kind == FORMAT:
+            self.formats[struct.unpack_from('<I', payload)[0]] = payload[4:].decode(errors='replace')
+        elif kind == SCHEMA:
+            name, fields = payload[1:].split(b'\0', 1)
+            self.schemas[payload[0]] = (name.decode(), fields.decode().split())
+        elif kind in (TEXT, DEFERRED, EVENT):
+            sequence, ms = struct.unpack_from('<HI', payload)
+            body = payload[6:]
+            if kind == TEXT:
+                message = body.decode(errors='replace')
+            elif kind == DEFERRED:
+                fmt = self.formats.get(struct.unpack_from('<I', body)[0])
+                values = unpack_args(body[4:], self.pointer_size)
+                message = format_deferred(fmt, values) if fmt is not None else f"(unknown format) {values}"
+            else:
+                schema = self.schemas.get(body[0])
+                values = unpack_args(body[1:], self.pointer_size)
+                message = format_event(*schema, values) if schema else f"(unknown event {body[0]}) {values}"
+
+            if self.sequence is not None and sequence != (self.sequence + 1) & 0xFFFF:
+                self.gaps += 1
+                self.out.write(f"-- {(sequence - self.sequence - 1) & 0xFFFF} records lost\n")
+            self.sequence = sequence
+            self.records += 1
+            self.out.write(f"{ms / 1000:10.3f} {SEVERITIES[priority]:<7} {message}\n")
+        else:
+            raise ValueError(f"unknown frame kind {kind}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the binary log frames of FastLogSerialSink")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="Serial port, e.g. /dev/ttyUSB0")
+    source.add_argument("--file", help="Raw capture, '-' for stdin")
+    parser.add_argument("--baud", type=int, default=115200, help="Baud rate of the port")
+    parser.add_argument("--save", help="Also write the raw bytes to this file")
+    parser.add_argument("--duration", type=float, default=0, help="Seconds to capture, 0 = until Ctrl-C")
+    args = parser.parse_args()
+
+    decoder = Decoder(sys.stdout)
+    save = open(args.save, 'wb') if args.save else None
+    start = time.time()
+    try:
+        if args.port:
+            import serial
+            with serial.Serial(args.port, args.baud, timeout=0.2) as port:
+                while not args.duration or time.time() - start < args.duration:
+                    data = port.read(4096)
+                    if save:
+                        save.write(data)
+                    decoder.feed(data)
+                    sys.stdout.flush()
+        else:
+            stream = sys.stdin.buffer if args.file == '-' else open(args.file, 'rb')
+            with stream:
+                while True:
+                    data = stream.read(65536)
+                    if not data:
+                        break
+                    if save:
+                        save.write(data)
+                    decoder.feed(data)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if save:
+            save.close()
+
+    print(f"\n{decoder.frames} frames, {decoder.records} records, {decoder.errors} errors, {decoder.gaps} gaps",
+          file=sys.stderr)
+    return 1 if decoder.errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""
+Syslog capture for FastSyslog
+Receives the batched datagrams of the firmware, checks the octet-counted framing (RFC 6587)
+and the RFC 5424 header of every record and reports records per datagram.
+
+Point SYSLOG_SERVER/SYSLOG_PORT in include/secrets.h at this machine, then:
+    python3 scripts/syslog_capture.py --port 5514 --duration 60
+"""
+
+import argparse
+import re
+import socket
+import sys
+import time
+
+# <PRI>VERSION TIMESTAMP HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA MSG
+RECORD = re.compile(rb'^<(\d{1,3})>1 (\S+) (\S+) (\S+) (\S+) (\S+) (-|\[.*?\](?:\[.*?\])*)(?: (.*))?$', re.S)
+
+
+def split_frames(datagram):
+    """Split a datagram into records, raises ValueError on a framing error"""
+    records = []
+    pos = 0
+    while pos < len(datagram):
+        space = datagram.find(b' ', pos)
+        if space < 0 or not datagram[pos:space].isdigit():
+            raise ValueError(f"no octet count at offset {pos}")
+        length = int(datagram[pos:space])
+        start = space + 1
+        if start + length > len(datagram):
+            raise ValueError(f"record at offset {pos} claims {length} bytes, {len(datagram) - start} left")
+        records.append(datagram[start:start + length])
+        pos = start + length
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Capture and check FastSyslog datagrams")
+    parser.add_argument("--bind", default="0.0.0.0", help="Address to listen on")
+    parser.add_argument("--port", type=int, default=514, help="UDP port (SYSLOG_PORT)")
+    parser.add_argument("--duration", type=float, default=0, help="Seconds to capture, 0 = until Ctrl-C")
+    parser.add_argument("--expect", type=int, default=0, help="Stop after this many records")
+    parser.add_argument("--quiet", action="store_true", help="Do not print the records")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    sock.settimeout(0.5)
+
+    datagrams = records = errors = payload = 0
+    largest = 0
+    start = time.time()
+    try:
+        while True:
+            if args.duration and time.time() - start >= args.duration:
+                break
+            if args.expect and records >= args.expect:
+                break
+            try:
+                datagram, sender = sock.recvfrom(65535)
+            except socket.timeout:
+                continue
+
+            datagrams += 1
+            payload += len(datagram)
+            largest = max(largest, len(datagram))
+            try:
+                frames = split_frames(datagram)
+            except ValueError as e:
+                errors += 1
+                print(f"framing error from {sender[0]}: {e}", file=sys.stderr)
+                continue
+
+            for frame in frames:
+                match = RECORD.match(frame)
+                if not match or int(match.group(1)) > 191:
+                    errors += 1
+                    print(f"bad record: {frame!r}", file=sys.stderr)
+                    continue
+                records += 1
+                if not args.quiet:
+                    pri = int(match.group(1))
+                    msg = (match.group(8) or b'').decode(errors='replace')
+                    if match.group(7) != b'-':
+                        # Event: MSGID and structured data, no MSG
+                        msg = f"{match.group(6).decode()} {match.group(7).decode(errors='replace')} {msg}".rstrip()
+                    print(f"{sender[0]} {match.group(3).decode()} sev={pri & 7} {msg}")
+    except KeyboardInterrupt:
+        pass
+
+    print(f"\n{datagrams} datagrams, {records} records, {errors} errors", file=sys.stderr)
+    if datagrams:
+        print(f"{records / datagrams:.2f} records per datagram ({datagrams / max(records, 1):.3f} packets per message), "
+              f"{payload / datagrams:.0f} bytes average, {largest} bytes largest", file=sys.stderr)
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
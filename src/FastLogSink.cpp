@@ -0,0 +1,340 @@
+#include "FastLogSink.h"
+#include "FastSyslog.h"
+
+#define FAST_LOG_FRAME_SYNC0 0xFE  // Never part of UTF-8 text
+#define FAST_LOG_FRAME_SYNC1 0xFA
+#define FAST_LOG_FRAME_OVERHEAD 7   // Sync, kind, two length bytes and CRC
+#define FAST_LOG_FRAME_APP_NAME 32  // Max bytes of the app name in the BOOT frame
+// Most a serial write() sends at once: BOOT, FORMAT (a SCHEMA is shorter) and a DEFERRED record
+#define FAST_LOG_FRAME_MAX_WRITE (3 * FAST_LOG_FRAME_OVERHEAD + (2 + FAST_LOG_FRAME_APP_NAME) + \
+                                  (4 + FAST_SYSLOG_MESSAGE_SIZE) + (6 + 4 + FAST_SYSLOG_MESSAGE_SIZE))
+
+static_assert(FAST_LOG_EVENT_COUNT <= 32, "FastLogSerialSink keeps a bit per event");
+
+FastLogUdpSink::FastLogUdpSink() {
+    udpClient = nullptr;
+    server = nullptr;
+    port = 0;
+    hostname = nullptr;
+    appName = nullptr;
+    batch = nullptr;
+    batchLength = 0;
+    batchStart = 0;
+    datagramsSent = 0;
+    recordsSent = 0;
+}
+
+bool FastLogUdpSink::begin(const char* server, uint16_t port, const char* hostname, const char* appName) {
+    udpClient = new WiFiUDP();
+    batch = new char[FAST_SYSLOG_DATAGRAM_SIZE];
+    if (!udpClient || !batch) {
+        end();
+        return false;
+    }
+    this->server = server;
+    this->port = port;
+    this->hostname = hostname;
+    this->appName = appName;
+    batchLength = 0;
+    return true;
+}
+
+void FastLogUdpSink::setServer(const char* server, uint16_t port) {
+    this->server = server;
+    this->port = port;
+}
+
+void FastLogUdpSink::end() {
+    delete udpClient;
+    delete[] batch;
+    udpClient = nullptr;
+    batch = nullptr;
+    batchLength = 0;
+}
+
+bool FastLogUdpSink::ready() {
+    return batch && server && WiFi.status() == WL_CONNECTED;
+}
+
+bool FastLogUdpSink::write(const FastLogEntry& entry) {
+    if (!ready()) return false;
+
+    if (entry.event) {
+        char data[FAST_SYSLOG_MESSAGE_SIZE];
+        FastSyslog::formatEvent(data, sizeof(data), entry.event - 1, entry.message, entry.length);
+        appendRecord(entry.priority, "", FastSyslog::eventName(entry.event - 1), data);
+    } else if (entry.format) {
+        char text[FAST_SYSLOG_MESSAGE_SIZE];
+        FastSyslog::formatDeferred(text, sizeof(text), entry.format, entry.message, entry.length);
+        appendRecord(entry.priority, text);
+    } else {
+        appendRecord(entry.priority, entry.message);
+    }
+    return true;
+}
+
+// A datagram that is not full waits for more records until its flush time. While WiFi is down it is kept.
+TickType_t FastLogUdpSink::flush(TickType_t now) {
+    if (batchLength == 0) return portMAX_DELAY;
+    TickType_t age = now - batchStart;
+    if (age < pdMS_TO_TICKS(FAST_SYSLOG_FLUSH_MS)) {
+        return pdMS_TO_TICKS(FAST_SYSLOG_FLUSH_MS) - age;
+    }
+    if (!ready()) return pdMS_TO_TICKS(FAST_SYSLOG_FLUSH_MS);
+    flushBatch();
+    return portMAX_DELAY;
+}
+
+// Append an RFC 5424 record with octet-counted framing (RFC 6587): "LENGTH SP <PRI>1 - HOST APP - MSGID SD MSG".
+// Timestamp and process id are nil like in the records of the Syslog library, message id and structured data are
+// only set for events, which have no MSG.
+void FastLogUdpSink::appendRecord(uint8_t priority, const char* text, const char* msgId, const char* data) {
+    char record[FAST_SYSLOG_MESSAGE_SIZE + 96];
+    int recordLength = snprintf(record, sizeof(record), "<%u>1 - %s %s - %s %s%s%s",
+                                (unsigned)(FAST_SYSLOG_FACILITY * 8 + (priority & 0x07)),
+                                hostname ? hostname : "-", appName ? appName : "-", msgId, data,
+                                *text ? " " : "", text);
+    if (recordLength < 0) return;
+    if ((size_t)recordLength >= sizeof(record)) recordLength = sizeof(record) - 1;
+
+    char frame[8];
+    int frameLength = snprintf(frame, sizeof(frame), "%d ", recordLength);
+    size_t length = frameLength + recordLength;
+    if (batchLength + length > FAST_SYSLOG_DATAGRAM_SIZE) {
+        flushBatch();
+    }
+    if (batchLength == 0) {
+        batchStart = xTaskGetTickCount();
+    }
+    memcpy(batch + batchLength, frame, frameLength);
+    memcpy(batch + batchLength + frameLength, record, recordLength);
+    batchLength += length;
+    recordsSent++;
+}
+
+void FastLogUdpSink::flushBatch() {
+    if (batchLength == 0) return;
+    if (WiFi.status() == WL_CONNECTED && server) {
+        udpClient->beginPacket(server, port);
+        udpClient->write((const uint8_t*)batch, batchLength);
+        udpClient->endPacket();
+        datagramsSent++;
+    }
+    batchLength = 0;
+}
+
+FastLogSerialSink::FastLogSerialSink(Print& port, const char* appName) : port(port), appName(appName) {
+    memset(formats, 0, sizeof(formats));
+    schemas = 0;
+    booted = false;
+    announceStart = 0;
+    framesSent = 0;
+}
+
+// write() checks the room for its frames, a port with less than this is not worth trying
+bool FastLogSerialSink::ready() {
+    return port.availableForWrite() >= FAST_SYSLOG_SERIAL_READY_BYTES;
+}
+
+// The record and the frames it needs are built first and written with one call, so they are only sent together and
+// Serial.print() of another task cannot end up inside a frame
+bool FastLogSerialSink::write(const FastLogEntry& entry) {
+    uint8_t out[FAST_LOG_FRAME_MAX_WRITE];
+    uint8_t payload[FAST_SYSLOG_MESSAGE_SIZE + 16];
+    size_t length = 0;
+    size_t size = 0;
+
+    TickType_t now = xTaskGetTickCount();
+    if (now - announceStart >= pdMS_TO_TICKS(FAST_SYSLOG_SERIAL_ANNOUNCE_MS)) {
+        memset(formats, 0, sizeof(formats));
+        schemas = 0;
+        announceStart = now;
+    }
+    if (!booted) {
+        payload[0] = VERSION;
+        payload[1] = sizeof(void*);
+        size_t nameLength = strnlen(appName, FAST_LOG_FRAME_APP_NAME);
+        memcpy(payload + 2, appName, nameLength);
+        size += appendFrame(out + size, BOOT << 4, payload, 2 + nameLength);
+    }
+
+    uint32_t formatId = (uint32_t)(uintptr_t)entry.format;
+    if (entry.event) {
+        uint8_t event = entry.event - 1;
+        if (!(schemas & (1u << event))) {
+            const char* name = FastSyslog::eventName(event);
+            const char* fields = FastSyslog::eventFields(event);
+            size_t nameLength = strlen(name) + 1;
+            size_t fieldsLength = strlen(fields);
+            payload[0] = event;
+            memcpy(payload + 1, name, nameLength);
+            memcpy(payload + 1 + nameLength, fields, fieldsLength);
+            size += appendFrame(out + size, SCHEMA << 4, payload, 1 + nameLength + fieldsLength);
+        }
+    } else if (entry.format && !announced(formatId, false)) {
+        size_t formatLength = strnlen(entry.format, FAST_SYSLOG_MESSAGE_SIZE);
+        memcpy(payload, &formatId, sizeof(formatId));
+        memcpy(payload + 4, entry.format, formatLength);
+        size += appendFrame(out + size, FORMAT << 4, payload, 4 + formatLength);
+    }
+
+    uint16_t sequence = entry.sequence;
+    memcpy(payload, &sequence, sizeof(sequence));
+    memcpy(payload + 2, &entry.ms, sizeof(entry.ms));
+    length = 6;
+    uint8_t kind;
+    size_t messageLength = entry.length;
+    if (entry.event) {
+        kind = EVENT;
+        payload[length++] = entry.event - 1;
+    } else if (entry.format) {
+        kind = DEFERRED;
+        memcpy(payload + length, &formatId, sizeof(formatId));
+        length += sizeof(formatId);
+    } else {
+        kind = TEXT;
+        messageLength = strnlen(entry.message, entry.length);
+    }
+    memcpy(payload + length, entry.message, messageLength);
+    length += messageLength;
+    size += appendFrame(out + size, kind << 4 | (entry.priority & 0x07), payload, length);
+
+    if ((size_t)port.availableForWrite() < size) return false;
+    port.write(out, size);
+
+    booted = true;
+    if (entry.event) {
+        schemas |= 1u << (entry.event - 1);
+    } else if (entry.format) {
+        announced(formatId, true);
+    }
+    framesSent++;
+    return true;
+}
+
+// Frame with sync bytes, length and CRC-16/CCITT-FALSE, returns its size
+size_t FastLogSerialSink::appendFrame(uint8_t* out, uint8_t kind, const uint8_t* payload, size_t length) {
+    size_t size = 0;
+    out[size++] = FAST_LOG_FRAME_SYNC0;
+    out[size++] = FAST_LOG_FRAME_SYNC1;
+    size_t start = size;
+    out[size++] = kind;
+    if (length < 0x80) {
+        out[size++] = length;
+    } else {
+        out[size++] = 0x80 | (length >> 8);
+        out[size++] = length & 0xFF;
+    }
+    memcpy(out + size, payload, length);
+    size += length;
+
+    uint16_t crc = 0xFFFF;
+    for (size_t i = start; i < size; i++) {
+        crc ^= (uint16_t)out[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    out[size++] = crc & 0xFF;
+    out[size++] = crc >> 8;
+    return size;
+}
+
+// Open addressing over the format ids, a full table is forgotten and its formats are sent again
+bool FastLogSerialSink::announced(uint32_t formatId, bool remember) {
+    uint32_t slot = (formatId * 0x9E3779B1u) >> 16;
+    for (uint32_t n = 0; n < FAST_SYSLOG_SERIAL_FORMATS; n++) {
+        uint32_t& entry = formats[(slot + n) & (FAST_SYSLOG_SERIAL_FORMATS - 1)];
+        if (entry == formatId) return true;
+        if (entry == 0) {
+            if (remember) entry = formatId;
+            return false;
+        }
+    }
+    if (remember) {
+        memset(formats, 0, sizeof(formats));
+        formats[slot & (FAST_SYSLOG_SERIAL_FORMATS - 1)] = formatId;
+    }
+    return false;
+}
+
+FastLogMemorySink::FastLogMemorySink(size_t capacity) : capacity(capacity) {
+    ring = nullptr;
+    head = 0;
+    tail = 0;
+    firstSequence = 0;
+    nextSequence = 0;
+}
+
+bool FastLogMemorySink::begin() {
+    if (capacity && !ring) ring = new char[capacity];
+    return ring || !capacity;
+}
+
+void FastLogMemorySink::end() {
+    delete[] ring;
+    ring = nullptr;
+    head = tail = 0;
+    firstSequence = nextSequence;
+}
+
+// The oldest entries are dropped until the new one fits
+bool FastLogMemorySink::write(const FastLogEntry& entry) {
+    uint32_t size = sizeOf(entry.length);
+    if (!ring || size > capacity) {
+        head = tail;
+        firstSequence = nextSequence = entry.sequence + 1;
+        return true;
+    }
+    if (head == tail) firstSequence = entry.sequence;
+    while (tail + size - head > capacity) {
+        Header oldest;
+        copyOut(head, &oldest, sizeof(oldest));
+        head += sizeOf(oldest.length);
+        firstSequence = oldest.sequence + 1;
+    }
+
+    Header header = { entry.sequence, entry.ms, entry.priority, entry.event, entry.length, entry.format };
+    copyIn(tail, &header, sizeof(header));
+    copyIn(tail + sizeof(header), entry.message, entry.length);
+    tail += size;
+    nextSequence = entry.sequence + 1;
+    return true;
+}
+
+uint32_t FastLogMemorySink::replay(FastLogSink& sink, uint32_t sequence, uint32_t& lost) {
+    lost = 0;
+    if ((int32_t)(firstSequence - sequence) > 0) {
+        lost = firstSequence - sequence;
+        sequence = firstSequence;
+    }
+
+    char message[FAST_SYSLOG_MESSAGE_SIZE];
+    for (uint32_t position = head; position != tail; ) {
+        Header header;
+        copyOut(position, &header, sizeof(header));
+        if ((int32_t)(header.sequence - sequence) >= 0) {
+            copyOut(position + sizeof(header), message, header.length);
+            FastLogEntry entry = { header.sequence, header.ms, header.priority, header.event, header.length,
+                                   header.format, message };
+            if (!sink.write(entry)) return header.sequence;
+        }
+        position += sizeOf(header.length);
+    }
+    return nextSequence;
+}
+
+// Positions count since begin(), an entry may wrap around the end of the ring
+void FastLogMemorySink::copyIn(uint32_t position, const void* data, size_t length) {
+    size_t offset = position % capacity;
+    size_t first = length < capacity - offset ? length : capacity - offset;
+    memcpy(ring + offset, data, first);
+    memcpy(ring, (const char*)data + first, length - first);
+}
+
+void FastLogMemorySink::copyOut(uint32_t position, void* data, size_t length) {
+    size_t offset = position % capacity;
+    size_t first = length < capacity - offset ? length : capacity - offset;
+    memcpy(data, ring + offset, first);
+    memcpy((char*)data + first, ring, length - first);
+}
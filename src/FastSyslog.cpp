@@ -1,16 +1,62 @@
 #include "FastSyslog.h"
+#include <Preferences.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_ota_ops.h>
 
 // Global instance definition
 FastSyslog fastSyslog;
 
+const char FastSyslog::formatTooLong[] = "(deferred record too long)";
+
+#define FAST_LOG_EVENT_FIELD_NAME(type, name) " " #name
+#define FAST_LOG_EVENT_SCHEMA(event, priority, fields) { #event, "ms" fields },
+const FastLogEventSchema FastSyslog::events[FAST_LOG_EVENT_COUNT] = {
+    FAST_LOG_EVENTS(FAST_LOG_EVENT_SCHEMA, FAST_LOG_EVENT_FIELD_NAME)
+};
+#undef FAST_LOG_EVENT_SCHEMA
+#undef FAST_LOG_EVENT_FIELD_NAME
+
+#if FAST_SYSLOG_CRASH_RECORDS
+#define FAST_SYSLOG_CRASH_MAGIC 0x46534C32  // "FSL2", changes with the layout of FastCrashRecord
+
+// Not initialized at boot, the records of the previous boot are still there
+struct FastCrashLog {
+    uint32_t magic;
+    uint8_t image[8];  // Start of the ELF SHA-256 of the firmware that wrote the records
+    FastCrashRecord records[FAST_SYSLOG_CRASH_RECORDS];
+};
+RTC_NOINIT_ATTR static FastCrashLog crashLog;
+#endif
+
 // Constructor
-FastSyslog::FastSyslog() {
+FastSyslog::FastSyslog() : backlog(FAST_SYSLOG_BACKLOG_SIZE) {
     logBuffer = nullptr;
     writeIndex = 0;
     readIndex = 0;
+    freeIndex = 0;
+    crashIndex = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        droppedMessages[i] = 0;
+        reportedDropsByPriority[i] = 0;
+    }
+    reportedDrops = 0;
+    dropPolicy = FAST_SYSLOG_DROP_POLICY;
+    consumerIdle = false;
+    consumerWakeups = 0;
+    consumerAwakeUs = 0;
     syslogTaskHandle = nullptr;
-    udpClient = nullptr;
-    syslog = nullptr;
+    sinks[0] = &udpSink;
+    sinkNext[0] = 0;
+    sinkCount = 1;
+    dispatchSequence = 0;
+    sinkLost = 0;
+    crashRecords = nullptr;
+    crashRecordCount = 0;
+    crashSameImage = false;
+    for (uint8_t i = 0; i < FAST_LOG_MODULE_COUNT; i++) {
+        levels[i] = defaultLevel(i);
+    }
 }
 
 // Destructor
@@ -23,28 +69,35 @@ bool FastSyslog::begin(const char* server, uint16_t port,
                        const char* deviceHostname, 
                        const char* appName) {
     
-    // Allocate buffer
-    logBuffer = new FastLogMessage[FAST_SYSLOG_BUFFER_SIZE];
-    if (!logBuffer) {
+    // Called again after a WiFi reconnect: only update the server, the ring has a single consumer task
+    if (logBuffer) {
+        udpSink.setServer(server, port);
+        return true;
+    }
+
+    // Nothing was logged since boot yet, the crash log still holds the previous boot
+    recoverCrashLog();
+
+    // Allocate buffer, new[] aligns it for FastLogRecord
+    char* buffer = new char[FAST_SYSLOG_ARENA_SIZE];
+    if (!buffer) {
         return false;
     }
     
-    // Initialize buffer
-    memset(logBuffer, 0, sizeof(FastLogMessage) * FAST_SYSLOG_BUFFER_SIZE);
-    
-    // Create UDP client and syslog instance
-    udpClient = new WiFiUDP();
-    syslog = new Syslog(*udpClient, SYSLOG_PROTO_IETF);
-    
-    if (!udpClient || !syslog) {
+    // A zeroed arena holds no published record
+    memset(buffer, 0, FAST_SYSLOG_ARENA_SIZE);
+    writeIndex.store(0, std::memory_order_relaxed);
+    readIndex.store(0, std::memory_order_relaxed);
+    freeIndex.store(0, std::memory_order_relaxed);
+    crashIndex.store(0, std::memory_order_relaxed);
+
+    // UDP sink and the backlog that keeps the records while WiFi is down
+    if (!udpSink.begin(server, port, deviceHostname, appName) || !backlog.begin()) {
+        delete[] buffer;
+        udpSink.end();
         return false;
     }
-    
-    // Configure syslog
-    syslog->server(server, port);
-    syslog->deviceHostname(deviceHostname);
-    syslog->appName(appName);
-    syslog->defaultPriority(LOG_INFO);
+    logBuffer = buffer;
     
     // Create syslog task
     BaseType_t taskCreated = xTaskCreatePinnedToCore(
@@ -59,14 +112,13 @@ bool FastSyslog::begin(const char* server, uint16_t port,
     
     if (taskCreated != pdPASS) {
         delete[] logBuffer;
-        delete udpClient;
-        delete syslog;
         logBuffer = nullptr;
-        udpClient = nullptr;
-        syslog = nullptr;
+        udpSink.end();
+        backlog.end();
         return false;
     }
-    
+
+    shipCrashLog();
     return true;
 }
 
@@ -83,19 +135,12 @@ void FastSyslog::end() {
         delete[] logBuffer;
         logBuffer = nullptr;
     }
-    
-    if (udpClient) {
-        delete udpClient;
-        udpClient = nullptr;
-    }
-    
-    if (syslog) {
-        delete syslog;
-        syslog = nullptr;
-    }
-    
-    writeIndex = 0;
-    readIndex = 0;
+    udpSink.end();
+    backlog.end();
+
+    writeIndex.store(0, std::memory_order_relaxed);
+    readIndex.store(0, std::memory_order_relaxed);
+    freeIndex.store(0, std::memory_order_relaxed);
 }
 
 // Static wrapper for task function
@@ -105,34 +150,376 @@ void FastSyslog::syslogTaskWrapper(void* parameter) {
 }
 
 // Actual task implementation
+// The task drains every published message and then sleeps until a producer notifies it, an idle ring costs no
+// wakeups. After a notification it waits FAST_SYSLOG_BATCH_DELAY_MS before draining, the rest of a burst is written
+// meanwhile without notifications and the producers never run into a ping-pong with the consumer.
+// consumerIdle and the sequence of the next slot are a Dekker pair: the consumer sets consumerIdle before it looks at
+// the slot a last time, a producer publishes before it looks at consumerIdle, so one of them sees the other.
 void FastSyslog::syslogTask() {
-    uint32_t localReadIndex = 0;
-    
+    TickType_t lastDropReport = xTaskGetTickCount();
+    uint32_t awakeSince = micros();
+
     while (true) {
-        // Check if there's a message ready
-        if (localReadIndex != writeIndex && 
-            logBuffer[localReadIndex & FAST_SYSLOG_BUFFER_MASK].ready) {
-            
-            FastLogMessage* msg = &logBuffer[localReadIndex & FAST_SYSLOG_BUFFER_MASK];
-            
-            // Only send if WiFi is connected and syslog is valid
-            if (WiFi.status() == WL_CONNECTED && syslog) {
-                syslog->logf(msg->priority, "%s", msg->message);
+        // Drops are reported at most every FAST_SYSLOG_DROP_REPORT_MS, also while a flood keeps the ring busy
+        TickType_t now = xTaskGetTickCount();
+        bool dropsPending = getDroppedMessages() != reportedDrops;
+        if (dropsPending && now - lastDropReport >= pdMS_TO_TICKS(FAST_SYSLOG_DROP_REPORT_MS)) {
+            reportDrops();
+            lastDropReport = now;
+            dropsPending = false;
+        }
+
+        uint32_t position;
+        FastLogRecord* record = claim(position);
+        if (record) {
+            // The record is copied out and released first, its bytes are free while the copy is formatted and sent
+            FastLogEntry entry;
+            entry.length = record->length;
+            if (entry.length == RECORD_PADDING) {
+                release(record, position);
+                continue;
             }
-            
-            // Mark as processed (atomic)
-            msg->ready = false;
-            localReadIndex++;
-            readIndex = localReadIndex;  // Update global read index
+            entry.priority = record->priority;
+            entry.event = record->event;
+            entry.format = record->format;
+            char message[FAST_SYSLOG_MESSAGE_SIZE];
+            memcpy(message, record->message, entry.length);
+            release(record, position);
+
+            entry.message = message;
+            dispatch(entry);
+            continue;
+        }
+
+        // Ring drained, sleep until the next report or flush is due
+        TickType_t timeout = portMAX_DELAY;
+        if (dropsPending) {
+            timeout = pdMS_TO_TICKS(FAST_SYSLOG_DROP_REPORT_MS) - (now - lastDropReport);
+        }
+
+        // Sinks send what they buffered, a sink that fell behind is caught up once it is ready or tried again later
+        uint8_t count = sinkCount.load(std::memory_order_acquire);
+        for (uint8_t i = 0; i < count; i++) {
+            if (sinkNext[i] != dispatchSequence && !catchUp(i) && pdMS_TO_TICKS(FAST_SYSLOG_FLUSH_MS) < timeout) {
+                timeout = pdMS_TO_TICKS(FAST_SYSLOG_FLUSH_MS);
+            }
+            TickType_t due = sinks[i]->flush(now);
+            if (due < timeout) {
+                timeout = due;
+            }
+        }
+
+        // Sleep unless a message was published in the meantime
+        consumerIdle.store(true, std::memory_order_seq_cst);
+        uint32_t next = readIndex.load(std::memory_order_seq_cst);
+        if (recordAt(next)->state.load(std::memory_order_seq_cst) == (next | RECORD_PUBLISHED)) {
+            consumerIdle.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        // Time outside the waits, what logTaskStats() reports where the sdkconfig has no run time stats
+        consumerAwakeUs += micros() - awakeSince;
+        if (ulTaskNotifyTake(pdTRUE, timeout)) {
+            consumerWakeups++;
+            vTaskDelay(pdMS_TO_TICKS(FAST_SYSLOG_BATCH_DELAY_MS));
         } else {
-            // No messages, yield to other tasks
-            vTaskDelay(pdMS_TO_TICKS(1));
+            consumerIdle.store(false, std::memory_order_relaxed);
         }
+        awakeSince = micros();
     }
 }
 
+// Summary record of the messages dropped since the last report, sent with the other records
+void FastSyslog::reportDrops() {
+    static const char* const names[8] = { "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug" };
+    char text[FAST_SYSLOG_MESSAGE_SIZE];
+    uint32_t total = 0;
+    int length = 0;
+    for (uint8_t priority = 0; priority < 8; priority++) {
+        uint32_t count = droppedMessages[priority].load(std::memory_order_relaxed);
+        uint32_t delta = count - reportedDropsByPriority[priority];
+        reportedDropsByPriority[priority] = count;
+        total += delta;
+        if (delta && length < (int)sizeof(text)) {
+            length += snprintf(text + length, sizeof(text) - length, " %s=%lu", names[priority], (unsigned long)delta);
+        }
+    }
+    reportedDrops += total;
+
+    char record[FAST_SYSLOG_MESSAGE_SIZE];
+    FastLogEntry entry;
+    entry.length = snprintf(record, sizeof(record), "FastSyslog: %lu messages dropped:%s", (unsigned long)total,
+                            length ? text : "") + 1;
+    if (entry.length > sizeof(record)) entry.length = sizeof(record);
+    entry.priority = FAST_SYSLOG_WARNING;
+    entry.event = 0;
+    entry.format = nullptr;
+    entry.message = record;
+    dispatch(entry);
+}
+
+// Hand a record to the backlog and to every sink, the sequence and the time are set here
+void FastSyslog::dispatch(FastLogEntry& entry) {
+    entry.sequence = dispatchSequence++;
+    entry.ms = millis();
+    backlog.write(entry);
+
+    uint8_t count = sinkCount.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < count; i++) {
+        if (sinkNext[i] != entry.sequence) {
+            // Behind, the backlog holds this record as well
+            catchUp(i);
+        } else if (sinks[i]->write(entry)) {
+            sinkNext[i] = entry.sequence + 1;
+        }
+    }
+}
+
+// Replay the records a sink missed, true once it is up to date
+bool FastSyslog::catchUp(uint8_t sink) {
+    if (!sinks[sink]->ready()) return false;
+    uint32_t lost;
+    sinkNext[sink] = backlog.replay(*sinks[sink], sinkNext[sink], lost);
+    sinkLost += lost;
+    return sinkNext[sink] == dispatchSequence;
+}
+
+bool FastSyslog::addSink(FastLogSink* sink) {
+    uint8_t count = sinkCount.load(std::memory_order_relaxed);
+    if (count >= FAST_SYSLOG_MAX_SINKS) return false;
+    sinks[count] = sink;
+    sinkNext[count] = dispatchSequence;
+    sinkCount.store(count + 1, std::memory_order_release);
+    return true;
+}
+
+// Reserve a record at the write position. Producers race with a CAS on writeIndex, the winner owns the bytes until
+// publish(). A record that does not fit before the end of the arena is preceded by a padding record up to the end.
+// The bytes up to freeIndex have been released, a full arena is handled by the drop policy and every message that is
+// lost is counted with its priority.
+FastLogRecord* FastSyslog::reserve(uint32_t& position, size_t length, uint8_t priority) {
+    uint32_t size = (sizeof(FastLogRecord) + length + FAST_SYSLOG_RECORD_ALIGN - 1) & ~(FAST_SYSLOG_RECORD_ALIGN - 1);
+    // The last FAST_SYSLOG_RESERVED_BYTES are kept for ERR and above
+    uint32_t limit = FAST_SYSLOG_ARENA_SIZE;
+    if (dropPolicy == DropPolicy::RESERVE_ERRORS && priority > FAST_SYSLOG_ERR) {
+        limit -= FAST_SYSLOG_RESERVED_BYTES;
+    }
+
+    position = writeIndex.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t offset = position & FAST_SYSLOG_ARENA_MASK;
+        uint32_t padding = offset + size > FAST_SYSLOG_ARENA_SIZE ? FAST_SYSLOG_ARENA_SIZE - offset : 0;
+        uint32_t end = position + padding + size;
+        if (end - freeIndex.load(std::memory_order_acquire) > limit) {
+            // Arena full. Overwriting discards the oldest message unless it is more severe.
+            if (dropPolicy != DropPolicy::OVERWRITE_OLDEST || !discardOldest(priority)) {
+                break;
+            }
+            position = writeIndex.load(std::memory_order_relaxed);
+            continue;
+        }
+        // On failure position is reloaded with the current writeIndex
+        if (writeIndex.compare_exchange_weak(position, end, std::memory_order_relaxed)) {
+            if (padding) {
+                FastLogRecord* pad = recordAt(position);
+                pad->size = padding;
+                pad->length = RECORD_PADDING;
+                pad->state.store(position | RECORD_PUBLISHED, std::memory_order_release);
+                position += padding;
+            }
+            FastLogRecord* record = recordAt(position);
+            record->size = size;
+            record->length = length;
+            return record;
+        }
+    }
+    droppedMessages[priority & 0x07].fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+// Hand a filled record to the consumer, the release store makes the message visible before the state
+void FastSyslog::publish(FastLogRecord* record, uint32_t position) {
+    record->state.store(position | RECORD_PUBLISHED, std::memory_order_release);
+
+    // Only the producer that finds the consumer asleep pays for the notification
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumerIdle.load(std::memory_order_relaxed) && consumerIdle.exchange(false) && syslogTaskHandle) {
+        xTaskNotifyGive(syslogTaskHandle);
+    }
+}
+
+// Take the oldest published record out of the ring. The consumer and producers that overwrite race with a CAS on
+// readIndex, the winner owns the record until release().
+FastLogRecord* FastSyslog::claim(uint32_t& position) {
+    position = readIndex.load(std::memory_order_relaxed);
+    for (;;) {
+        FastLogRecord* record = recordAt(position);
+        if (record->state.load(std::memory_order_acquire) != (position | RECORD_PUBLISHED)) {
+            // Empty, the oldest record is not published yet, or another reader took it
+            uint32_t current = readIndex.load(std::memory_order_relaxed);
+            if (current == position) {
+                return nullptr;
+            }
+            position = current;
+            continue;
+        }
+        if (readIndex.compare_exchange_weak(position, position + record->size, std::memory_order_relaxed)) {
+            return record;
+        }
+    }
+}
+
+// Zero a claimed record behind its header and mark it released. freeIndex then moves over every released record in
+// order, records released out of order (a discard while the consumer copies) are passed by the later release.
+void FastSyslog::release(FastLogRecord* record, uint32_t position) {
+    uint16_t size = record->size;
+    memset(reinterpret_cast<char*>(record) + sizeof(record->state), 0, size - sizeof(record->state));
+    record->size = size;
+    record->state.store(position | RECORD_RELEASED, std::memory_order_release);
+
+    uint32_t free = freeIndex.load(std::memory_order_acquire);
+    for (;;) {
+        FastLogRecord* oldest = recordAt(free);
+        if (oldest->state.load(std::memory_order_acquire) != (free | RECORD_RELEASED)) {
+            return;
+        }
+        // On failure free is reloaded, another release moved it
+        uint32_t next = free + oldest->size;
+        if (freeIndex.compare_exchange_weak(free, next, std::memory_order_release, std::memory_order_acquire)) {
+            free = next;
+        }
+    }
+}
+
+// Called by a producer that found the arena full, discards the oldest message if it is not more severe than priority.
+// While the consumer copies a record freeIndex cannot move, discarding more would lose messages for nothing.
+bool FastSyslog::discardOldest(uint8_t priority) {
+    uint32_t position = readIndex.load(std::memory_order_relaxed);
+    if (freeIndex.load(std::memory_order_acquire) != position) {
+        return false;
+    }
+    FastLogRecord* record = recordAt(position);
+    if (record->state.load(std::memory_order_acquire) != (position | RECORD_PUBLISHED)) {
+        return false;
+    }
+    // Padding at the arena end can be just the 8 bytes up to priority, it has no priority to read
+    bool padding = record->length == RECORD_PADDING;
+    uint8_t victim = padding ? 0 : record->priority;
+    if (!padding && victim < priority) {
+        return false;
+    }
+    if (!readIndex.compare_exchange_strong(position, position + record->size, std::memory_order_relaxed)) {
+        return true;  // The consumer took it, there is room soon
+    }
+    if (!padding) {
+        droppedMessages[victim & 0x07].fetch_add(1, std::memory_order_relaxed);
+    }
+    release(record, position);
+    return true;
+}
+
+// Copy a message to its crash log record. The record is invalid while it is written, a reset in between loses it but
+// never ships half of it.
+void FastSyslog::persistRecord(const FastLogRecord* message) {
+#if FAST_SYSLOG_CRASH_RECORDS
+    // A count, not the position: records take 24 to 272 bytes, (position / 8) & 31 would keep the last 256 bytes of
+    // the stream, about 5 records. The relaxed add is the only one on this path besides reserving the record.
+    uint32_t index = crashIndex.fetch_add(1, std::memory_order_relaxed);
+    FastCrashRecord* record = &crashLog.records[index & (FAST_SYSLOG_CRASH_RECORDS - 1)];
+    record->sequence = 0;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    size_t length = message->length;
+    record->priority = message->priority;
+    record->event = message->event;
+    record->format = message->format;
+    if (message->format || message->event) {
+        // Arguments that do not fit are dropped, the format is still worth having
+        record->length = length <= FAST_SYSLOG_CRASH_MESSAGE_SIZE ? length : 0;
+        memcpy(record->message, message->message, record->length);
+    } else {
+        record->length = 0;
+        if (length > FAST_SYSLOG_CRASH_MESSAGE_SIZE) {
+            length = FAST_SYSLOG_CRASH_MESSAGE_SIZE;
+        }
+        memcpy(record->message, message->message, length);
+        record->message[length - 1] = '\0';
+    }
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    record->sequence = index + 1;
+#endif
+}
+
+// Take the records of the previous boot out of the crash log and start it again for this boot
+void FastSyslog::recoverCrashLog() {
+#if FAST_SYSLOG_CRASH_RECORDS
+    const uint8_t* image = esp_ota_get_app_description()->app_elf_sha256;
+
+    // After power-on RTC memory holds garbage
+    if (crashLog.magic == FAST_SYSLOG_CRASH_MAGIC && esp_reset_reason() != ESP_RST_POWERON) {
+        crashSameImage = memcmp(crashLog.image, image, sizeof(crashLog.image)) == 0;
+        crashRecords = new FastCrashRecord[FAST_SYSLOG_CRASH_RECORDS];
+        for (uint32_t i = 0; crashRecords && i < FAST_SYSLOG_CRASH_RECORDS; i++) {
+            const FastCrashRecord& record = crashLog.records[i];
+            if (record.sequence == 0 || ((record.sequence - 1) & (FAST_SYSLOG_CRASH_RECORDS - 1)) != i ||
+                record.priority > FAST_SYSLOG_DEBUG || record.length > FAST_SYSLOG_CRASH_MESSAGE_SIZE ||
+                record.event > FAST_LOG_EVENT_COUNT) {
+                continue;
+            }
+            // Insertion sort by sequence, at most FAST_SYSLOG_CRASH_RECORDS records
+            uint8_t at = crashRecordCount++;
+            while (at > 0 && crashRecords[at - 1].sequence > record.sequence) {
+                crashRecords[at] = crashRecords[at - 1];
+                at--;
+            }
+            crashRecords[at] = record;
+        }
+    }
+
+    memset(&crashLog, 0, sizeof(crashLog));
+    memcpy(crashLog.image, image, sizeof(crashLog.image));
+    crashLog.magic = FAST_SYSLOG_CRASH_MAGIC;
+#endif
+}
+
+// Send the reset reason and the records of the previous boot, they are not copied to the crash log again
+void FastSyslog::shipCrashLog() {
+#if FAST_SYSLOG_CRASH_RECORDS
+    static const char* const reasons[] = { "unknown", "power-on", "external", "software", "panic", "interrupt watchdog",
+                                           "task watchdog", "watchdog", "deep sleep", "brownout", "sdio" };
+    esp_reset_reason_t reason = esp_reset_reason();
+    const char* name = (unsigned)reason < sizeof(reasons) / sizeof(reasons[0]) ? reasons[reason] : "unknown";
+
+    char text[FAST_SYSLOG_MESSAGE_SIZE];
+    snprintf(text, sizeof(text), "FastSyslog: reset reason %s (%d), %u records of the previous boot follow", name,
+             (int)reason, crashRecordCount);
+    bool abnormal = reason != ESP_RST_POWERON && reason != ESP_RST_SW && reason != ESP_RST_DEEPSLEEP;
+    internalFastLog(text, abnormal ? FAST_SYSLOG_ERR : FAST_SYSLOG_NOTICE, false);
+
+    for (uint8_t i = 0; i < crashRecordCount; i++) {
+        const FastCrashRecord& record = crashRecords[i];
+        int length = snprintf(text, sizeof(text), "[previous boot] ");
+        if (!record.format && !record.event) {
+            snprintf(text + length, sizeof(text) - length, "%s", record.message);
+        } else if (crashSameImage && record.event) {
+            formatEvent(text + length, sizeof(text) - length, record.event - 1, record.message, record.length);
+        } else if (crashSameImage) {
+            formatDeferred(text + length, sizeof(text) - length, record.format, record.message, record.length);
+        } else {
+            snprintf(text + length, sizeof(text) - length, "(%s record of another firmware)",
+                     record.event ? "event" : "deferred");
+        }
+        internalFastLog(text, record.priority, false);
+    }
+
+    delete[] crashRecords;
+    crashRecords = nullptr;
+    crashRecordCount = 0;
+#endif
+}
+
 // Internal fast log implementation
-void FastSyslog::internalFastLog(const char* message, uint8_t priority) {
+void FastSyslog::internalFastLog(const char* message, uint8_t priority, bool persist) {
     if (!logBuffer) return;  // Not initialized
 
     // Check log level filter
@@ -140,30 +527,35 @@ void FastSyslog::internalFastLog(const char* message, uint8_t priority) {
         return;  // Message filtered out
     }
 
-    uint32_t currentWrite = writeIndex;
-    uint32_t nextWrite = (currentWrite + 1) & FAST_SYSLOG_BUFFER_MASK;
-
-    // Check if buffer is full (simple overflow check)
-    if (nextWrite == (readIndex & FAST_SYSLOG_BUFFER_MASK)) {
+    // The record takes the text and its terminator, longer messages are truncated
+    size_t length = strnlen(message, FAST_SYSLOG_MESSAGE_SIZE - 1);
+    uint32_t position;
+    FastLogRecord* record = reserve(position, length + 1, priority);
+    if (!record) {
         return; // Drop message if buffer full
     }
+    memcpy(record->message, message, length);
+    record->message[length] = '\0';
 
-    FastLogMessage* msg = &logBuffer[currentWrite & FAST_SYSLOG_BUFFER_MASK];
-
-    // Fast string copy (limit to prevent overflow)
-    const char* src = message;
-    char* dst = msg->message;
-    int i = 0;
-    while (*src && i < (FAST_SYSLOG_MESSAGE_SIZE - 1)) {
-        *dst++ = *src++;
-        i++;
+    record->priority = priority;
+    record->event = 0;
+    record->format = nullptr;
+    if (persist) {
+        persistRecord(record);
     }
-    *dst = '\0';
-
-    msg->priority = priority;
-    msg->ready = true;  // Atomic flag set
+    publish(record, position);
+}
 
-    writeIndex = nextWrite;  // Update write index
+void FastSyslog::logPacked(uint8_t priority, const char* format, uint8_t event, const char* packed, size_t length) {
+    uint32_t position;
+    FastLogRecord* record = reserve(position, length, priority);
+    if (!record) return;
+    memcpy(record->message, packed, length);
+    record->priority = priority;
+    record->event = event;
+    record->format = format;
+    persistRecord(record);
+    publish(record, position);
 }
 
 // Fast logging function
@@ -171,7 +563,7 @@ void FastSyslog::log(const char* message, uint8_t priority) {
     internalFastLog(message, priority);
 }
 
-// Formatted logging function
+// Formatted logging function, the text is formatted on the stack so the record takes only its length
 void FastSyslog::logf(uint8_t priority, const char* format, ...) {
     if (!logBuffer) return;  // Not initialized
 
@@ -180,36 +572,277 @@ void FastSyslog::logf(uint8_t priority, const char* format, ...) {
         return;  // Message filtered out
     }
 
-    uint32_t currentWrite = writeIndex;
-    uint32_t nextWrite = (currentWrite + 1) & FAST_SYSLOG_BUFFER_MASK;
+    char text[FAST_SYSLOG_MESSAGE_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    internalFastLog(text, priority);
+}
+
+// Format a deferred record. Every conversion of the format takes the next packed argument and is printed by snprintf
+// with the length modifier of the packed type, so %d of a uint8_t and %lu of a uint32_t print the same as logf().
+size_t FastSyslog::formatDeferred(char* text, size_t size, const char* format, const char* args, size_t length) {
+    size_t out = 0;
+    size_t in = 0;
+    auto append = [&](int written) {
+        if (written > 0) out += written;
+        if (out >= size) out = size - 1;
+    };
+
+    while (*format && out + 1 < size) {
+        if (*format != '%') {
+            text[out++] = *format++;
+            continue;
+        }
+        if (format[1] == '%') {
+            text[out++] = '%';
+            format += 2;
+            continue;
+        }
+
+        // Flags, width and precision are kept, length modifiers are replaced
+        char spec[16];
+        size_t specLength = 0;
+        spec[specLength++] = *format++;
+        while (*format && strchr("-+ #0123456789.", *format) && specLength < sizeof(spec) - 4) {
+            spec[specLength++] = *format++;
+        }
+        while (*format && strchr("hlLqjzt", *format)) {
+            format++;
+        }
+        char conversion = *format;
+        if (!conversion) break;
+        format++;
+
+        if (in >= length) {
+            append(snprintf(text + out, size - out, "?"));
+            continue;
+        }
+        uint8_t tag = args[in++];
+        if (tag == FastLogArgs::STRING) {
+            char string[FAST_SYSLOG_MESSAGE_SIZE];
+            uint8_t stringLength = args[in++];
+            memcpy(string, args + in, stringLength);
+            string[stringLength] = 0;
+            in += stringLength;
+            spec[specLength++] = 's';
+            spec[specLength] = 0;
+            append(snprintf(text + out, size - out, spec, string));
+            continue;
+        }
 
-    if (nextWrite == (readIndex & FAST_SYSLOG_BUFFER_MASK)) {
-        return; // Drop if full
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+            const void* p;
+        } value;
+        bool int32 = tag == FastLogArgs::INT32;
+        if (tag == FastLogArgs::INT32 || tag == FastLogArgs::UINT32) {
+            // Widened here, the conversions below only see INT and UINT
+            uint32_t narrow;
+            memcpy(&narrow, args + in, sizeof(narrow));
+            in += sizeof(narrow);
+            if (tag == FastLogArgs::INT32) {
+                value.i = (int32_t)narrow;
+                tag = FastLogArgs::INT;
+            } else {
+                value.u = narrow;
+                tag = FastLogArgs::UINT;
+            }
+        } else {
+            size_t valueSize = tag == FastLogArgs::POINTER ? sizeof(value.p) : 8;
+            memcpy(&value, args + in, valueSize);
+            in += valueSize;
+        }
+
+        if (strchr("fFeEgGaA", conversion)) {
+            spec[specLength++] = conversion;
+            spec[specLength] = 0;
+            double d = tag == FastLogArgs::DOUBLE ? value.d : tag == FastLogArgs::INT ? (double)value.i : (double)value.u;
+            append(snprintf(text + out, size - out, spec, d));
+        } else if (conversion == 'p' || tag == FastLogArgs::POINTER) {
+            spec[specLength++] = 'p';
+            spec[specLength] = 0;
+            append(snprintf(text + out, size - out, spec, value.p));
+        } else if (conversion == 'c') {
+            spec[specLength++] = 'c';
+            spec[specLength] = 0;
+            append(snprintf(text + out, size - out, spec, (int)value.i));
+        } else {
+            long long integer = tag == FastLogArgs::DOUBLE ? (long long)value.d : value.i;
+            // A negative int printed with %x or %u shows its 32 bit value like printf does, a 64 bit one all its bits
+            if (int32 && integer < 0 && strchr("uxXo", conversion)) {
+                integer = (uint32_t)integer;
+            }
+            spec[specLength++] = 'l';
+            spec[specLength++] = 'l';
+            spec[specLength++] = strchr("diuxXo", conversion) ? conversion : 'd';
+            spec[specLength] = 0;
+            append(snprintf(text + out, size - out, spec, integer));
+        }
     }
+    text[out] = 0;
+    return out;
+}
 
-    FastLogMessage* msg = &logBuffer[currentWrite & FAST_SYSLOG_BUFFER_MASK];
+// Format an event as SD-ELEMENT: [name@FAST_SYSLOG_SD_ENTERPRISE field="value" ...]. The packed values are printed by
+// their tag in the order of the field names, characters RFC 5424 reserves in a value are escaped with a backslash.
+// Names are copied and integers converted by hand, an event costs a fraction of formatting the same line with printf.
+size_t FastSyslog::formatEvent(char* text, size_t size, uint8_t event, const char* args, size_t length) {
+    size_t out = 0;
+    auto append = [&](const char* string, size_t stringLength) {
+        if (stringLength > size - 1 - out) stringLength = size - 1 - out;
+        memcpy(text + out, string, stringLength);
+        out += stringLength;
+    };
+    auto appendInteger = [&](uint64_t value, bool negative) {
+        char digits[21];
+        size_t at = sizeof(digits);
+        do {
+            digits[--at] = '0' + value % 10;
+            value /= 10;
+        } while (value);
+        if (negative) digits[--at] = '-';
+        append(digits + at, sizeof(digits) - at);
+    };
 
-    va_list args;
-    va_start(args, format);
-    vsnprintf(msg->message, FAST_SYSLOG_MESSAGE_SIZE, format, args);
-    va_end(args);
+    const FastLogEventSchema& schema = events[event];
+    text[out++] = '[';
+    append(schema.name, strlen(schema.name));
+    append("@", 1);
+    appendInteger(FAST_SYSLOG_SD_ENTERPRISE, false);
+    const char* field = schema.fields;
+    size_t in = 0;
+    while (*field && in < length) {
+        size_t nameLength = strcspn(field, " ");
+        append(" ", 1);
+        append(field, nameLength);
+        append("=\"", 2);
+        field += nameLength;
+        if (*field) field++;
 
-    msg->priority = priority;
-    msg->ready = true;
-    writeIndex = nextWrite;
+        uint8_t tag = args[in++];
+        if (tag == FastLogArgs::STRING) {
+            uint8_t stringLength = args[in++];
+            for (uint8_t i = 0; i < stringLength; i++) {
+                char c = args[in + i];
+                if (c == '"' || c == '\\' || c == ']') append("\\", 1);
+                append(&c, 1);
+            }
+            in += stringLength;
+        } else if (tag == FastLogArgs::INT32 || tag == FastLogArgs::UINT32) {
+            uint32_t value;
+            memcpy(&value, args + in, sizeof(value));
+            in += sizeof(value);
+            bool negative = tag == FastLogArgs::INT32 && (int32_t)value < 0;
+            appendInteger(negative ? 0 - (uint64_t)(int32_t)value : value, negative);
+        } else if (tag == FastLogArgs::POINTER) {
+            const void* value;
+            memcpy(&value, args + in, sizeof(value));
+            in += sizeof(value);
+            char pointer[24];
+            append(pointer, snprintf(pointer, sizeof(pointer), "%p", value));
+        } else {
+            union {
+                int64_t i;
+                uint64_t u;
+                double d;
+            } value;
+            memcpy(&value, args + in, sizeof(value));
+            in += sizeof(value);
+            if (tag == FastLogArgs::DOUBLE) {
+                char number[32];
+                append(number, snprintf(number, sizeof(number), "%g", value.d));
+            } else {
+                bool negative = tag == FastLogArgs::INT && value.i < 0;
+                appendInteger(negative ? 0 - value.u : value.u, negative);
+            }
+        }
+        append("\"", 1);
+    }
+    // The SD-ELEMENT is closed even if the values were truncated
+    if (out > size - 2) out = size - 2;
+    text[out++] = ']';
+    text[out] = 0;
+    return out;
 }
 
 // Get buffer statistics
 uint32_t FastSyslog::getBufferUsage() {
-    return (writeIndex - readIndex) & FAST_SYSLOG_BUFFER_MASK;
+    return writeIndex.load(std::memory_order_relaxed) - freeIndex.load(std::memory_order_relaxed);
 }
 
 uint32_t FastSyslog::getDroppedMessages() {
-    // This would require additional tracking - simplified version
-    return 0;
+    uint32_t total = 0;
+    for (uint8_t priority = 0; priority < 8; priority++) {
+        total += droppedMessages[priority].load(std::memory_order_relaxed);
+    }
+    return total;
 }
 
+uint32_t FastSyslog::getDroppedMessages(uint8_t priority) {
+    return droppedMessages[priority & 0x07].load(std::memory_order_relaxed);
+}
+
+// No room for a message of the full length, which may need padding up to the end of the arena as well
 bool FastSyslog::isBufferFull() {
-    uint32_t nextWrite = (writeIndex + 1) & FAST_SYSLOG_BUFFER_MASK;
-    return nextWrite == (readIndex & FAST_SYSLOG_BUFFER_MASK);
-}
\ No newline at end of file
+    return getBufferUsage() > FAST_SYSLOG_ARENA_SIZE - 2 * (sizeof(FastLogRecord) + FAST_SYSLOG_MESSAGE_SIZE);
+}
+
+const char* FastSyslog::moduleName(uint8_t module) {
+    static const char* const names[FAST_LOG_MODULE_COUNT] = { "app", "mdb", "reader", "api", "ota", "events" };
+    return module < FAST_LOG_MODULE_COUNT ? names[module] : nullptr;
+}
+
+uint8_t FastSyslog::defaultLevel(uint8_t module) {
+    return module == FAST_LOG_MODULE_EVENTS ? FAST_SYSLOG_EVENT_LEVEL : FAST_SYSLOG_DEFAULT_LEVEL;
+}
+
+bool FastSyslog::loadLevels() {
+    Preferences prefs;
+    if (!prefs.begin(FAST_SYSLOG_LEVELS_NAMESPACE, true)) return false;  // Nothing stored yet
+    for (uint8_t i = 0; i < FAST_LOG_MODULE_COUNT; i++) {
+        uint8_t level = prefs.getUChar(moduleName(i), defaultLevel(i));
+        levels[i].store(level <= FAST_SYSLOG_DEBUG ? level : defaultLevel(i), std::memory_order_relaxed);
+    }
+    prefs.end();
+    return true;
+}
+
+// Only a changed level is written, the backend sends the full set with every sync
+bool FastSyslog::setLevel(uint8_t module, uint8_t level) {
+    if (module >= FAST_LOG_MODULE_COUNT || level > FAST_SYSLOG_DEBUG) return false;
+    if (levels[module].exchange(level, std::memory_order_relaxed) == level) return true;
+
+    Preferences prefs;
+    if (!prefs.begin(FAST_SYSLOG_LEVELS_NAMESPACE, false)) return false;
+    bool ok = prefs.putUChar(moduleName(module), level) > 0;
+    prefs.end();
+    logf(LOG_NOTICE, "FastSyslog: log level of %s is %u", moduleName(module), level);
+    return ok;
+}
+
+void FastSyslog::logTaskStats() {
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+    UBaseType_t count = uxTaskGetNumberOfTasks();
+    TaskStatus_t* tasks = (TaskStatus_t*)malloc(count * sizeof(TaskStatus_t));
+    if (!tasks) return;
+
+    uint32_t totalRunTime;
+    count = uxTaskGetSystemState(tasks, count, &totalRunTime);
+    totalRunTime /= 1000;  // Per mille
+    for (UBaseType_t i = 0; totalRunTime && i < count; i++) {
+        logf(LOG_INFO, "task %s: %lu.%lu%% cpu, stack free %lu", tasks[i].pcTaskName,
+             (unsigned long)(tasks[i].ulRunTimeCounter / totalRunTime / 10),
+             (unsigned long)(tasks[i].ulRunTimeCounter / totalRunTime % 10),
+             (unsigned long)tasks[i].usStackHighWaterMark);
+    }
+    free(tasks);
+#endif
+    logf(LOG_INFO, "FastSyslog: %lu wakeups, %lu us awake, %lu dropped, %lu records in %lu datagrams, %lu lost by sinks",
+         (unsigned long)consumerWakeups, (unsigned long)consumerAwakeUs, (unsigned long)getDroppedMessages(), (unsigned long)getRecordsSent(),
+         (unsigned long)getDatagramsSent(), (unsigned long)sinkLost);
+}
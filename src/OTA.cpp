@@ -1,3 +1,5 @@
+#define FAST_SYSLOG_MODULE FAST_LOG_MODULE_OTA
+
 #include "OTA.h"
 #include <Arduino.h>
 #include <FreeRTOS.h>
@@ -1,3 +1,5 @@
+#define FAST_SYSLOG_MODULE FAST_LOG_MODULE_API
+
 #include "api_client.h"
 #include "mdb_comm.h"
 #include <WiFi.h>
@@ -6,6 +8,8 @@
 #include <ESPmDNS.h>
 #include "FastSyslog.h"
 #include "secrets.h"
+#include "uid_cache.h"
+#include "blocklist.h"
 
 extern const char* api_key;
 extern const char* api_base_url;
@@ -41,7 +45,7 @@ int getUserBalance(const char* uid) {
 
     int httpResponseCode = http.POST(requestBody);
     unsigned long elapsed = millis() - startTime;
-    fastSyslog.logf(LOG_DEBUG, "getBalance took %lums, code: %d", elapsed, httpResponseCode);
+    FAST_LOGF(LOG_DEBUG, "getBalance took %lums, code: %d", elapsed, httpResponseCode);
 
     if (httpResponseCode == 200) {
         String response = http.getString();
@@ -51,7 +55,7 @@ int getUserBalance(const char* uid) {
         http.end();
         return balance;
     } else {
-        fastSyslog.logf(LOG_ERR, "Error fetching Balance %d (took %lums)", httpResponseCode, elapsed);
+        FAST_LOGF(LOG_ERR, "Error fetching Balance %d (took %lums)", httpResponseCode, elapsed);
         http.end();
         return -1;
     }
@@ -87,7 +91,7 @@ int makePurchase(const char* uid, int amount, int product, const char* machine_i
 
     int httpResponseCode = http.POST(requestBody);
     unsigned long elapsed = millis() - startTime;
-    fastSyslog.logf(LOG_DEBUG, "makePurchase took %lums, code: %d", elapsed, httpResponseCode);
+    FAST_LOGF(LOG_DEBUG, "makePurchase took %lums, code: %d", elapsed, httpResponseCode);
 
     if (httpResponseCode == 200) {
         StaticJsonDocument<128> jsonResponse;
@@ -102,7 +106,7 @@ int makePurchase(const char* uid, int amount, int product, const char* machine_i
         int transactionId = jsonResponse["transaction_id"];
         return transactionId;
     } else {
-        fastSyslog.logf(LOG_ERR, "makePurchase failed %d (took %lums)", httpResponseCode, elapsed);
+        FAST_LOGF(LOG_ERR, "makePurchase failed %d (took %lums)", httpResponseCode, elapsed);
         http.end();
         return -1;
     }
@@ -147,7 +151,7 @@ int makeCashPurchase(int amount, int product, const char* machine_id) {
         return 1;
     } else {
         Serial.print("Purchase failed. HTTP code: ");
-        fastSyslog.logf(LOG_ERR, "Purchase Failed. HTTP code: %d", httpResponseCode);
+        FAST_LOGF(LOG_ERR, "Purchase Failed. HTTP code: %d", httpResponseCode);
         http.end();
         return -1;
     }
@@ -179,15 +183,223 @@ bool confirmPurchase(int transactionId) {
 
     int httpResponseCode = http.POST(requestBody);
     unsigned long elapsed = millis() - startTime;
-    fastSyslog.logf(LOG_DEBUG, "confirmPurchase took %lums, code: %d", elapsed, httpResponseCode);
+    FAST_LOGF(LOG_DEBUG, "confirmPurchase took %lums, code: %d", elapsed, httpResponseCode);
     http.end();
 
     if (httpResponseCode == 200) {
         return true;
     } else {
-        fastSyslog.logf(LOG_ERR, "confirmPurchase failed %d (took %lums)", httpResponseCode, elapsed);
+        FAST_LOGF(LOG_ERR, "confirmPurchase failed %d (took %lums)", httpResponseCode, elapsed);
+        return false;
+    }
+}
+
+// Parse a hex UID as formatted by formatUidString(). Returns the number of bytes, 0 if it is no valid UID.
+static byte parseUid(const char* uidHex, byte* uid, byte maxSize) {
+    size_t length = strlen(uidHex);
+    if (length == 0 || length % 2 != 0 || length / 2 > maxSize) return 0;
+    for (byte i = 0; i < length / 2; i++) {
+        char byteHex[3] = { uidHex[i * 2], uidHex[i * 2 + 1], 0 };
+        char* end;
+        uid[i] = strtoul(byteHex, &end, 16);
+        if (*end) return 0;
+    }
+    return length / 2;
+}
+
+// Fetch the whitelist changes since the version of the UID cache. The backend answers in pages:
+// {"version": 42, "reset": false, "more": false, "changes": [{"uid": "04A1B2C3D4E5F6", "token": 17, "flags": 0, "removed": false}]}
+// "reset" asks for a full resync, the cache is cleared before the changes of the page are applied.
+bool syncUidCache() {
+    if (WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+
+    if (resolved_api_base_url.length() == 0) {
+        return false;
+    }
+
+    for (uint8_t page = 0; page < UID_CACHE_SYNC_MAX_PAGES; page++) {
+        unsigned long startTime = millis();
+        HTTPClient http;
+        String url = String(api_base_url) + "/getUidChanges";
+        http.begin(url);
+        http.setTimeout(2000);  // 2 second timeout
+        http.addHeader("Content-Type", "application/json");
+        http.addHeader("X-API-Key", api_key);
+
+        StaticJsonDocument<128> jsonRequest;
+        jsonRequest["machine_id"] = MACHINE_ID;
+        jsonRequest["since"] = uidCache.version();
+        String requestBody;
+        serializeJson(jsonRequest, requestBody);
+
+        int httpResponseCode = http.POST(requestBody);
+        unsigned long elapsed = millis() - startTime;
+        if (httpResponseCode != 200) {
+            FAST_LOGF(LOG_ERR, "getUidChanges failed %d (took %lums)", httpResponseCode, elapsed);
+            http.end();
+            return false;
+        }
+
+        JsonDocument jsonResponse;
+        DeserializationError error = deserializeJson(jsonResponse, http.getString());
+        http.end();
+        if (error) {
+            FAST_LOG_ERROR("Failed to parse response.");
+            return false;
+        }
+
+        if (jsonResponse["reset"] | false) {
+            uidCache.clear();
+        }
+        JsonArray changes = jsonResponse["changes"];
+        for (JsonObject change : changes) {
+            byte uid[10];
+            byte size = parseUid(change["uid"] | "", uid, sizeof(uid));
+            if (size == 0) continue;
+            if (change["removed"] | false) {
+                uidCache.remove(uid, size);
+            } else if (!uidCache.put(uid, size, change["token"] | 0, change["flags"] | 0)) {
+                FAST_LOG_ERROR("UID cache full, unknown cards are checked by the backend");
+            }
+        }
+
+        uint32_t version = jsonResponse["version"] | uidCache.version();
+        bool more = jsonResponse["more"] | false;
+        if (!uidCache.commit(version, !more)) {
+            FAST_LOG_ERROR("Failed to store UID cache");
+            return false;
+        }
+        FAST_LOGF(LOG_INFO, "UID cache version %lu: %u changes, %u entries (took %lums)",
+                  (unsigned long)version, (unsigned)changes.size(), uidCache.entries(), elapsed);
+
+        if (!more) {
+            return true;
+        }
+    }
+    return true;
+}
+
+// Fetch the runtime log levels of this machine: {"levels": {"mdb": 7, "api": 6, "events": 6}}
+// A module missing from the answer goes back to its default level, only changed levels are written to NVS.
+bool syncLogLevels() {
+    if (WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+
+    if (resolved_api_base_url.length() == 0) {
+        return false;
+    }
+
+    HTTPClient http;
+    String url = String(api_base_url) + "/getLogLevels";
+    http.begin(url);
+    http.setTimeout(2000);  // 2 second timeout
+    http.addHeader("Content-Type", "application/json");
+    http.addHeader("X-API-Key", api_key);
+
+    StaticJsonDocument<128> jsonRequest;
+    jsonRequest["machine_id"] = MACHINE_ID;
+    String requestBody;
+    serializeJson(jsonRequest, requestBody);
+
+    int httpResponseCode = http.POST(requestBody);
+    if (httpResponseCode != 200) {
+        FAST_LOGF(LOG_DEBUG, "getLogLevels failed %d", httpResponseCode);
+        http.end();
+        return false;
+    }
+
+    StaticJsonDocument<256> jsonResponse;
+    DeserializationError error = deserializeJson(jsonResponse, http.getString());
+    http.end();
+    if (error) {
+        FAST_LOG_ERROR("Failed to parse response.");
+        return false;
+    }
+
+    JsonObject levels = jsonResponse["levels"];
+    for (uint8_t module = 0; module < FAST_LOG_MODULE_COUNT; module++) {
+        fastSyslog.setLevel(module, levels[FastSyslog::moduleName(module)] | FastSyslog::defaultLevel(module));
+    }
+    return true;
+}
+
+// Fetch the blocklist changes since the version of the filter, paged like the UID cache changes:
+// {"version": 7, "reset": false, "more": false, "blocked": ["04A1B2C3D4E5F6"], "unblocked": ["1A2B3C4D"]}
+bool syncBlocklist() {
+    if (WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+
+    if (resolved_api_base_url.length() == 0) {
         return false;
     }
+
+    for (uint8_t page = 0; page < UID_CACHE_SYNC_MAX_PAGES; page++) {
+        unsigned long startTime = millis();
+        HTTPClient http;
+        String url = String(api_base_url) + "/getBlocklistChanges";
+        http.begin(url);
+        http.setTimeout(2000);  // 2 second timeout
+        http.addHeader("Content-Type", "application/json");
+        http.addHeader("X-API-Key", api_key);
+
+        StaticJsonDocument<128> jsonRequest;
+        jsonRequest["machine_id"] = MACHINE_ID;
+        jsonRequest["since"] = blocklist.version();
+        String requestBody;
+        serializeJson(jsonRequest, requestBody);
+
+        int httpResponseCode = http.POST(requestBody);
+        unsigned long elapsed = millis() - startTime;
+        if (httpResponseCode != 200) {
+            FAST_LOGF(LOG_ERR, "getBlocklistChanges failed %d (took %lums)", httpResponseCode, elapsed);
+            http.end();
+            return false;
+        }
+
+        JsonDocument jsonResponse;
+        DeserializationError error = deserializeJson(jsonResponse, http.getString());
+        http.end();
+        if (error) {
+            FAST_LOG_ERROR("Failed to parse response.");
+            return false;
+        }
+
+        if (jsonResponse["reset"] | false) {
+            blocklist.clear();
+        }
+        // Unblocked UIDs first, their slots take the blocked ones of the same page
+        JsonArray unblocked = jsonResponse["unblocked"];
+        for (const char* uidHex : unblocked) {
+            byte uid[10];
+            byte size = parseUid(uidHex ? uidHex : "", uid, sizeof(uid));
+            if (size) blocklist.remove(uid, size);
+        }
+        JsonArray blocked = jsonResponse["blocked"];
+        for (const char* uidHex : blocked) {
+            byte uid[10];
+            byte size = parseUid(uidHex ? uidHex : "", uid, sizeof(uid));
+            if (size && !blocklist.add(uid, size)) {
+                FAST_LOG_ERROR("Blocklist full, raise BLOCKLIST_BUCKETS");
+            }
+        }
+
+        uint32_t version = jsonResponse["version"] | blocklist.version();
+        if (!blocklist.commit(version)) {
+            FAST_LOG_ERROR("Failed to store blocklist");
+            return false;
+        }
+        FAST_LOGF(LOG_INFO, "Blocklist version %lu: +%u -%u, %lu entries (took %lums)", (unsigned long)version,
+                  (unsigned)blocked.size(), (unsigned)unblocked.size(), (unsigned long)blocklist.entries(), elapsed);
+
+        if (!(jsonResponse["more"] | false)) {
+            return true;
+        }
+    }
+    return true;
 }
 
 void resolveServerHostname() {
@@ -205,14 +417,14 @@ void resolveServerHostname() {
         Serial.print("API Base URL set to: ");
         Serial.println(resolved_api_base_url);
 
-        fastSyslog.logf(LOG_INFO, "Resolved k3s-node1.local to %s", serverIP.toString().c_str());
+        FAST_LOGF(LOG_INFO, "Resolved k3s-node1.local to %s", serverIP.toString().c_str());
     } else {
         // Failed to resolve, fallback to hardcoded IP
         Serial.println("Failed to resolve k3s-node1.local via mDNS");
         Serial.println("Falling back to hardcoded IP address");
         resolved_api_base_url = String(api_base_url); // Use the original hardcoded URL
 
-        fastSyslog.logf(LOG_WARNING, "mDNS resolution failed, using fallback IP");
+        FAST_LOGF(LOG_WARNING, "mDNS resolution failed, using fallback IP");
     }
 }
 
@@ -254,12 +466,18 @@ void connectToWiFi() {
 }
 
 void wifi_loop(void *pvParameters) {
+    TickType_t lastTaskStats = xTaskGetTickCount();
     for (;;) {
         // Periodic check
         if (WiFi.status() != WL_CONNECTED) {
             Serial.println("WiFi Disconnected! Attempting reconnect...");
             connectToWiFi();
         }
+        if (FAST_SYSLOG_TASK_STATS_INTERVAL_MS &&
+            xTaskGetTickCount() - lastTaskStats >= pdMS_TO_TICKS(FAST_SYSLOG_TASK_STATS_INTERVAL_MS)) {
+            lastTaskStats = xTaskGetTickCount();
+            fastSyslog.logTaskStats();
+        }
         //ArduinoOTA.handle();
         vTaskDelay(10000 / portTICK_PERIOD_MS);  // Check every 10 seconds
     }
@@ -269,8 +487,17 @@ void cashsale_handler(void *pvParameters){
   CashSale_t cashsale_data;
   for(;;){
     if (xQueueReceive(cashSaleQueue, &cashsale_data, portMAX_DELAY) == pdPASS){
-      fastSyslog.logf(LOG_INFO, "cashsale item: %d cashsale_price: %d",cashsale_data.itemNumber,cashsale_data.itemPrice);
+      FAST_LOGF(LOG_INFO, "cashsale item: %d cashsale_price: %d",cashsale_data.itemNumber,cashsale_data.itemPrice);
       makeCashPurchase(cashsale_data.itemPrice, cashsale_data.itemNumber, MACHINE_ID);
     }
   }
 }
+
+void uid_cache_sync_loop(void *pvParameters) {
+    for (;;) {
+        syncBlocklist();
+        syncUidCache();
+        syncLogLevels();
+        vTaskDelay(UID_CACHE_SYNC_INTERVAL_MS / portTICK_PERIOD_MS);
+    }
+}
@@ -0,0 +1,246 @@
+#include "blocklist.h"
+#include "uid_cache.h"
+#include <Preferences.h>
+#include <esp_system.h>
+
+Blocklist blocklist;
+
+Blocklist::Blocklist() : mUsed(0), mVersion(0), mOverflow(false), mVictimUsed(false), mLock(nullptr) {
+    memset(mBuckets, 0, sizeof(mBuckets));
+    memset(mDirty, 0, sizeof(mDirty));
+    memset(&mVictim, 0, sizeof(mVictim));
+}
+
+bool Blocklist::begin() {
+    if (!mLock) mLock = xSemaphoreCreateMutex();
+    if (!mLock) return false;
+
+    clear();
+    Preferences prefs;
+    if (!cardStoreBegin() || !prefs.begin(BLOCKLIST_NAMESPACE, true, CARD_STORE_PARTITION)) return true; // Nothing stored yet
+
+    // A filter of another size or one whose commit() did not complete (version 0) is dropped, the next sync loads
+    // the blocklist again
+    bool valid = prefs.getUInt("layout", 0) == sizeof(mBuckets) && prefs.getUInt("version", 0) != 0 &&
+                 prefs.getBytes("victim", &mVictim, sizeof(mVictim)) == sizeof(mVictim);
+    for (uint16_t chunk = 0; valid && chunk < CHUNKS; chunk++) {
+        char name[8];
+        snprintf(name, sizeof(name), "c%u", chunk);
+        size_t length = BLOCKLIST_CHUNK_BUCKETS * sizeof(mBuckets[0]);
+        valid = prefs.getBytes(name, mBuckets[chunk * BLOCKLIST_CHUNK_BUCKETS], length) == length;
+    }
+    if (valid) {
+        mVersion = prefs.getUInt("version", 0);
+        mOverflow = prefs.getBool("overflow", false);
+    }
+    prefs.end();
+
+    if (!valid) {
+        clear();
+        return true;
+    }
+    memset(mDirty, 0, sizeof(mDirty));
+    mVictimUsed = mVictim.fingerprint != 0;
+    mUsed = mVictimUsed ? 1 : 0;
+    for (uint32_t bucket = 0; bucket < BLOCKLIST_BUCKETS; bucket++) {
+        for (uint8_t slot = 0; slot < SLOTS; slot++) {
+            if (mBuckets[bucket][slot]) mUsed++;
+        }
+    }
+    return true;
+}
+
+bool Blocklist::contains(const byte *uid, byte size) {
+    uint16_t fingerprint;
+    uint32_t bucket1, bucket2;
+    locate(uid, size, fingerprint, bucket1, bucket2);
+
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    bool found = findIn(bucket1, fingerprint) || findIn(bucket2, fingerprint) ||
+                 (mVictimUsed && mVictim.fingerprint == fingerprint &&
+                  (mVictim.bucket == bucket1 || mVictim.bucket == bucket2));
+    xSemaphoreGive(mLock);
+    return found;
+}
+
+void Blocklist::clear() {
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    memset(mBuckets, 0, sizeof(mBuckets));
+    memset(mDirty, 0xFF, sizeof(mDirty));
+    memset(&mVictim, 0, sizeof(mVictim));
+    mVictimUsed = false;
+    mUsed = 0;
+    mVersion = 0;
+    mOverflow = false;
+    xSemaphoreGive(mLock);
+}
+
+// A UID added twice needs two removes, like in every cuckoo filter. A UID that only matches the fingerprint of another
+// one must still get its own copy, or removing the other one would unblock it.
+bool Blocklist::add(const byte *uid, byte size) {
+    uint16_t fingerprint;
+    uint32_t bucket1, bucket2;
+    locate(uid, size, fingerprint, bucket1, bucket2);
+
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    bool added = true;
+    if (insertInto(bucket1, fingerprint) || insertInto(bucket2, fingerprint)) {
+        mUsed++;
+    } else if (mVictimUsed) {
+        // The last relocation chain did not end in a free slot, the filter is full
+        mOverflow = true;
+        added = false;
+    } else {
+        // Relocate fingerprints to their other bucket until one finds a free slot
+        uint32_t bucket = (esp_random() & 1) ? bucket1 : bucket2;
+        for (uint16_t kick = 0; kick < BLOCKLIST_MAX_KICKS; kick++) {
+            uint8_t slot = esp_random() % SLOTS;
+            uint16_t evicted = mBuckets[bucket][slot];
+            mBuckets[bucket][slot] = fingerprint;
+            markDirty(bucket);
+            fingerprint = evicted;
+            bucket = altBucket(bucket, fingerprint);
+            if (insertInto(bucket, fingerprint)) {
+                fingerprint = 0;
+                break;
+            }
+        }
+        // The fingerprint left over is kept aside, contains() checks it as well
+        if (fingerprint) {
+            mVictim.fingerprint = fingerprint;
+            mVictim.bucket = bucket;
+            mVictimUsed = true;
+        }
+        mUsed++;
+    }
+    xSemaphoreGive(mLock);
+    return added;
+}
+
+void Blocklist::remove(const byte *uid, byte size) {
+    uint16_t fingerprint;
+    uint32_t bucket1, bucket2;
+    locate(uid, size, fingerprint, bucket1, bucket2);
+
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    bool removed = eraseFrom(bucket1, fingerprint) || eraseFrom(bucket2, fingerprint);
+    if (!removed && mVictimUsed && mVictim.fingerprint == fingerprint &&
+        (mVictim.bucket == bucket1 || mVictim.bucket == bucket2)) {
+        memset(&mVictim, 0, sizeof(mVictim));
+        mVictimUsed = false;
+        removed = true;
+    }
+    if (removed) {
+        mUsed--;
+        // The free slot may take the fingerprint kept aside
+        if (mVictimUsed && (insertInto(mVictim.bucket, mVictim.fingerprint) ||
+                            insertInto(altBucket(mVictim.bucket, mVictim.fingerprint), mVictim.fingerprint))) {
+            memset(&mVictim, 0, sizeof(mVictim));
+            mVictimUsed = false;
+        }
+    }
+    xSemaphoreGive(mLock);
+}
+
+bool Blocklist::commit(uint32_t version) {
+    Preferences prefs;
+    if (!cardStoreBegin()) {
+        xSemaphoreTake(mLock, portMAX_DELAY);
+        mVersion = version;
+        xSemaphoreGive(mLock);
+        return true;
+    }
+    if (!prefs.begin(BLOCKLIST_NAMESPACE, false, CARD_STORE_PARTITION)) {
+        keepUncommitted(version);
+        return false;
+    }
+
+    // The stored version is invalidated before the first chunk is written: chunks of the old and the new version
+    // never pass as a complete filter, begin() drops them after a reset in between.
+    // Chunks are copied under the lock, the flash writes run without it so lookups are not blocked
+    bool ok = prefs.putUInt("version", 0) > 0 && prefs.putUInt("layout", sizeof(mBuckets)) > 0;
+    uint16_t chunkCopy[BLOCKLIST_CHUNK_BUCKETS][SLOTS];
+    for (uint16_t chunk = 0; ok && chunk < CHUNKS; chunk++) {
+        xSemaphoreTake(mLock, portMAX_DELAY);
+        bool dirty = mDirty[chunk / 32] & (1u << (chunk % 32));
+        if (dirty) {
+            memcpy(chunkCopy, mBuckets[chunk * BLOCKLIST_CHUNK_BUCKETS], sizeof(chunkCopy));
+            mDirty[chunk / 32] &= ~(1u << (chunk % 32));
+        }
+        xSemaphoreGive(mLock);
+        if (!dirty) continue;
+
+        char name[8];
+        snprintf(name, sizeof(name), "c%u", chunk);
+        ok = prefs.putBytes(name, chunkCopy, sizeof(chunkCopy)) == sizeof(chunkCopy);
+    }
+
+    // The version is written last and makes the stored filter valid again
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    Victim victim = mVictim;
+    bool overflow = mOverflow;
+    if (ok) mVersion = version;
+    xSemaphoreGive(mLock);
+    if (ok) {
+        ok = prefs.putBytes("victim", &victim, sizeof(victim)) == sizeof(victim) &&
+             prefs.putBool("overflow", overflow) && prefs.putUInt("version", version) > 0;
+    }
+    prefs.end();
+    if (!ok) keepUncommitted(version);
+    return ok;
+}
+
+// After a failed commit() the filter in memory holds the changes up to version and keeps rejecting the blocked cards,
+// a cleared filter would let them all in until the next sync. The stored filter stays invalid (version 0) or at its
+// old version, every chunk is written again by the next commit().
+void Blocklist::keepUncommitted(uint32_t version) {
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    mVersion = version;
+    memset(mDirty, 0xFF, sizeof(mDirty));
+    xSemaphoreGive(mLock);
+}
+
+// The hash of the UID cache gives the fingerprint (high bits) and the first bucket (low bits)
+void Blocklist::locate(const byte *uid, byte size, uint16_t &fingerprint, uint32_t &bucket1, uint32_t &bucket2) {
+    uint64_t key = UidCache::keyOf(uid, size);
+    fingerprint = key >> 48;
+    if (fingerprint == 0) fingerprint = 1;
+    bucket1 = (uint32_t)key & (BLOCKLIST_BUCKETS - 1);
+    bucket2 = altBucket(bucket1, fingerprint);
+}
+
+// Partial-key cuckoo hashing: the other bucket only depends on the bucket and the fingerprint, altBucket() of the
+// result gives the bucket back, so a fingerprint can be relocated without its UID
+uint32_t Blocklist::altBucket(uint32_t bucket, uint16_t fingerprint) {
+    return (bucket ^ (fingerprint * 0x5BD1E995u)) & (BLOCKLIST_BUCKETS - 1);
+}
+
+// Called with mLock held
+bool Blocklist::findIn(uint32_t bucket, uint16_t fingerprint) const {
+    const uint16_t *slots = mBuckets[bucket];
+    return slots[0] == fingerprint || slots[1] == fingerprint || slots[2] == fingerprint || slots[3] == fingerprint;
+}
+
+// Called with mLock held
+bool Blocklist::insertInto(uint32_t bucket, uint16_t fingerprint) {
+    for (uint8_t slot = 0; slot < SLOTS; slot++) {
+        if (mBuckets[bucket][slot] == 0) {
+            mBuckets[bucket][slot] = fingerprint;
+            markDirty(bucket);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Called with mLock held
+bool Blocklist::eraseFrom(uint32_t bucket, uint16_t fingerprint) {
+    for (uint8_t slot = 0; slot < SLOTS; slot++) {
+        if (mBuckets[bucket][slot] == fingerprint) {
+            mBuckets[bucket][slot] = 0;
+            markDirty(bucket);
+            return true;
+        }
+    }
+    return false;
+}
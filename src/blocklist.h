@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#ifndef BLOCKLIST_BUCKETS
+#define BLOCKLIST_BUCKETS 2048      // Buckets of 4 fingerprints, a power of two. 16 KB hold about 7800 blocked cards
+#endif
+#define BLOCKLIST_CHUNK_BUCKETS 256 // Buckets per NVS blob, a sync only writes the chunks it changed
+#define BLOCKLIST_MAX_KICKS 500     // Relocations before an insert gives up
+#define BLOCKLIST_NAMESPACE "blocklist"
+
+// Blocked card UIDs as a cuckoo filter with 16 bit fingerprints, persisted in the card store partition.
+//
+// A UID is in one of two buckets of 4 slots derived from its hash (UidCache::keyOf()), so contains() reads at most 8
+// fingerprints. Unlike a Bloom filter the cuckoo filter can delete, the backend pushes versioned deltas of blocked
+// and unblocked UIDs (syncBlocklist()). A false positive (below 0.02 % at full load) blocks a valid card, the exact
+// entry of the UID cache overrides it in reader_loop.
+class Blocklist {
+public:
+    Blocklist();
+    bool begin(); // Loads the filter from the card store
+    bool contains(const byte *uid, byte size);
+
+    // Sync from the backend: clear() for a full resync, add() and remove() the changes, commit() the new version
+    void clear();
+    bool add(const byte *uid, byte size);
+    void remove(const byte *uid, byte size);
+    bool commit(uint32_t version);
+
+    uint32_t version() const { return mVersion; }
+    uint32_t entries() const { return mUsed; }
+    bool overflow() const { return mOverflow; }
+    static size_t memoryUse() { return sizeof(Blocklist); }
+
+private:
+    static const uint8_t SLOTS = 4;
+    static const uint16_t CHUNKS = BLOCKLIST_BUCKETS / BLOCKLIST_CHUNK_BUCKETS;
+
+    struct Victim {
+        uint16_t fingerprint; // Fingerprint that found no slot, 0 if none
+        uint32_t bucket;      // One of its two buckets
+    };
+
+    static void locate(const byte *uid, byte size, uint16_t &fingerprint, uint32_t &bucket1, uint32_t &bucket2);
+    static uint32_t altBucket(uint32_t bucket, uint16_t fingerprint);
+    bool findIn(uint32_t bucket, uint16_t fingerprint) const;
+    bool insertInto(uint32_t bucket, uint16_t fingerprint);
+    bool eraseFrom(uint32_t bucket, uint16_t fingerprint);
+    void keepUncommitted(uint32_t version);
+    void markDirty(uint32_t bucket) { mDirty[bucket / BLOCKLIST_CHUNK_BUCKETS / 32] |= 1u << (bucket / BLOCKLIST_CHUNK_BUCKETS % 32); }
+
+private:
+    uint16_t mBuckets[BLOCKLIST_BUCKETS][SLOTS]; // Fingerprints, 0 is a free slot
+    uint32_t mDirty[(CHUNKS + 31) / 32];         // Chunks changed since the last commit()
+    uint32_t mUsed;
+    uint32_t mVersion;                           // Backend version of the filter, 0 until the first sync
+    bool mOverflow;                              // An add() failed, blocked cards may be missing
+    Victim mVictim;
+    bool mVictimUsed;
+    SemaphoreHandle_t mLock;
+};
+
+extern Blocklist blocklist;
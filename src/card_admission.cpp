@@ -0,0 +1,26 @@
+#include "card_admission.h"
+
+// A card without proof of its key is rejected before its UID is looked up, a clone of a valid UID gets no session.
+// A blocklist hit of a card the UID cache knows as not blocked is a false positive of the filter.
+CardAdmission admitCard(const byte *uid, byte size, bool authenticated, UidCache::Lookup &lookup,
+                        UidCache::Entry &account) {
+    lookup = UidCache::Lookup::NOT_SYNCED;
+    if (!authenticated && !CARD_ALLOW_UID_ONLY) return CardAdmission::UNAUTHENTICATED;
+
+    lookup = uidCache.find(uid, size, account);
+    bool blocked = (lookup == UidCache::Lookup::FOUND) ? (account.flags & UID_CACHE_FLAG_BLOCKED)
+                                                        : blocklist.contains(uid, size);
+    if (blocked) return CardAdmission::BLOCKED;
+    if (lookup == UidCache::Lookup::UNKNOWN) return CardAdmission::UNKNOWN;
+    return CardAdmission::ACCEPTED;
+}
+
+const char *cardAdmissionName(CardAdmission admission) {
+    switch (admission) {
+    case CardAdmission::ACCEPTED: return "accepted";
+    case CardAdmission::UNAUTHENTICATED: return "unauthenticated";
+    case CardAdmission::BLOCKED: return "blocked";
+    case CardAdmission::UNKNOWN: return "unknown";
+    }
+    return "?";
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+#include "uid_cache.h"
+#include "blocklist.h"
+
+// Legacy cards without a key (MIFARE Classic, unprovisioned Ultralight) are only identified by their UID, which any
+// clone repeats. Set to 1 in build_flags to accept them, and cards that failed their authentication, by UID alone.
+#ifndef CARD_ALLOW_UID_ONLY
+#define CARD_ALLOW_UID_ONLY 0
+#endif
+
+enum class CardAdmission : uint8_t {
+    ACCEPTED,        // Known account or no complete whitelist yet, the backend decides
+    UNAUTHENTICATED, // No proof of the card key: failed Ultralight C, NTAG or DESFire authentication or no key at all
+    BLOCKED,
+    UNKNOWN,         // Not in the synced whitelist
+};
+
+// Decides on a read card before any network request. authenticated is the result of CardReader::read(), lookup and
+// account are the UID cache entry, account is set if lookup is FOUND.
+CardAdmission admitCard(const byte *uid, byte size, bool authenticated, UidCache::Lookup &lookup,
+                        UidCache::Entry &account);
+const char *cardAdmissionName(CardAdmission admission);
@@ -1,31 +1,162 @@
 #include "cardreader.h"
 #include <SPI.h>
+#include <esp_system.h>
+#include "secrets.h"
 
-CardReader::CardReader() : mMFRC(SS_PIN, RST_PIN), mInitialized(false) {}
+#ifndef CARD_MASTER_KEY
+#warning "CARD_MASTER_KEY is not set in secrets.h, falling back to the Ultralight C factory key"
+#define CARD_MASTER_KEY { 0x49, 0x45, 0x4D, 0x4B, 0x41, 0x45, 0x52, 0x42, 0x21, 0x4E, 0x41, 0x43, 0x55, 0x4F, 0x59, 0x46 }
+#endif
+#ifndef DESFIRE_MASTER_KEY
+#warning "DESFIRE_MASTER_KEY is not set in secrets.h, falling back to the DESFire default AES key"
+#define DESFIRE_MASTER_KEY { 0 }
+#endif
+
+static constexpr EventBits_t PRESENCE_TRACKING = BIT0;
+static constexpr EventBits_t PRESENCE_REMOVED = BIT1;
+
+CardReader::CardReader(byte ssPin, byte rstPin, byte irqPin, SpiBusScheduler *bus, uint8_t slot)
+    : mMFRC(ssPin, rstPin), mSsPin(ssPin), mRstPin(rstPin), mIrqPin(irqPin), mBus(bus), mSlot(slot),
+      mSelectPolicy(preferWalletCards), mInitialized(false), mVersion(0), mNextHealthCheck(0), mLastSelfTest(0),
+      mBackoffMs(CARD_READER_BACKOFF_MIN_MS), mSelfTestPassed(false), mPresenceEvents(nullptr), mPresenceLock(nullptr),
+      mProbeIntervalMs(CARD_PRESENCE_INTERVAL_MS), mProbeDebounce(CARD_PRESENCE_DEBOUNCE), mMissedProbes(0) {
+    const byte masterKey[16] = CARD_MASTER_KEY;
+    mbedtls_des3_init(&mMasterKey);
+    mbedtls_des3_set2key_enc(&mMasterKey, masterKey);
+    memset(&mHealth, 0, sizeof(mHealth));
+}
 
 Result CardReader::begin() {
     if (mInitialized) return Result::OK;
 
-    SPI.begin(SCK_PIN, MISO_PIN, MOSI_PIN, SS_PIN);
-    pinMode(RST_PIN, OUTPUT);
-    digitalWrite(RST_PIN, LOW);
-    delay(10);
-    digitalWrite(RST_PIN, HIGH);
-  
-    mMFRC.PCD_Init(SS_PIN, RST_PIN);
-    byte version = mMFRC.PCD_ReadRegister(MFRC522::VersionReg);
-
-    if (version == 0x00 || version == 0xFF) {
+    SpiBusScheduler::Guard guard(mBus, mSlot);
+    SPI.begin(SCK_PIN, MISO_PIN, MOSI_PIN, mSsPin); // No-op for all but the first reader on the bus
+    if (initPcd() != Result::OK) {
         ERROR_PRINT("MFRC522 Communication failure");
         return Result::ERROR;
     }
 
+    if (mIrqPin != MFRC522::UNUSED_PIN) {
+        pinMode(mIrqPin, INPUT_PULLUP);
+        attachInterruptArg(mIrqPin, onIrq, this, FALLING);
+    }
+
+    if (!mPresenceEvents) {
+        mPresenceEvents = xEventGroupCreate();
+        mPresenceLock = xSemaphoreCreateMutex();
+        char taskName[16];
+        snprintf(taskName, sizeof(taskName), "presence%u", mSlot);
+        xTaskCreatePinnedToCore(presenceTask, taskName, 3072, this, 2, NULL, 0);
+    }
+
     INFO_PRINT("RFID initialized successfully");
     mInitialized = true;
+    mHealth.healthy = true;
+    mNextHealthCheck = millis() + CARD_READER_HEALTH_INTERVAL_MS;
+    mLastSelfTest = millis();
     return Result::OK;
 }
 
-Result CardReader::read(Uid &iUid, bool &isUltralightC, CardSecret &iSecret) {
+// Hard reset through the RST pin and initialization of the MFRC522, called with the bus held
+Result CardReader::initPcd() {
+    if (mRstPin != MFRC522::UNUSED_PIN) {
+        pinMode(mRstPin, OUTPUT);
+        digitalWrite(mRstPin, LOW);
+        delay(10);
+        digitalWrite(mRstPin, HIGH);
+    }
+
+    mMFRC.PCD_Init(mSsPin, mRstPin);
+    byte version = mMFRC.PCD_ReadRegister(MFRC522::VersionReg);
+    if (version == 0x00 || version == 0xFF) {
+        return Result::ERROR;
+    }
+    // Only the first init records the version: a recovery that brings up a different value stays unhealthy in checkHealth()
+    if (mVersion == 0) mVersion = version;
+    applyRfSettings(); // PCD_Init() wrote the defaults
+
+    if (mIrqPin != MFRC522::UNUSED_PIN) {
+        // IRQ pin active low while RxIRq is set, i.e. after a PICC answered. Cleared by the next command.
+        mMFRC.PCD_WriteRegister(MFRC522::ComIEnReg, 0xA0);
+    }
+    return Result::OK;
+}
+
+bool CardReader::maintain() {
+    uint32_t now = millis();
+    if ((int32_t)(now - mNextHealthCheck) < 0) return mHealth.healthy;
+
+    if (mHealth.healthy) {
+        bool selfTest = now - mLastSelfTest >= CARD_READER_SELF_TEST_INTERVAL_MS;
+        if (selfTest) mLastSelfTest = now;
+        if (checkHealth(selfTest) == Result::OK) {
+            mNextHealthCheck = now + CARD_READER_HEALTH_INTERVAL_MS;
+            return true;
+        }
+        ERROR_PRINT("❌ RFID reader failed its health check, resetting it");
+        mHealth.failures++;
+        mHealth.healthy = false;
+        mBackoffMs = CARD_READER_BACKOFF_MIN_MS;
+    }
+
+    // Recovery: hard reset and initialization, the reader must pass the check afterwards
+    mHealth.resets++;
+    Result result;
+    if (!mInitialized) {
+        result = begin();
+    } else {
+        SpiBusScheduler::Guard guard(mBus, mSlot);
+        result = initPcd();
+    }
+    if (result == Result::OK && checkHealth(false) == Result::OK) {
+        INFO_PRINT("✅ RFID reader recovered");
+        mHealth.healthy = true;
+        mHealth.recoveries++;
+        mBackoffMs = CARD_READER_BACKOFF_MIN_MS;
+        mNextHealthCheck = millis() + CARD_READER_HEALTH_INTERVAL_MS;
+        return true;
+    }
+
+    mHealth.healthy = false;
+    mNextHealthCheck = millis() + mBackoffMs;
+    mBackoffMs = mBackoffMs * 2 < CARD_READER_BACKOFF_MAX_MS ? mBackoffMs * 2 : CARD_READER_BACKOFF_MAX_MS;
+    return false;
+}
+
+// VersionReg as read by begin(), the configuration of PCD_Init() a brown-out resets, a write/read pattern on
+// WaterLevelReg (unused by the library) and, if selfTest, the digital self test of the datasheet (16.1.1). The self
+// test resets the chip, it is initialized again afterwards.
+Result CardReader::checkHealth(bool selfTest) {
+    static const byte patterns[] = { 0x2A, 0x15 };
+    SpiBusScheduler::Guard guard(mBus, mSlot);
+    mHealth.checks++;
+
+    if (mMFRC.PCD_ReadRegister(MFRC522::VersionReg) != mVersion) return Result::ERROR;
+    if (mMFRC.PCD_ReadRegister(MFRC522::TModeReg) != 0x80) return Result::ERROR;              // TAuto
+    if ((mMFRC.PCD_ReadRegister(MFRC522::TxControlReg) & 0x03) != 0x03) return Result::ERROR; // Antenna on
+
+    byte waterLevel = mMFRC.PCD_ReadRegister(MFRC522::WaterLevelReg);
+    for (byte pattern : patterns) {
+        mMFRC.PCD_WriteRegister(MFRC522::WaterLevelReg, pattern);
+        if ((mMFRC.PCD_ReadRegister(MFRC522::WaterLevelReg) & 0x3F) != pattern) return Result::ERROR;
+    }
+    mMFRC.PCD_WriteRegister(MFRC522::WaterLevelReg, waterLevel);
+
+    if (selfTest) {
+        mHealth.selfTests++;
+        bool passed = mMFRC.PCD_PerformSelfTest();
+        if (initPcd() != Result::OK) return Result::ERROR;
+        if (passed) {
+            mSelfTestPassed = true;
+        } else {
+            mHealth.selfTestFailures++;
+            if (mSelfTestPassed) return Result::ERROR;
+        }
+    }
+    return Result::OK;
+}
+
+Result CardReader::read(Uid &iUid, bool &isAuthenticated, CardSecret &iSecret) {
     if (!mInitialized) {
         if (begin() != Result::OK) {
             ERROR_PRINT("❌ Could not initialize RFID module!");
@@ -33,28 +164,51 @@ Result CardReader::read(Uid &iUid, bool &isUltralightC, CardSecret &iSecret) {
         }
     }
 
-    // 🔹 Step 1: Ensure the card is still present before trying to read
+    // 🔹 Step 1: Find all cards in the field in one pass, stacked cards no longer fail every select
+    // The bus is only held while talking to the reader, never across the retry delays, so other readers get their turn
+    MFRC522::Uid uids[CARD_READER_MAX_CARDS];
+    byte count = 0;
+    bool selected = false;
+    mMFRC.uid.size = 0; // Nothing selected yet, see trackCard()
     int retry_count = 3;
-    while (!mMFRC.PICC_IsNewCardPresent() && retry_count-- > 0) {
+    while (!enumerateCards(uids, count, selected) && retry_count-- > 0) {
         vTaskDelay(50 / portTICK_PERIOD_MS);  // ✅ Give time for a weak card signal to register
     }
 
-    if (retry_count <= 0) {
+    if (count == 0) {
         Serial.println("❌ No card detected after retries.");
         return Result::ERROR;
     }
 
-    // 🔹 Step 2: Try reading the card serial number with retries
-    retry_count = 3;
-    while (!mMFRC.PICC_ReadCardSerial() && retry_count-- > 0) {
-        Serial.println("🔄 Read failed. Retrying...");
-        vTaskDelay(100 / portTICK_PERIOD_MS);  // ✅ Allow brief gap before retrying
+    // 🔹 Step 2: Let the policy pick the cashless card and select it
+    Uid candidates[CARD_READER_MAX_CARDS];
+    for (byte i = 0; i < count; i++) {
+        memcpy(candidates[i].uidByte, uids[i].uidByte, uids[i].size);
+        candidates[i].size = uids[i].size;
+        candidates[i].sak = MFRC522::PICC_GetType(uids[i].sak);
     }
-
-    if (retry_count <= 0) {
-        Serial.println("❌ Read failed after multiple retries.");
+    int choice = mSelectPolicy(candidates, count);
+    if (choice < 0 || choice >= count) {
+        mMFRC.uid.size = 0;
+        Serial.println("❌ No usable card in the field.");
         return Result::ERROR;
     }
+    if (count > 1) {
+        Serial.printf("🔀 %u cards in the field, using card %d\n", count, choice);
+    }
+
+    // A single card is still selected by the enumeration
+    if (!selected) {
+        retry_count = 3;
+        while (!selectCard(uids[choice])) {
+            if (retry_count-- <= 0) {
+                Serial.println("❌ Select failed after multiple retries.");
+                return Result::ERROR;
+            }
+            Serial.println("🔄 Select failed. Retrying...");
+            vTaskDelay(100 / portTICK_PERIOD_MS);  // ✅ Allow brief gap before retrying
+        }
+    }
 
     Serial.println("✅ Card serial number read!");
 
@@ -63,6 +217,19 @@ Result CardReader::read(Uid &iUid, bool &isUltralightC, CardSecret &iSecret) {
     iUid.size = mMFRC.uid.size;
     iUid.sak = mMFRC.PICC_GetType(mMFRC.uid.sak);
 
+    // 🔹 Ultralight C and NTAG21x cards and DESFire badges prove they hold their diversified key, other cards are identified by UID only
+    isAuthenticated = false;
+    {
+        SpiBusScheduler::Guard guard(mBus, mSlot);
+        if (iUid.sak == MFRC522::PICC_TYPE_MIFARE_UL && isNtag()) {
+            isAuthenticated = authenticateNtag(iUid) == Result::OK && readCardSecret(iSecret, true) == Result::OK;
+        } else if (iUid.sak == MFRC522::PICC_TYPE_MIFARE_UL) {
+            isAuthenticated = authenticateUltralightC(iUid) == Result::OK && readCardSecret(iSecret, false) == Result::OK;
+        } else if (iUid.sak == MFRC522::PICC_TYPE_ISO_14443_4) {
+            isAuthenticated = readDesfireSecret(iUid, iSecret) == Result::OK;
+        }
+    }
+
     // 🔹 Step 3: Properly reset RFID Module for next read
     //mMFRC.PICC_HaltA();        // Halt communication with the card
     //mMFRC.PCD_StopCrypto1();   // Stop encryption (if used)
@@ -88,8 +255,29 @@ Result CardReader::getUid(Uid &iUid, bool &isUltralightC) {
     return Result::OK;
 }
 
-Result CardReader::authenticateUltralightC() {
-    MFRC522::StatusCode status = mMFRC.MIFARE_UL_C_Auth(mSecretKey);
+// NTAG21x answer GET_VERSION. The Ultralight C has the same SAK but NAKs it and falls back to IDLE, it is selected again.
+bool CardReader::isNtag() {
+    byte version[10];
+    byte size = sizeof(version);
+    MFRC522::StatusCode status = mMFRC.MIFARE_Ultralight_GetVersion(version, &size);
+    recordAttempt(status);
+    if (status == MFRC522::STATUS_OK) {
+        return version[1] == 0x04 && version[2] == 0x04; // NXP, NTAG
+    }
+    MFRC522::Uid uid = mMFRC.uid;
+    recordAttempt(mMFRC.PICC_SelectByUid(&uid));
+    return false;
+}
+
+Result CardReader::authenticateUltralightC(const Uid &iUid) {
+    byte key[16];
+    byte rndA[8];
+    deriveCardKey(iUid, key);
+    esp_fill_random(rndA, sizeof(rndA));
+
+    MFRC522::StatusCode status = mMFRC.MIFARE_UL_C_Auth(key, rndA);
+    memset(key, 0, sizeof(key));
+    recordAttempt(status);
     if (status != MFRC522::STATUS_OK) {
         ERROR_PRINT("Authentication failed!");
         return Result::ERROR;
@@ -99,28 +287,248 @@ Result CardReader::authenticateUltralightC() {
     return Result::OK;
 }
 
-Result CardReader::readCardSecret(CardSecret &iSecret) {
-    byte readBuffer[18];
-    byte readBufferSize = sizeof(readBuffer);
-  
-    for (int block = 0x20; block <= 0x24; block += 4) {
-        MFRC522::StatusCode status = mMFRC.MIFARE_Read(block, readBuffer, &readBufferSize);
-        if (status == MFRC522::STATUS_OK) {
-            memcpy(&iSecret.secret[(block - 0x20) * 4], readBuffer, 16);
-        } else {
-            ERROR_PRINT("Reading card secret failed!");
-            return Result::ERROR;
-        }
+// PWD_AUTH with the per-card password. The PACK proves the card knows the password as well, a clone answering every
+// password with a fixed PACK is rejected.
+Result CardReader::authenticateNtag(const Uid &iUid) {
+    byte password[4];
+    byte expectedPack[2];
+    byte pack[2];
+    deriveNtagPassword(iUid, password, expectedPack);
+
+    MFRC522::StatusCode status = mMFRC.PCD_NTAG216_AUTH(password, pack);
+    memset(password, 0, sizeof(password));
+    recordAttempt(status);
+    if (status != MFRC522::STATUS_OK) {
+        ERROR_PRINT("NTAG password authentication failed!");
+        return Result::ERROR;
+    }
+    if (memcmp(pack, expectedPack, sizeof(pack)) != 0) {
+        ERROR_PRINT("NTAG PACK mismatch!");
+        return Result::ERROR;
+    }
+
+    INFO_PRINT("NTAG Card Authenticated!");
+    return Result::OK;
+}
+
+// fastRead: one FAST_READ for the whole secret on NTAG21x. Ultralight C has no FAST_READ and would drop the
+// authentication on the NAK, it is read with READ.
+Result CardReader::readCardSecret(CardSecret &iSecret, bool fastRead) {
+    MFRC522::StatusCode status = mMFRC.MIFARE_Ultralight_ReadPages(CARD_SECRET_PAGE, sizeof(iSecret.secret) / 4,
+                                                                   iSecret.secret, sizeof(iSecret.secret), fastRead);
+    recordAttempt(status);
+    if (status != MFRC522::STATUS_OK) {
+        ERROR_PRINT("Reading card secret failed!");
+        return Result::ERROR;
     }
 
     INFO_PRINT("Card secret read successfully.");
     return Result::OK;
 }
+
+// ISO 14443-4 session at up to DESFIRE_MAX_BITRATE, AES authentication with the badge key, MACed read of the secret
+Result CardReader::readDesfireSecret(const Uid &iUid, CardSecret &iSecret) {
+    const byte masterKey[16] = DESFIRE_MASTER_KEY;
+    byte input[10 + 3];
+    byte key[16];
+    Desfire desfire(mMFRC);
+
+    if (desfire.activate(DESFIRE_MAX_BITRATE) != Result::OK) {
+        ERROR_PRINT("DESFire activation failed!");
+        return Result::ERROR;
+    }
+
+    // Diversification input UID || AID, the key of one badge and application does not expose others
+    memcpy(input, iUid.uidByte, iUid.size);
+    input[iUid.size] = (byte)DESFIRE_WALLET_AID;
+    input[iUid.size + 1] = (byte)(DESFIRE_WALLET_AID >> 8);
+    input[iUid.size + 2] = (byte)(DESFIRE_WALLET_AID >> 16);
+    Desfire::diversifyKey(masterKey, input, iUid.size + 3, key);
+
+    Result result = desfire.selectApplication(DESFIRE_WALLET_AID);
+    if (result == Result::OK) {
+        result = desfire.authenticateAes(DESFIRE_WALLET_KEY_NO, key);
+        if (result != Result::OK) ERROR_PRINT("DESFire authentication failed!");
+    }
+    if (result == Result::OK) {
+        result = desfire.readData(DESFIRE_WALLET_FILE_NO, 0, iSecret.secret, sizeof(iSecret.secret), Desfire::CommMode::MACED);
+        if (result != Result::OK) ERROR_PRINT("Reading DESFire secret failed!");
+    }
+    memset(key, 0, sizeof(key));
+    desfire.deselect();
+
+    if (result == Result::OK) {
+        INFO_PRINT("DESFire badge authenticated, secret read successfully.");
+    }
+    return result;
+}
+
+// Per-card 3DES key: ek(UID || 0x80 padding) under CARD_MASTER_KEY, a leaked card key does not expose other cards
+void CardReader::deriveCardKey(const Uid &iUid, byte key[16]) {
+    byte input[16] = { 0 };
+    byte iv[8] = { 0 };
+    memcpy(input, iUid.uidByte, iUid.size);
+    input[iUid.size] = 0x80;
+    mbedtls_des3_crypt_cbc(&mMasterKey, MBEDTLS_DES_ENCRYPT, sizeof(input), iv, input, key);
+}
+
+// Per-card NTAG password and PACK: ek(0x4E || UID || 0x80 padding) under CARD_MASTER_KEY, bytes 0..3 are the
+// password and 4..5 the PACK. The prefix keeps them apart from the Ultralight C keys of the same master key.
+void CardReader::deriveNtagPassword(const Uid &iUid, byte password[4], byte pack[2]) {
+    byte input[16] = { 0x4E };
+    byte output[16];
+    byte iv[8] = { 0 };
+    memcpy(&input[1], iUid.uidByte, iUid.size);
+    input[1 + iUid.size] = 0x80;
+    mbedtls_des3_crypt_cbc(&mMasterKey, MBEDTLS_DES_ENCRYPT, sizeof(input), iv, input, output);
+    memcpy(password, output, 4);
+    memcpy(pack, &output[4], 2);
+    memset(output, 0, sizeof(output));
+}
+
 bool CardReader::isCardPresent() {
+    SpiBusScheduler::Guard guard(mBus, mSlot);
     return mMFRC.PICC_IsNewCardPresent();
 }
+
+// Collects the UIDs of all cards in the field, they are in state HALT afterwards.
+// A single card stays selected in mMFRC.uid instead and selected is set.
+bool CardReader::enumerateCards(MFRC522::Uid *uids, byte &count, bool &selected) {
+    SpiBusScheduler::Guard guard(mBus, mSlot);
+    count = CARD_READER_MAX_CARDS;
+    MFRC522::StatusCode status = mMFRC.PICC_Enumerate(uids, &count, &selected);
+    // More cards than CARD_READER_MAX_CARDS or a failed round after the first cards: go on with the ones we have
+    if (status != MFRC522::STATUS_OK && count == 0) {
+        recordAttempt(status);
+        return false;
+    }
+    recordAttempt(MFRC522::STATUS_OK);
+    return true;
+}
+
+bool CardReader::selectCard(const MFRC522::Uid &uid) {
+    SpiBusScheduler::Guard guard(mBus, mSlot);
+    mMFRC.uid = uid;
+    MFRC522::StatusCode status = mMFRC.PICC_SelectByUid(&mMFRC.uid);
+    recordAttempt(status);
+    return status == MFRC522::STATUS_OK;
+}
+
+// Feeds the tuner with the outcome of a card access, called with the bus held
+void CardReader::recordAttempt(MFRC522::StatusCode status) {
+    byte errorReg = status == MFRC522::STATUS_ERROR ? mMFRC.PCD_ReadRegister(MFRC522::ErrorReg) : 0;
+    if (!mTuner.record(status, errorReg)) return;
+    applyRfSettings();
+    const RfTuner::Settings &settings = mTuner.settings();
+    Serial.printf("📶 Reader %u RF settings: gain %u dB, ModWidth 0x%02X, timeout %u ms\n", mSlot,
+                  RfTuner::gainDb(settings.gain), settings.modWidth, settings.timeoutMs);
+}
+
+void CardReader::applyRfSettings() {
+    const RfTuner::Settings &settings = mTuner.settings();
+    mMFRC.PCD_SetAntennaGain(settings.gain);
+    mMFRC.PCD_SetModWidth(settings.modWidth);
+    mMFRC.PCD_SetTimeout(settings.timeoutMs);
+}
+
+// Default policy: prefer Ultralight type wallet cards, then ISO 14443-4 cards with a fixed UID (DESFire badges).
+// Bank cards are ISO 14443-4 as well but use a random UID, 4 bytes starting with 0x08.
+int CardReader::preferWalletCards(const Uid *uids, byte count) {
+    for (byte i = 0; i < count; i++) {
+        if (uids[i].sak == MFRC522::PICC_TYPE_MIFARE_UL) return i;
+    }
+    for (byte i = 0; i < count; i++) {
+        bool randomUid = uids[i].size == 4 && uids[i].uidByte[0] == 0x08;
+        if (uids[i].sak == MFRC522::PICC_TYPE_ISO_14443_4 && !randomUid) return i;
+    }
+    return count > 0 ? 0 : -1;
+}
+
+void CardReader::setSelectPolicy(SelectPolicy policy) {
+    mSelectPolicy = policy ? policy : preferWalletCards;
+}
+
+void CardReader::setPresenceProbe(uint32_t intervalMs, uint8_t debounce) {
+    mProbeIntervalMs = intervalMs > 0 ? intervalMs : 1;
+    mProbeDebounce = debounce > 0 ? debounce : 1;
+}
+
+void CardReader::trackCard() {
+    if (!mPresenceEvents) return;
+    xSemaphoreTake(mPresenceLock, portMAX_DELAY);
+    mTrackedUid = mMFRC.uid;
+    mMissedProbes = 0;
+    xEventGroupClearBits(mPresenceEvents, PRESENCE_REMOVED);
+    xEventGroupSetBits(mPresenceEvents, PRESENCE_TRACKING);
+    xSemaphoreGive(mPresenceLock);
+}
+
+void CardReader::stopTracking() {
+    if (!mPresenceEvents) return;
+    xSemaphoreTake(mPresenceLock, portMAX_DELAY); // A running probe finishes first, the reader is ours afterwards
+    xEventGroupClearBits(mPresenceEvents, PRESENCE_TRACKING);
+    xSemaphoreGive(mPresenceLock);
+}
+
+bool CardReader::waitForRemoval(TickType_t timeout) {
+    if (!mPresenceEvents) return true;
+    return xEventGroupWaitBits(mPresenceEvents, PRESENCE_REMOVED, pdFALSE, pdTRUE, timeout) & PRESENCE_REMOVED;
+}
+
+// One presence probe of the tracked card, leaves it in state HALT. No REQA: a halted card would not answer it and an
+// active one would only answer every second time.
+bool CardReader::probeCard() {
+    SpiBusScheduler::Guard guard(mBus, mSlot);
+    MFRC522::StatusCode status;
+    mMFRC.PCD_StopCrypto1();
+    if (mTrackedUid.size > 0) {
+        MFRC522::Uid uid = mTrackedUid;
+        status = mMFRC.PICC_SelectByUid(&uid); // Another card put on the reader does not answer the select
+    } else {
+        byte bufferATQA[2];
+        byte bufferSize = sizeof(bufferATQA);
+        mMFRC.PCD_WriteRegister(MFRC522::TxModeReg, 0x00);
+        mMFRC.PCD_WriteRegister(MFRC522::RxModeReg, 0x00);
+        status = mMFRC.PICC_WakeupA(bufferATQA, &bufferSize);
+        if (status == MFRC522::STATUS_TIMEOUT) { // Active PICCs return to IDLE on the first WUPA
+            bufferSize = sizeof(bufferATQA);
+            status = mMFRC.PICC_WakeupA(bufferATQA, &bufferSize);
+        }
+        if (status == MFRC522::STATUS_COLLISION) status = MFRC522::STATUS_OK;
+    }
+    mMFRC.PICC_HaltA();
+    return status == MFRC522::STATUS_OK;
+}
+
+// Monitor task of one reader, sleeps until trackCard() and probes the card until it is removed or stopTracking()
+void CardReader::presenceTask(void *pvParameters) {
+    CardReader &reader = *static_cast<CardReader *>(pvParameters);
+
+    for (;;) {
+        xEventGroupWaitBits(reader.mPresenceEvents, PRESENCE_TRACKING, pdFALSE, pdTRUE, portMAX_DELAY);
+        vTaskDelay(pdMS_TO_TICKS(reader.mProbeIntervalMs));
+
+        xSemaphoreTake(reader.mPresenceLock, portMAX_DELAY);
+        if (xEventGroupGetBits(reader.mPresenceEvents) & PRESENCE_TRACKING) {
+            if (reader.probeCard()) {
+                reader.mMissedProbes = 0;
+            } else if (++reader.mMissedProbes >= reader.mProbeDebounce) {
+                xEventGroupClearBits(reader.mPresenceEvents, PRESENCE_TRACKING);
+                xEventGroupSetBits(reader.mPresenceEvents, PRESENCE_REMOVED);
+            }
+        }
+        xSemaphoreGive(reader.mPresenceLock);
+    }
+}
+
+void IRAM_ATTR CardReader::onIrq(void *arg) {
+    CardReader *reader = static_cast<CardReader *>(arg);
+    if (reader->mBus) reader->mBus->notifyFromISR(reader->mSlot);
+}
+
 void CardReader::endCard() {
     Serial.println("🛑 Stopping communication with the card...");
+    SpiBusScheduler::Guard guard(mBus, mSlot);
     mMFRC.PICC_HaltA();        // ✅ Stop Communication with Card
     mMFRC.PCD_StopCrypto1();   // ✅ Prevent Interference
 }
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
-#include <MFRC522.h>
+#include <MFRC522Extended.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
 #include "result.h"
+#include "spi_bus.h"
+#include "desfire.h"
+#include "rf_tuner.h"
 
 #define RST_PIN 14 // Reset pin
 #define SS_PIN 10 // Slave Select pin
@@ -8,6 +13,42 @@
 #define MOSI_PIN 11 // Master Out Slave In pin
 #define MISO_PIN 13 // Master In Slave Out pin
 
+// Readers sharing the SPI bus, one chip select per reader. Each reader needs its own reset pin (or
+// MFRC522::UNUSED_PIN), a shared one would reset the other readers. The IRQ pins are optional and let
+// SPI_BUS_POLICY prefer readers with a card in the field.
+#ifndef CARD_READER_COUNT
+#define CARD_READER_COUNT 1
+#define CARD_READER_SS_PINS { SS_PIN }
+#define CARD_READER_RST_PINS { RST_PIN }
+#define CARD_READER_IRQ_PINS { MFRC522::UNUSED_PIN }
+#endif
+#ifndef SPI_BUS_POLICY
+#define SPI_BUS_POLICY SpiBusScheduler::Policy::IRQ_PRIORITY
+#endif
+
+#define CARD_SECRET_PAGE 0x20 // First page of the card secret
+#define CARD_READER_MAX_CARDS 4 // Max number of stacked cards told apart in one read
+
+// Presence tracking after a read: time between two probes of the card and missed probes in a row until it counts as removed
+#ifndef CARD_PRESENCE_INTERVAL_MS
+#define CARD_PRESENCE_INTERVAL_MS 100
+#endif
+#ifndef CARD_PRESENCE_DEBOUNCE
+#define CARD_PRESENCE_DEBOUNCE 3
+#endif
+
+// Health monitor, see CardReader::maintain()
+#define CARD_READER_HEALTH_INTERVAL_MS 2000       // VersionReg and register pattern check
+#define CARD_READER_SELF_TEST_INTERVAL_MS 600000  // Digital self test of the MFRC522, resets the chip
+#define CARD_READER_BACKOFF_MIN_MS 500            // Wait after a failed recovery, doubled up to the max
+#define CARD_READER_BACKOFF_MAX_MS 10000
+
+// DESFire badges: wallet application and its MACed 32 byte secret file, read with the wallet key
+#define DESFIRE_WALLET_AID 0x0CA5E1
+#define DESFIRE_WALLET_KEY_NO 1
+#define DESFIRE_WALLET_FILE_NO 0
+#define DESFIRE_MAX_BITRATE MFRC522Extended::BITRATE_424KBITS // 848 kbps is not reliable with the MFRC522
+
 #ifndef DEBUG_PRINT
     #define DEBUG_PRINT(x) do { if(Serial) Serial.println(x); } while(0)
     #define ERROR_PRINT(x) do { if(Serial) Serial.println(x); } while(0)
@@ -26,21 +67,88 @@ public:
         byte sak;
     };
 
-    CardReader();
+    struct Health {
+        bool healthy;
+        uint32_t checks;
+        uint32_t failures;         // Failed checks
+        uint32_t selfTests;
+        uint32_t selfTestFailures;
+        uint32_t resets;           // Recovery attempts, hard reset and initialization
+        uint32_t recoveries;       // Recovery attempts that brought the reader back
+    };
+
+    // Picks the card to use out of all cards in the field. Returns its index, -1 to use none.
+    typedef int (*SelectPolicy)(const Uid *uids, byte count);
+
+    CardReader(byte ssPin = SS_PIN, byte rstPin = RST_PIN, byte irqPin = MFRC522::UNUSED_PIN,
+               SpiBusScheduler *bus = nullptr, uint8_t slot = 0);
     Result begin(); // Initialize the reader
-    Result read(Uid &iUid, bool &isUltralightC, CardSecret &iSecret);
+    // Health monitor, to be called while no card is handled. Checks the reader every CARD_READER_HEALTH_INTERVAL_MS
+    // and runs the self test every CARD_READER_SELF_TEST_INTERVAL_MS. A reader failing a check is reset through its
+    // RST pin and initialized again, with exponential backoff while that fails. Returns true if the reader is usable.
+    bool maintain();
+    const Health &health() const { return mHealth; }
+    Result read(Uid &iUid, bool &isAuthenticated, CardSecret &iSecret);
     bool isCardPresent();  // ✅ New method to check for card presence
     void endCard();
+    uint8_t slot() const { return mSlot; }
+    void setSelectPolicy(SelectPolicy policy); // nullptr restores preferWalletCards
+    static int preferWalletCards(const Uid *uids, byte count);
+
+    // Presence tracking of the card of the last read(). A monitor task probes it every intervalMs with WUPA and a
+    // select of its UID followed by HLTA, so halted and ISO 14443-4 cards are found as well, and raises the removed
+    // event after debounce missed probes in a row. read() must not be called while a card is tracked.
+    void setPresenceProbe(uint32_t intervalMs, uint8_t debounce);
+    void trackCard();
+    void stopTracking();
+    bool waitForRemoval(TickType_t timeout); // True once the tracked card is gone
+
+    // Outcomes of the card accesses and the RF settings the tuner derived from them
+    const RfTuner::Stats &rfStats() const { return mTuner.stats(); }
+    const RfTuner::Settings &rfSettings() const { return mTuner.settings(); }
 
 
 private:
+    Result initPcd();
+    Result checkHealth(bool selfTest);
     Result getUid(Uid &iUid, bool &isUltralightC);
-    Result authenticateUltralightC();
-    Result readCardSecret(CardSecret &iSecret);
+    bool enumerateCards(MFRC522::Uid *uids, byte &count, bool &selected);
+    bool selectCard(const MFRC522::Uid &uid);
+    bool isNtag();
+    Result authenticateUltralightC(const Uid &iUid);
+    Result authenticateNtag(const Uid &iUid);
+    Result readCardSecret(CardSecret &iSecret, bool fastRead);
+    Result readDesfireSecret(const Uid &iUid, CardSecret &iSecret);
+    void deriveCardKey(const Uid &iUid, byte key[16]);
+    void deriveNtagPassword(const Uid &iUid, byte password[4], byte pack[2]);
+    bool probeCard();
+    void recordAttempt(MFRC522::StatusCode status);
+    void applyRfSettings();
+    static void onIrq(void *arg);
+    static void presenceTask(void *pvParameters);
     //void endCard();
 
 private:
-    MFRC522 mMFRC;
+    MFRC522Extended mMFRC;
+    byte mSsPin;
+    byte mRstPin;
+    byte mIrqPin;
+    SpiBusScheduler *mBus; // Shared with the other readers on the bus, may be null
+    uint8_t mSlot;         // Index of this reader on the bus
+    SelectPolicy mSelectPolicy;
     bool mInitialized;
-    byte mSecretKey[4] = { 0xFF, 0xFF, 0xFF, 0xFF }; // Default password
+    byte mVersion;             // VersionReg read by the first begin(), kept across recoveries
+    Health mHealth;
+    uint32_t mNextHealthCheck; // millis()
+    uint32_t mLastSelfTest;    // millis()
+    uint32_t mBackoffMs;
+    bool mSelfTestPassed;      // Clones of the MFRC522 fail the self test, it only counts after it passed once
+    RfTuner mTuner;
+    mbedtls_des3_context mMasterKey; // Key schedule of CARD_MASTER_KEY, used to diversify the per-card keys
+    EventGroupHandle_t mPresenceEvents;
+    SemaphoreHandle_t mPresenceLock; // Held by the monitor task while probing, stopTracking() waits for it
+    MFRC522::Uid mTrackedUid;        // Size 0 if the last read() did not get to a select, any PICC counts then
+    uint32_t mProbeIntervalMs;
+    uint8_t mProbeDebounce;
+    uint8_t mMissedProbes;
 };
\ No newline at end of file
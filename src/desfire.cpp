@@ -0,0 +1,287 @@
+#include "desfire.h"
+#include <esp_system.h>
+#include <mbedtls/platform_util.h>
+
+// Native DESFire commands and status codes
+#define DESFIRE_CMD_SELECT_APPLICATION 0x5A
+#define DESFIRE_CMD_AUTHENTICATE_AES 0xAA
+#define DESFIRE_CMD_READ_DATA 0xBD
+#define DESFIRE_ADDITIONAL_FRAME 0xAF
+#define DESFIRE_OPERATION_OK 0x00
+
+#define DESFIRE_MAC_SIZE 8 // EV1 AES sessions transmit the first 8 bytes of the CMAC
+
+Desfire::Desfire(MFRC522Extended &mfrc)
+    : mMFRC(mfrc), mBitRate(MFRC522Extended::BITRATE_106KBITS), mAuthenticated(false) {
+    memset(&mTag, 0, sizeof(mTag));
+    memset(mIv, 0, sizeof(mIv));
+    mbedtls_aes_init(&mSessionKey);
+}
+
+Desfire::~Desfire() {
+    mbedtls_aes_free(&mSessionKey);
+    mbedtls_platform_zeroize(mIv, sizeof(mIv));
+}
+
+Result Desfire::activate(MFRC522Extended::TagBitRates maxBitRate) {
+    mTag.uid = mMFRC.uid;
+    mTag.blockNumber = false;
+    mAuthenticated = false;
+    mBitRate = MFRC522Extended::BITRATE_106KBITS;
+
+    if (mMFRC.PICC_RequestATS(&mTag.ats) != MFRC522::STATUS_OK || mTag.ats.size == 0) {
+        return Result::ERROR;
+    }
+    // Start-up frame guard time, about 302 us * 2^SFGI
+    if (mTag.ats.tb1.transmitted && mTag.ats.tb1.sfgi > 0 && mTag.ats.tb1.sfgi < 15) {
+        delayMicroseconds(302UL << mTag.ats.tb1.sfgi);
+    }
+
+    // TA1 holds the supported divisors as bit masks, bit 0 for 212 kbps. Use the same D in both directions.
+    byte common = mTag.ats.ta1.transmitted ? (mTag.ats.ta1.ds & mTag.ats.ta1.dr) : 0;
+    MFRC522Extended::TagBitRates rate = MFRC522Extended::BITRATE_106KBITS;
+    for (byte r = maxBitRate; r > MFRC522Extended::BITRATE_106KBITS; r--) {
+        if (common & (1 << (r - 1))) {
+            rate = (MFRC522Extended::TagBitRates)r;
+            break;
+        }
+    }
+
+    if (rate == MFRC522Extended::BITRATE_106KBITS) {
+        // No PPS needed, only let the MFRC522 handle the CRC_A of the I-blocks
+        mMFRC.PCD_SetRegisterBitMask(MFRC522::TxModeReg, 0x80);
+        mMFRC.PCD_SetRegisterBitMask(MFRC522::RxModeReg, 0x80);
+    } else if (mMFRC.PICC_PPS(rate, rate) != MFRC522::STATUS_OK) {
+        return Result::ERROR;
+    }
+    mBitRate = rate;
+    return Result::OK;
+}
+
+Result Desfire::selectApplication(uint32_t aid) {
+    byte command[4] = { DESFIRE_CMD_SELECT_APPLICATION, (byte)aid, (byte)(aid >> 8), (byte)(aid >> 16) };
+    byte status;
+    byte data[4];
+    byte dataLength = sizeof(data);
+
+    mAuthenticated = false;
+    if (exchange(command, sizeof(command), status, data, dataLength) != Result::OK || status != DESFIRE_OPERATION_OK) {
+        return Result::ERROR;
+    }
+    return Result::OK;
+}
+
+// EV1 AuthenticateAES: both sides prove the key with encrypted random numbers rotated by one byte.
+// The CBC IV is carried over from one message to the next.
+Result Desfire::authenticateAes(byte keyNo, const byte key[16]) {
+    mbedtls_aes_context aes;
+    byte iv[16] = { 0 };
+    byte rndA[16];
+    byte rndB[16];
+    byte frame[1 + 32];
+    byte response[32];
+    byte responseLength = sizeof(response);
+    byte status;
+    Result result = Result::ERROR;
+
+    mAuthenticated = false;
+    mbedtls_aes_init(&aes);
+
+    frame[0] = DESFIRE_CMD_AUTHENTICATE_AES;
+    frame[1] = keyNo;
+    if (exchange(frame, 2, status, response, responseLength) != Result::OK ||
+        status != DESFIRE_ADDITIONAL_FRAME || responseLength != 16) {
+        goto cleanup;
+    }
+    // ek(RndB), IV 0
+    mbedtls_aes_setkey_dec(&aes, key, 128);
+    mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_DECRYPT, 16, iv, response, rndB);
+
+    // ek(RndA || RndB'), RndB' is RndB rotated left by one byte
+    esp_fill_random(rndA, sizeof(rndA));
+    frame[0] = DESFIRE_ADDITIONAL_FRAME;
+    memcpy(&frame[1], rndA, 16);
+    memcpy(&frame[17], &rndB[1], 15);
+    frame[32] = rndB[0];
+    mbedtls_aes_setkey_enc(&aes, key, 128);
+    mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, 32, iv, &frame[1], &frame[1]);
+
+    responseLength = sizeof(response);
+    if (exchange(frame, sizeof(frame), status, response, responseLength) != Result::OK ||
+        status != DESFIRE_OPERATION_OK || responseLength != 16) {
+        goto cleanup;
+    }
+    // ek(RndA'), the PICC proves the key
+    mbedtls_aes_setkey_dec(&aes, key, 128);
+    mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_DECRYPT, 16, iv, response, response);
+    if (memcmp(response, &rndA[1], 15) != 0 || response[15] != rndA[0]) {
+        goto cleanup;
+    }
+
+    // Session key RndA[0..3] || RndB[0..3] || RndA[12..15] || RndB[12..15]
+    memcpy(&frame[0], &rndA[0], 4);
+    memcpy(&frame[4], &rndB[0], 4);
+    memcpy(&frame[8], &rndA[12], 4);
+    memcpy(&frame[12], &rndB[12], 4);
+    mbedtls_aes_setkey_enc(&mSessionKey, frame, 128);
+    memset(mIv, 0, sizeof(mIv));
+    mAuthenticated = true;
+    result = Result::OK;
+
+cleanup:
+    mbedtls_aes_free(&aes);
+    mbedtls_platform_zeroize(rndA, sizeof(rndA));
+    mbedtls_platform_zeroize(rndB, sizeof(rndB));
+    mbedtls_platform_zeroize(frame, sizeof(frame));
+    return result;
+}
+
+Result Desfire::readData(byte fileNo, uint32_t offset, byte *data, byte length, CommMode mode) {
+    if (length == 0 || length > DESFIRE_MAX_READ || (mode == CommMode::MACED && !mAuthenticated)) {
+        return Result::ERROR;
+    }
+
+    byte command[8] = { DESFIRE_CMD_READ_DATA, fileNo, (byte)offset, (byte)(offset >> 8), (byte)(offset >> 16),
+                        length, 0, 0 };
+    byte mac[16];
+    if (mAuthenticated) {
+        cmac(command, sizeof(command), mac); // Every command advances the CMAC chaining, also without MAC on air
+    }
+
+    // Data, MAC and room for the status byte the response CMAC is calculated over
+    byte response[DESFIRE_MAX_READ + DESFIRE_MAC_SIZE + 1];
+    byte expected = length + (mode == CommMode::MACED ? DESFIRE_MAC_SIZE : 0);
+    byte received = 0;
+    byte status;
+    const byte additionalFrame = DESFIRE_ADDITIONAL_FRAME;
+    const byte *send = command;
+    byte sendLength = sizeof(command);
+    do {
+        byte frameLength = sizeof(response) - 1 - received;
+        if (exchange(send, sendLength, status, &response[received], frameLength) != Result::OK) {
+            mAuthenticated = false;
+            return Result::ERROR;
+        }
+        received += frameLength;
+        send = &additionalFrame;
+        sendLength = 1;
+    } while (status == DESFIRE_ADDITIONAL_FRAME);
+
+    if (status != DESFIRE_OPERATION_OK || received != expected) {
+        mAuthenticated = false; // Errors end the authentication on the PICC
+        return Result::ERROR;
+    }
+
+    if (mAuthenticated) {
+        byte receivedMac[DESFIRE_MAC_SIZE];
+        memcpy(receivedMac, &response[length], sizeof(receivedMac));
+        response[length] = status;
+        cmac(response, length + 1, mac);
+        if (mode == CommMode::MACED && memcmp(mac, receivedMac, DESFIRE_MAC_SIZE) != 0) {
+            mAuthenticated = false;
+            return Result::ERROR;
+        }
+    }
+
+    memcpy(data, response, length);
+    return Result::OK;
+}
+
+void Desfire::deselect() {
+    mMFRC.TCL_Deselect(&mTag);
+    mAuthenticated = false;
+}
+
+// AN10922: CMAC over 0x01 || input padded to 32 bytes
+void Desfire::diversifyKey(const byte masterKey[16], const byte *input, byte inputLength, byte key[16]) {
+    mbedtls_aes_context aes;
+    byte message[32];
+    byte iv[16] = { 0 };
+
+    if (inputLength > sizeof(message) - 1) {
+        inputLength = sizeof(message) - 1;
+    }
+    message[0] = 0x01;
+    memcpy(&message[1], input, inputLength);
+
+    mbedtls_aes_init(&aes);
+    mbedtls_aes_setkey_enc(&aes, masterKey, 128);
+    cmacFinish(&aes, iv, message, 1 + inputLength, sizeof(message));
+    memcpy(key, iv, 16);
+    mbedtls_aes_free(&aes);
+    mbedtls_platform_zeroize(message, sizeof(message));
+    mbedtls_platform_zeroize(iv, sizeof(iv));
+}
+
+Result Desfire::exchange(const byte *send, byte sendLength, byte &status, byte *data, byte &dataLength) {
+    byte out[MFRC522::FIFO_SIZE];
+    byte back[MFRC522::FIFO_SIZE];
+    byte backLength = sizeof(back);
+
+    if (sendLength > sizeof(out)) {
+        return Result::ERROR;
+    }
+    memcpy(out, send, sendLength);
+    if (mMFRC.TCL_Transceive(&mTag, out, sendLength, back, &backLength) != MFRC522::STATUS_OK || backLength < 1) {
+        return Result::ERROR;
+    }
+    if (backLength - 1 > dataLength) {
+        return Result::ERROR;
+    }
+    status = back[0];
+    dataLength = backLength - 1;
+    memcpy(data, &back[1], dataLength);
+    return Result::OK;
+}
+
+// CMAC with the session key, chained through mIv
+void Desfire::cmac(const byte *data, byte length, byte mac[16]) {
+    size_t paddedLength = length == 0 ? 16 : (length + 15) / 16 * 16;
+    cmacFinish(&mSessionKey, mIv, data, length, paddedLength);
+    memcpy(mac, mIv, 16);
+}
+
+// Subkeys of NIST SP 800-38B: K1 = L << 1, K2 = K1 << 1 with L = ek(0), reduced by 0x87
+void Desfire::cmacSubkeys(mbedtls_aes_context *aes, byte k1[16], byte k2[16]) {
+    byte zero[16] = { 0 };
+    byte *keys[2] = { k1, k2 };
+    byte l[16];
+
+    mbedtls_aes_crypt_ecb(aes, MBEDTLS_AES_ENCRYPT, zero, l);
+    const byte *in = l;
+    for (byte k = 0; k < 2; k++) {
+        byte *out = keys[k];
+        for (byte i = 0; i < 15; i++) {
+            out[i] = (in[i] << 1) | (in[i + 1] >> 7);
+        }
+        out[15] = (in[15] << 1) ^ ((in[0] & 0x80) ? 0x87 : 0x00);
+        in = out;
+    }
+    mbedtls_platform_zeroize(l, sizeof(l));
+}
+
+// CBC-MAC of data padded with 0x80 00.. to paddedLength, the last block XORed with K1 if there is no padding and
+// with K2 otherwise. iv is the chaining value in and the MAC out.
+void Desfire::cmacFinish(mbedtls_aes_context *aes, byte iv[16], const byte *data, size_t length, size_t paddedLength) {
+    byte k1[16];
+    byte k2[16];
+    byte block[16];
+    const byte *subkey;
+
+    cmacSubkeys(aes, k1, k2);
+    subkey = (length == paddedLength) ? k1 : k2;
+    for (size_t offset = 0; offset < paddedLength; offset += 16) {
+        bool last = offset + 16 == paddedLength;
+        for (byte i = 0; i < 16; i++) {
+            size_t pos = offset + i;
+            byte value = pos < length ? data[pos] : (pos == length ? 0x80 : 0x00);
+            if (last) {
+                value ^= subkey[i];
+            }
+            block[i] = value ^ iv[i];
+        }
+        mbedtls_aes_crypt_ecb(aes, MBEDTLS_AES_ENCRYPT, block, iv);
+    }
+    mbedtls_platform_zeroize(k1, sizeof(k1));
+    mbedtls_platform_zeroize(k2, sizeof(k2));
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <MFRC522Extended.h>
+#include <mbedtls/aes.h>
+#include "result.h"
+
+#define DESFIRE_MAX_READ 120 // Max bytes per readData(), the response is collected in a stack buffer
+
+// MIFARE DESFire EV1/EV2/EV3 on top of the ISO/IEC 14443-4 layer of MFRC522Extended.
+//
+// Native commands are sent in ISO 14443-4 I-blocks. The AES authentication is the EV1 AuthenticateAES (0xAA).
+// EV2 and EV3 support it for applications that are not configured for EV2 secure messaging. After authentication
+// readData() checks the CMAC of MACed files and keeps the CMAC chaining of the session.
+class Desfire {
+public:
+    enum class CommMode : uint8_t {
+        PLAIN,
+        MACED,
+    };
+
+    explicit Desfire(MFRC522Extended &mfrc);
+    ~Desfire();
+
+    // RATS and PPS. The PICC must be selected, the bit rate is the highest one of both sides up to maxBitRate.
+    Result activate(MFRC522Extended::TagBitRates maxBitRate);
+    MFRC522Extended::TagBitRates bitRate() const { return mBitRate; }
+    Result selectApplication(uint32_t aid);
+    Result authenticateAes(byte keyNo, const byte key[16]);
+    Result readData(byte fileNo, uint32_t offset, byte *data, byte length, CommMode mode);
+    void deselect();
+
+    // AES-128 key diversification of NXP AN10922, e.g. with the UID and the AID as input
+    static void diversifyKey(const byte masterKey[16], const byte *input, byte inputLength, byte key[16]);
+
+private:
+    Result exchange(const byte *send, byte sendLength, byte &status, byte *data, byte &dataLength);
+    void cmac(const byte *data, byte length, byte mac[16]);
+    static void cmacSubkeys(mbedtls_aes_context *aes, byte k1[16], byte k2[16]);
+    static void cmacFinish(mbedtls_aes_context *aes, byte iv[16], const byte *data, size_t length, size_t paddedLength);
+
+private:
+    MFRC522Extended &mMFRC;
+    MFRC522Extended::TagInfo mTag;
+    MFRC522Extended::TagBitRates mBitRate;
+    bool mAuthenticated;
+    mbedtls_aes_context mSessionKey; // Encryption key schedule of the session key
+    byte mIv[16];                    // CMAC chaining value of the session
+};
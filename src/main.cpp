@@ -9,9 +9,6 @@
 #include <Syslog.h>
 #include <OTA.h>
 
-// Define max log level before including FastSyslog.h to filter logs at compile time
-#define FAST_SYSLOG_MAX_LEVEL FAST_SYSLOG_ERR      // Only errors and higher priority
-
 #include "FastSyslog.h"
 #define ESP32_RTOS
 #include "secrets.h"
@@ -22,6 +19,8 @@
 #include "api_client.h"
 #include "reader_handler.h"
 #include "cardreader.h"
+#include "uid_cache.h"
+#include "blocklist.h"
 
 // Configuration constants
 const char* api_key = API_KEY;
@@ -34,9 +33,14 @@ String resolved_api_base_url = "";
 // Global objects
 WiFiUDP udpClient;
 Syslog syslog(udpClient, SYSLOG_PROTO_IETF);
-CardReader cardReader;
+SpiBusScheduler spiBus(SPI_BUS_POLICY);
+CardReader *cardReaders[CARD_READER_COUNT];
+#if FAST_SYSLOG_SERIAL_SINK
+FastLogSerialSink serialSink(Serial, MACHINE_ID); // Binary log frames for scripts/serial_log_decode.py
+#endif
 
 QueueHandle_t cashSaleQueue;
+SemaphoreHandle_t readerSessionMutex; // Only one reader at a time runs a vend session
 
 void setup() {
   // Pin modes
@@ -44,8 +48,24 @@ void setup() {
 
   cashSaleQueue = xQueueCreate(10, sizeof(CashSale_t));
 
+#if FAST_SYSLOG_SERIAL_SINK
+  // Frames are only written if they fit the TX buffer, the default one of the UART is too small
+  Serial.setTxBufferSize(FAST_SYSLOG_SERIAL_TX_BUFFER);
+#endif
   Serial.begin(115200);
 
+  // Module log levels set by the backend, FAST_SYSLOG_DEFAULT_LEVEL until the first sync
+  fastSyslog.loadLevels();
+#if FAST_SYSLOG_SERIAL_SINK
+  fastSyslog.addSink(&serialSink);
+#endif
+
+  // Started before WiFi, the backlog keeps the records until the UDP sink can send them. Without it the device still
+  // vends, connectToWiFi() tries again.
+  if (!fastSyslog.begin(SYSLOG_SERVER, SYSLOG_PORT, MACHINE_ID, MACHINE_ID)) {
+    Serial.println("Failed to initialize FastSyslog!");
+  }
+
   xTaskCreatePinnedToCore(
     mdb_loop,     // Task function
     "mdb_loop",   // Task name
@@ -56,20 +76,34 @@ void setup() {
     1
   );
 
-  Result initResult = cardReader.begin();
-  if (initResult == Result::OK) {
-    Serial.println("Card Reader initialized successfully.");
-  } else {
-    Serial.println("Card Reader initialization failed.");
-  }
+  readerSessionMutex = xSemaphoreCreateMutex();
 
-  connectToWiFi();
+  if (!cardStoreBegin()) {
+    Serial.println("No card store partition, UID cache and blocklist are kept in RAM only");
+  }
+  if (!uidCache.begin()) {
+    Serial.println("Failed to load the UID cache!");
+  }
+  if (!blocklist.begin()) {
+    Serial.println("Failed to load the blocklist!");
+  }
 
-  if (!fastSyslog.begin(SYSLOG_SERVER, SYSLOG_PORT, MACHINE_ID, MACHINE_ID)) {
-    Serial.println("Failed to initialize FastSyslog!");
-    return;
+  const byte readerSsPins[CARD_READER_COUNT] = CARD_READER_SS_PINS;
+  const byte readerRstPins[CARD_READER_COUNT] = CARD_READER_RST_PINS;
+  const byte readerIrqPins[CARD_READER_COUNT] = CARD_READER_IRQ_PINS;
+  spiBus.begin(CARD_READER_COUNT);
+  for (uint8_t i = 0; i < CARD_READER_COUNT; i++) {
+    cardReaders[i] = new CardReader(readerSsPins[i], readerRstPins[i], readerIrqPins[i], &spiBus, i);
+    Result initResult = cardReaders[i]->begin();
+    if (initResult == Result::OK) {
+      Serial.printf("Card Reader %u initialized successfully.\n", i);
+    } else {
+      Serial.printf("Card Reader %u initialization failed.\n", i);
+    }
   }
 
+  connectToWiFi();
+
   Serial.println("starting up");
   FAST_LOG_INFO("starting up");
 
@@ -87,15 +121,20 @@ void setup() {
     0
   );
 
-  xTaskCreatePinnedToCore(
-    reader_loop,  // Task function
-    "reader_loop",// Task name
-    8192,         // Stack size
-    NULL,         // Parameters
-    2,            // Priority (raised from 1 for faster scheduling)
-    NULL,         // Task handle
-    0
-  );
+  // One task per reader, same priority so they share the core, spiBus shares the SPI bus fairly
+  for (uint8_t i = 0; i < CARD_READER_COUNT; i++) {
+    char taskName[16];
+    snprintf(taskName, sizeof(taskName), "reader_loop%u", i);
+    xTaskCreatePinnedToCore(
+      reader_loop,    // Task function
+      taskName,       // Task name
+      8192,           // Stack size
+      cardReaders[i], // Parameters
+      2,              // Priority (raised from 1 for faster scheduling)
+      NULL,           // Task handle
+      0
+    );
+  }
 
   xTaskCreatePinnedToCore(
     cashsale_handler,
@@ -107,6 +146,17 @@ void setup() {
     0
   );
 
+  // Keeps the UID cache, the blocklist and the log levels in sync with the backend
+  xTaskCreatePinnedToCore(
+    uid_cache_sync_loop,
+    "uid_cache_sync",
+    8192,           // Stack size (HTTP request and JSON parsing of a page of changes)
+    NULL,
+    1,
+    NULL,
+    0
+  );
+
   // Create OTA Update Task
   xTaskCreatePinnedToCore(
     ota_task,       // Task function
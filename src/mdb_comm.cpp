@@ -1,3 +1,5 @@
+#define FAST_SYSLOG_MODULE FAST_LOG_MODULE_MDB
+
 #include "mdb_comm.h"
 #include "FastSyslog.h"
 #include <queue.h>
@@ -120,7 +122,7 @@ void mdb_cashless_loop(void *pvParameters) {
       // Even single-byte commands (RESET, POLL) send a checksum (which equals the command)
       // Packet format: [command] [subcommand?] [data...?] [checksum]
       if (available_rx < 2) {
-        fastSyslog.logf(LOG_ERR, "MDB: Incomplete packet len=%d cmd=0x%02X", available_rx, mdb_payload_rx[0]);
+        FAST_LOGD(LOG_ERR, "MDB: Incomplete packet len=%d cmd=0x%02X", available_rx, mdb_payload_rx[0]);
         continue;
       }
 
@@ -130,8 +132,8 @@ void mdb_cashless_loop(void *pvParameters) {
       }
 
       if (chk != mdb_payload_rx[available_rx - 1]) {
-        fastSyslog.logf(LOG_ERR, "MDB: CHK invalid calc=0x%02X recv=0x%02X len=%d cmd=0x%02X",
-                        chk, mdb_payload_rx[available_rx - 1], available_rx, mdb_payload_rx[0]);
+        FAST_LOGD(LOG_ERR, "MDB: CHK invalid calc=0x%02X recv=0x%02X len=%d cmd=0x%02X",
+                  chk, mdb_payload_rx[available_rx - 1], available_rx, mdb_payload_rx[0]);
         continue;
       }
 
@@ -146,7 +148,7 @@ void mdb_cashless_loop(void *pvParameters) {
 
         switch (command) {
           case RESET:
-            fastSyslog.logf(LOG_INFO, "MDB: Gateway RESET");
+            FAST_LOGD(LOG_INFO, "MDB: Gateway RESET");
             // Reset gateway state if needed
             break;
 
@@ -156,8 +158,8 @@ void mdb_cashless_loop(void *pvParameters) {
             uint8_t vmcScaleFactor = mdb_payload_rx[3];      // Y2
             uint8_t vmcDecimalPlaces = mdb_payload_rx[4];    // Y3
 
-            fastSyslog.logf(LOG_INFO, "MDB: Gateway SETUP feat=%d scale=%d dec=%d",
-                           vmcFeatureLevel, vmcScaleFactor, vmcDecimalPlaces);
+            FAST_LOGD(LOG_INFO, "MDB: Gateway SETUP feat=%d scale=%d dec=%d",
+                     vmcFeatureLevel, vmcScaleFactor, vmcDecimalPlaces);
 
             // Respond with Gateway Configuration
             mdb_payload_tx[0] = 0x01;   // Z1: COMMS GATEWAY CONFIGURATION
@@ -170,13 +172,13 @@ void mdb_cashless_loop(void *pvParameters) {
 
           case POLL:
             // Gateway POLL - respond with ACK (no data) or status if needed
-            fastSyslog.logf(LOG_DEBUG, "MDB: Gateway POLL");
+            FAST_LOGD(LOG_DEBUG, "MDB: Gateway POLL");
             break;
 
           case EXPANSION: {
             // Check for REQUEST_ID subcommand (0x00)
             if (mdb_payload_rx[1] == 0x00) {
-              fastSyslog.logf(LOG_INFO, "MDB: Gateway EXPANSION REQUEST_ID");
+              FAST_LOGD(LOG_INFO, "MDB: Gateway EXPANSION REQUEST_ID");
 
               // Respond with Peripheral ID
               mdb_payload_tx[0] = 0x06;   // Z1: PERIPHERAL ID
@@ -205,7 +207,7 @@ void mdb_cashless_loop(void *pvParameters) {
 
               available_tx = 34;
             } else {
-              fastSyslog.logf(LOG_INFO, "MDB: Gateway EXPANSION unknown subcmd=0x%02X", mdb_payload_rx[1]);
+              FAST_LOGD(LOG_INFO, "MDB: Gateway EXPANSION unknown subcmd=0x%02X", mdb_payload_rx[1]);
             }
             break;
           }
@@ -217,14 +219,14 @@ void mdb_cashless_loop(void *pvParameters) {
 
             uint8_t report_len = available_rx - 2;  // Exclude command and checksum
 
-            fastSyslog.logf(LOG_INFO, "MDB: Gateway REPORT len=%d", report_len);
+            FAST_LOGD(LOG_INFO, "MDB: Gateway REPORT len=%d", report_len);
 
             // Log report data for debugging (first few bytes)
             if (report_len > 0) {
-              fastSyslog.logf(LOG_DEBUG, "MDB: REPORT data: %02X %02X %02X...",
-                             mdb_payload_rx[1],
-                             report_len > 1 ? mdb_payload_rx[2] : 0,
-                             report_len > 2 ? mdb_payload_rx[3] : 0);
+              FAST_LOGD(LOG_DEBUG, "MDB: REPORT data: %02X %02X %02X...",
+                       mdb_payload_rx[1],
+                       report_len > 1 ? mdb_payload_rx[2] : 0,
+                       report_len > 2 ? mdb_payload_rx[3] : 0);
             }
 
             // Process report data here if needed
@@ -234,7 +236,7 @@ void mdb_cashless_loop(void *pvParameters) {
           }
 
           default:
-            fastSyslog.logf(LOG_INFO, "MDB: Gateway unknown cmd=0x%02X", command);
+            FAST_LOGD(LOG_INFO, "MDB: Gateway unknown cmd=0x%02X", command);
             break;
         }
 
@@ -254,7 +256,7 @@ void mdb_cashless_loop(void *pvParameters) {
         cashless_reset_todo = true;
         machine_state = INACTIVE_STATE;
 
-        fastSyslog.logf(LOG_INFO, "MDB: RESET");
+        FAST_LOGD(LOG_INFO, "MDB: RESET");
         break;
       }
 
@@ -279,14 +281,14 @@ void mdb_cashless_loop(void *pvParameters) {
           mdb_payload_tx[7] = 0b00001001;  // Miscellaneous Options
           available_tx = 8;
 
-          fastSyslog.logf(LOG_INFO, "MDB: CONFIG_DATA");
+          FAST_LOGD(LOG_INFO, "MDB: CONFIG_DATA");
           break;
         }
         case MAX_MIN_PRICES: {
           uint16_t maxPrice = (mdb_payload_rx[2] << 8) | mdb_payload_rx[3];
           uint16_t minPrice = (mdb_payload_rx[4] << 8) | mdb_payload_rx[5];
 
-          fastSyslog.logf(LOG_INFO, "MDB: MAX_MIN_PRICES");
+          FAST_LOGD(LOG_INFO, "MDB: MAX_MIN_PRICES");
           break;
         }
         }
@@ -375,13 +377,13 @@ void mdb_cashless_loop(void *pvParameters) {
             }
           }
 
-          fastSyslog.logf(LOG_INFO, "MDB: VEND_REQUEST price=%d num=%d", itemPrice, itemNumber);
+          FAST_LOG_EVENT(vend_request, itemPrice, itemNumber);
           break;
         }
         case VEND_CANCEL: {
           vend_denied_todo = true;
 
-          fastSyslog.logf(LOG_INFO, "MDB: VEND_CANCEL");
+          FAST_LOG_EVENT(vend_cancel);
           break;
         }
         case VEND_SUCCESS: {
@@ -390,20 +392,20 @@ void mdb_cashless_loop(void *pvParameters) {
           itemNumber = (mdb_payload_rx[2] << 8) | mdb_payload_rx[3];
           vend_success = true;
 
-          fastSyslog.logf(LOG_INFO, "MDB: VEND_SUCCESS");
+          FAST_LOG_EVENT(vend_success, itemNumber);
           break;
         }
         case VEND_FAILURE: {
           machine_state = IDLE_STATE;
           vend_success = false;
 
-          fastSyslog.logf(LOG_INFO, "MDB: VEND_FAILURE");
+          FAST_LOG_EVENT(vend_failure);
           break;
         }
         case SESSION_COMPLETE: {
           session_end_todo = true;
 
-          fastSyslog.logf(LOG_INFO, "MDB: SESSION_COMPLETE");
+          FAST_LOG_EVENT(session_complete);
           break;
         }
         case CASH_SALE: {
@@ -415,7 +417,7 @@ void mdb_cashless_loop(void *pvParameters) {
           cashsale_data.itemPrice = itemPrice;
           xQueueSend(cashSaleQueue, &cashsale_data, 0);
 
-          fastSyslog.logf(LOG_INFO, "MDB: CASH_SALE");
+          FAST_LOG_EVENT(cash_sale, itemPrice, itemNumber);
           break;
         }
         }
@@ -428,20 +430,20 @@ void mdb_cashless_loop(void *pvParameters) {
         case READER_DISABLE: {
           machine_state = DISABLED_STATE;
 
-          fastSyslog.logf(LOG_INFO, "MDB: READER_DISABLE");
+          FAST_LOGD(LOG_INFO, "MDB: READER_DISABLE");
           break;
         }
         case READER_ENABLE: {
           machine_state = ENABLED_STATE;
 
-          fastSyslog.logf(LOG_INFO, "MDB: READER_ENABLE");
+          FAST_LOGD(LOG_INFO, "MDB: READER_ENABLE");
           break;
         }
         case READER_CANCEL: {
           mdb_payload_tx[0] = 0x08; // Canceled
           available_tx = 1;
 
-          fastSyslog.logf(LOG_INFO, "MDB: READER_CANCEL");
+          FAST_LOGD(LOG_INFO, "MDB: READER_CANCEL");
           break;
         }
         }
@@ -461,7 +463,7 @@ void mdb_cashless_loop(void *pvParameters) {
 
           available_tx = 30;
 
-          fastSyslog.logf(LOG_INFO, "MDB: REQUEST_ID");
+          FAST_LOGD(LOG_INFO, "MDB: REQUEST_ID");
           break;
         }
         }
@@ -1,24 +1,52 @@
+#define FAST_SYSLOG_MODULE FAST_LOG_MODULE_READER
+
 #include "reader_handler.h"
 #include "mdb_comm.h"
 #include "api_client.h"
 #include "FastSyslog.h"
 #include "secrets.h"
+#include "card_admission.h"
 
-extern CardReader cardReader;
+extern SemaphoreHandle_t readerSessionMutex;
 
-// Format the UID bytes into a hex string
+// Format the UID bytes into a hex string, nibbles are looked up instead of a snprintf per byte
 void formatUidString(const CardReader::Uid& uid, char* uidString, size_t maxLen) {
-  snprintf(uidString, maxLen, "");
-  for (byte i = 0; i < uid.size; i++) {
-      snprintf(uidString + (i * 2), 3, "%02X", uid.uidByte[i]);
+  static const char hex[] = "0123456789ABCDEF";
+  if (maxLen == 0) return;
+  size_t length = 0;
+  for (byte i = 0; i < uid.size && length + 2 < maxLen; i++) {
+      uidString[length++] = hex[uid.uidByte[i] >> 4];
+      uidString[length++] = hex[uid.uidByte[i] & 0x0F];
   }
+  uidString[length] = 0;
 }
 
-// Wait until the card is removed from the reader
-void waitForCardRemoval() {
-  while (cardReader.isCardPresent() && !reader_cancel_todo) {
-      vTaskDelay(10 / portTICK_PERIOD_MS);
+// Wait until the card tracked since the read is removed from the reader, the reader's monitor task does the probing
+void waitForCardRemoval(CardReader& reader) {
+  while (!reader.waitForRemoval(50 / portTICK_PERIOD_MS) && !reader_cancel_todo) {
   }
+  reader.stopTracking();
+}
+
+// Report the outcomes of the card accesses of a reader and the RF settings tuned from them
+void logRfStats(const CardReader& reader) {
+  const RfTuner::Stats& stats = reader.rfStats();
+  const RfTuner::Settings& settings = reader.rfSettings();
+  FAST_LOGF(LOG_INFO, "reader %u rf: ok=%u timeout=%u crc=%u collision=%u other=%u steps=%u reverts=%u "
+            "gain=%udB modwidth=0x%02X timeout=%ums", reader.slot(),
+            stats.outcomes[RfTuner::OUTCOME_OK], stats.outcomes[RfTuner::OUTCOME_TIMEOUT],
+            stats.outcomes[RfTuner::OUTCOME_CRC], stats.outcomes[RfTuner::OUTCOME_COLLISION],
+            stats.outcomes[RfTuner::OUTCOME_OTHER], stats.steps, stats.reverts,
+            RfTuner::gainDb(settings.gain), settings.modWidth, settings.timeoutMs);
+}
+
+// Report the health counters of a reader, sent when it fails and when it recovers
+void logReaderHealth(const CardReader& reader) {
+  const CardReader::Health& health = reader.health();
+  FAST_LOGF(health.healthy ? LOG_NOTICE : LOG_ERR, "reader %u %s: checks=%u failures=%u selftests=%u "
+            "selftest_failures=%u resets=%u recoveries=%u", reader.slot(), health.healthy ? "healthy" : "failed",
+            health.checks, health.failures, health.selfTests, health.selfTestFailures, health.resets,
+            health.recoveries);
 }
 
 // Wait for a specific machine state with timeout
@@ -86,12 +114,12 @@ bool getAndVerifyBalance(const char* uidString) {
 
       if (current_user_balance >= 0) {
           Serial.printf("Balance received: %d\n", current_user_balance);
-          fastSyslog.logf(LOG_INFO, "Balance received: %d", current_user_balance);
+          FAST_LOGF(LOG_INFO, "Balance received: %d", current_user_balance);
           session_begin_todo = true;
           return true;
       }
 
-      fastSyslog.logf(LOG_ERR, "Failed to get balance (attempt %d/%d)", attempts + 1, MAX_ATTEMPTS);
+      FAST_LOGF(LOG_ERR, "Failed to get balance (attempt %d/%d)", attempts + 1, MAX_ATTEMPTS);
       vTaskDelay(100 / portTICK_PERIOD_MS);  // Brief wait before retry (reduced from 500ms)
   }
 
@@ -117,46 +145,95 @@ int processPurchase(const char* uidString) {
 }
 
 // Button handling task
+// One task per card reader, pvParameters is the CardReader
 void reader_loop(void *pvParameters) {
+  CardReader& reader = *static_cast<CardReader*>(pvParameters);
   CardReader::Uid uid;
   CardReader::CardSecret secret;
-  bool isUltralightC;
+  bool isAuthenticated;
   char uidString[21];
+  uint32_t reads = 0;
+  uint32_t rfChanges = 0;
 
   Serial.println("Entering button_task...");
   FAST_LOG_DEBUG("entering button task");
 
   vTaskDelay(1000 / portTICK_PERIOD_MS);
 
+  bool healthy = true;
+
   for (;;) {
+      // Check the reader between cards, a reader that failed is reset and not polled until it works again
+      if (reader.maintain() != healthy) {
+          healthy = !healthy;
+          logReaderHealth(reader);
+      }
+      if (!healthy) {
+          vTaskDelay(50 / portTICK_PERIOD_MS);
+          continue;
+      }
+
       // Wait for a card to be presented
-      if (!cardReader.isCardPresent()) {
+      if (!reader.isCardPresent()) {
           vTaskDelay(50 / portTICK_PERIOD_MS);
           continue;
       }
 
       Serial.println("Card detected! Waiting before reading...");
-      FAST_LOG_INFO("card detected");
+      FAST_LOGF(LOG_INFO, "card detected on reader %u", reader.slot());
       vTaskDelay(100 / portTICK_PERIOD_MS);
 
       // Try reading the card
-      Result readResult = cardReader.read(uid, isUltralightC, secret);
+      Result readResult = reader.read(uid, isAuthenticated, secret);
+      reader.trackCard(); // Removal is detected in the background while the session runs
+
+      const RfTuner::Stats& rfStats = reader.rfStats();
+      reads++;
+      if (rfStats.steps + rfStats.reverts != rfChanges || reads % RF_STATS_INTERVAL == 0) {
+          rfChanges = rfStats.steps + rfStats.reverts;
+          logRfStats(reader);
+      }
       if (readResult != Result::OK) {
           FAST_LOG_ERROR("Failed to read card");
 
           // Wait until card is removed before trying again
-          waitForCardRemoval();
+          waitForCardRemoval(reader);
           continue;
       }
 
       // Format UID string
       formatUidString(uid, uidString, sizeof(uidString));
 
-      fastSyslog.logf(LOG_INFO, "uid: %s", uidString);
+      FAST_LOGF(LOG_INFO, "uid: %s", uidString);
+
+      // Cards without proof of their key, blocked cards and, once the whitelist is synced, unknown cards are
+      // rejected without a network request
+      UidCache::Entry account;
+      UidCache::Lookup lookup;
+      CardAdmission admission = admitCard(uid.uidByte, uid.size, isAuthenticated, lookup, account);
+      if (admission != CardAdmission::ACCEPTED) {
+          FAST_LOGF(LOG_WARNING, "reader %u: %s card %s rejected", reader.slot(), cardAdmissionName(admission),
+                    uidString);
+          waitForCardRemoval(reader);
+          continue;
+      }
+      if (lookup == UidCache::Lookup::FOUND) {
+          FAST_LOGF(LOG_INFO, "reader %u: account %lu%s", reader.slot(), (unsigned long)account.token,
+                    (account.flags & UID_CACHE_FLAG_STAFF) ? " (staff)" : "");
+      }
+
+      // The machine runs one vend session at a time, a card on another reader waits for its removal
+      if (xSemaphoreTake(readerSessionMutex, 0) != pdTRUE) {
+          FAST_LOGF(LOG_INFO, "reader %u: session active on another reader", reader.slot());
+          waitForCardRemoval(reader);
+          continue;
+      }
+
       // Wait for machine to be in enabled state
       if (!waitForMachineState(ENABLED_STATE, 5000) || reader_cancel_todo) {
           FAST_LOG_ERROR("Machine not enabled in time");
-          waitForCardRemoval();
+          xSemaphoreGive(readerSessionMutex);
+          waitForCardRemoval(reader);
           continue;
       }
 
@@ -164,9 +241,10 @@ void reader_loop(void *pvParameters) {
       processCardTransaction(uidString, "testitem");
 
       // Wait for card removal before accepting a new card
-      waitForCardRemoval();
+      waitForCardRemoval(reader);
       reader_cancel_todo = false;
       session_end_todo = true;
+      xSemaphoreGive(readerSessionMutex);
 
       // Add a small delay before next loop iteration
       vTaskDelay(200 / portTICK_PERIOD_MS);
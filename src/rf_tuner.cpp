@@ -0,0 +1,134 @@
+#include "rf_tuner.h"
+
+#define RF_MOD_WIDTH_MIN 0x1B      // Pause of 28 / fc, the minimum of ISO/IEC 14443-2
+#define RF_MOD_WIDTH_MAX 0x27      // Pause of 40 / fc, the maximum of ISO/IEC 14443-2
+#define RF_MOD_WIDTH_STEP 3
+#define RF_TIMEOUT_MIN 25          // The default of the library
+#define RF_TIMEOUT_MAX 100         // Also the time a poll takes without a card
+#define RF_TIMEOUT_STEP 25
+
+RfTuner::RfTuner()
+    : mAttempts(0), mTrial(false), mTrialStep(GAIN_UP), mTrialBaseline(0), mCandidate(0), mHold(0) {
+    // PCD_Init() starts with the maximum gain
+    mSettings.gain = MFRC522::RxGain_48dB;
+    mSettings.modWidth = 0x26;
+    mSettings.timeoutMs = RF_TIMEOUT_MIN;
+    mPrevious = mSettings;
+    memset(&mStats, 0, sizeof(mStats));
+    memset(mWindow, 0, sizeof(mWindow));
+}
+
+bool RfTuner::record(MFRC522::StatusCode status, byte errorReg) {
+    Outcome outcome = outcomeOf(status, errorReg);
+    mStats.outcomes[outcome]++;
+    mWindow[outcome]++;
+    if (outcome == OUTCOME_COLLISION) return false; // Says nothing about the link
+
+    if (++mAttempts < RF_TUNER_WINDOW) return false;
+    bool changed = evaluate();
+    memset(mWindow, 0, sizeof(mWindow));
+    mAttempts = 0;
+    return changed;
+}
+
+// Called at the end of a window. Returns true if the settings changed.
+bool RfTuner::evaluate() {
+    static const Step timeoutSteps[] = { GAIN_UP, MOD_WIDTH_DOWN, MOD_WIDTH_UP, TIMEOUT_UP };
+    static const Step errorSteps[] = { GAIN_DOWN, MOD_WIDTH_DOWN, MOD_WIDTH_UP };
+    uint8_t failures = mWindow[OUTCOME_TIMEOUT] + mWindow[OUTCOME_CRC];
+
+    if (mTrial) {
+        mTrial = false;
+        if (failures > mTrialBaseline || (failures == mTrialBaseline && mTrialStep == TIMEOUT_UP)) {
+            mSettings = mPrevious;
+            mStats.reverts++;
+            mCandidate++;
+            return true;
+        }
+        if (failures < mTrialBaseline) mCandidate = 0; // Keep the step, tune on from here if needed
+    }
+    if (failures <= RF_TUNER_MAX_FAILURES) {
+        mCandidate = 0;
+        mHold = 0;
+        return false;
+    }
+    if (mHold > 0) {
+        mHold--;
+        return false;
+    }
+
+    bool timeouts = mWindow[OUTCOME_TIMEOUT] >= mWindow[OUTCOME_CRC];
+    const Step *candidates = timeouts ? timeoutSteps : errorSteps;
+    uint8_t count = timeouts ? sizeof(timeoutSteps) / sizeof(Step) : sizeof(errorSteps) / sizeof(Step);
+    mPrevious = mSettings;
+    for (; mCandidate < count; mCandidate++) {
+        if (applyStep(candidates[mCandidate])) {
+            mTrial = true;
+            mTrialStep = candidates[mCandidate];
+            mTrialBaseline = failures;
+            mStats.steps++;
+            return true;
+        }
+    }
+
+    // No step helped, the link is as good as it gets, e.g. a card at the edge of the field
+    mCandidate = 0;
+    mHold = RF_TUNER_HOLD_WINDOWS;
+    return false;
+}
+
+// Moves one setting by one step, false if it is at its bound
+bool RfTuner::applyStep(Step step) {
+    switch (step) {
+    case GAIN_UP:
+        if (mSettings.gain >= MFRC522::RxGain_48dB) return false;
+        mSettings.gain += 0x10;
+        return true;
+    case GAIN_DOWN:
+        if (mSettings.gain <= MFRC522::RxGain_33dB) return false; // Below 33 dB the steps are not monotonic
+        mSettings.gain -= 0x10;
+        return true;
+    case MOD_WIDTH_UP:
+        if (mSettings.modWidth + RF_MOD_WIDTH_STEP > RF_MOD_WIDTH_MAX) return false;
+        mSettings.modWidth += RF_MOD_WIDTH_STEP;
+        return true;
+    case MOD_WIDTH_DOWN:
+        if (mSettings.modWidth - RF_MOD_WIDTH_STEP < RF_MOD_WIDTH_MIN) return false;
+        mSettings.modWidth -= RF_MOD_WIDTH_STEP;
+        return true;
+    case TIMEOUT_UP:
+        if (mSettings.timeoutMs + RF_TIMEOUT_STEP > RF_TIMEOUT_MAX) return false;
+        mSettings.timeoutMs += RF_TIMEOUT_STEP;
+        return true;
+    }
+    return false;
+}
+
+// STATUS_ERROR is a parity or protocol error of the received frame (ErrorReg ParityErr, ProtocolErr) or an answer
+// the library did not expect: a wrong key, a length mismatch, a missing ACK. Only the first one is the RF link.
+RfTuner::Outcome RfTuner::outcomeOf(MFRC522::StatusCode status, byte errorReg) {
+    switch (status) {
+    case MFRC522::STATUS_OK:
+        return OUTCOME_OK;
+    case MFRC522::STATUS_TIMEOUT:
+        return OUTCOME_TIMEOUT;
+    case MFRC522::STATUS_CRC_WRONG:
+        return OUTCOME_CRC;
+    case MFRC522::STATUS_ERROR:
+        return (errorReg & 0x03) ? OUTCOME_CRC : OUTCOME_OTHER; // ParityErr, ProtocolErr
+    case MFRC522::STATUS_COLLISION:
+        return OUTCOME_COLLISION;
+    default:
+        return OUTCOME_OTHER;
+    }
+}
+
+const char *RfTuner::outcomeName(Outcome outcome) {
+    static const char *names[OUTCOME_COUNT] = { "ok", "timeout", "crc", "collision", "other" };
+    return outcome < OUTCOME_COUNT ? names[outcome] : "?";
+}
+
+uint8_t RfTuner::gainDb(byte gain) {
+    static const uint8_t gains[8] = { 18, 23, 18, 23, 33, 38, 43, 48 };
+    return gains[(gain >> 4) & 0x07];
+}
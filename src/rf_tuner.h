@@ -0,0 +1,75 @@
+#pragma once
+#include <MFRC522.h>
+
+#define RF_TUNER_WINDOW 16      // Card accesses per evaluation of the RF settings
+#define RF_TUNER_MAX_FAILURES 1 // Failed accesses per window that are accepted without tuning
+#define RF_TUNER_HOLD_WINDOWS 8 // Windows without tuning after every candidate step failed
+
+// Adapts receiver gain, modulation width and timeout of the MFRC522 to the outcome of the card accesses.
+//
+// Every card access of a read (enumeration, select, authentication, page read) reports its status. When a window of
+// RF_TUNER_WINDOW accesses has more than RF_TUNER_MAX_FAILURES failures, one setting is moved by one step. The step
+// is kept if the next window has fewer failures, otherwise it is reverted and the next candidate is tried. Gain and
+// modulation width steps without change are kept as well, they may have to move several steps before the link gets
+// better. A longer timeout slows down every poll without a card and is only kept if it helps:
+//  - Mostly timeouts, the PICC is not heard: more gain, another modulation width, a longer timeout.
+//  - Mostly CRC and parity errors, a close PICC overdrives the receiver: less gain, another modulation width.
+// Collisions come from stacked cards and other errors (NAK, wrong key) from the protocol, not from the RF link. They
+// are counted but are no failures.
+class RfTuner {
+public:
+    enum Outcome : uint8_t {
+        OUTCOME_OK,
+        OUTCOME_TIMEOUT,
+        OUTCOME_CRC,       // CRC_A or parity error
+        OUTCOME_COLLISION,
+        OUTCOME_OTHER,
+        OUTCOME_COUNT,
+    };
+
+    struct Settings {
+        byte gain;            // RxGain mask of RFCfgReg, MFRC522::RxGain_33dB to RxGain_48dB
+        byte modWidth;        // ModWidthReg at 106 kBd, ISO/IEC 14443-2 allows 0x1B to 0x27
+        uint16_t timeoutMs;   // Timer for PICC answers
+    };
+
+    struct Stats {
+        uint32_t outcomes[OUTCOME_COUNT]; // Since boot
+        uint32_t steps;                   // Settings changes tried
+        uint32_t reverts;                 // Steps that did not help
+    };
+
+    RfTuner();
+    // Returns true if the settings changed and have to be written to the PCD. errorReg is the ErrorReg of the PCD
+    // after a STATUS_ERROR, it tells parity and protocol errors of the frame from a protocol answer like a wrong key.
+    bool record(MFRC522::StatusCode status, byte errorReg = 0);
+    const Settings &settings() const { return mSettings; }
+    const Stats &stats() const { return mStats; }
+    static Outcome outcomeOf(MFRC522::StatusCode status, byte errorReg = 0);
+    static const char *outcomeName(Outcome outcome);
+    static uint8_t gainDb(byte gain); // dB of an RxGain mask
+
+private:
+    enum Step : uint8_t {
+        GAIN_UP,
+        GAIN_DOWN,
+        MOD_WIDTH_UP,
+        MOD_WIDTH_DOWN,
+        TIMEOUT_UP,
+    };
+
+    bool evaluate();
+    bool applyStep(Step step);
+
+private:
+    Settings mSettings;
+    Settings mPrevious;             // Settings before the step on trial
+    Stats mStats;
+    uint8_t mWindow[OUTCOME_COUNT]; // Outcomes of the current window
+    uint8_t mAttempts;
+    bool mTrial;                    // The current window runs with a new step
+    Step mTrialStep;
+    uint8_t mTrialBaseline;         // Failures of the window before the step
+    uint8_t mCandidate;             // Next step to try out of the candidates for the dominant failure
+    uint8_t mHold;                  // Windows left without tuning
+};
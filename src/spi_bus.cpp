@@ -0,0 +1,114 @@
+#include "spi_bus.h"
+
+SpiBusScheduler::SpiBusScheduler(Policy policy)
+    : mPolicy(policy), mClients(0), mLock(nullptr), mOwner(-1), mOwnerTask(nullptr), mDepth(0), mLastOwner(0) {
+    for (uint8_t i = 0; i < SPI_BUS_MAX_CLIENTS; i++) {
+        mGrant[i] = nullptr;
+        mWaiting[i] = 0;
+        mSkipped[i] = 0;
+        mIrqPending[i] = false;
+        mGrants[i] = 0;
+    }
+}
+
+bool SpiBusScheduler::begin(uint8_t clients) {
+    if (mLock) return true;
+    if (clients == 0 || clients > SPI_BUS_MAX_CLIENTS) return false;
+
+    mLock = xSemaphoreCreateMutex();
+    if (!mLock) return false;
+    for (uint8_t i = 0; i < clients; i++) {
+        // Counting: every waiting task of the client takes one grant
+        mGrant[i] = xSemaphoreCreateCounting(UINT8_MAX, 0);
+        if (!mGrant[i]) return false;
+    }
+    mClients = clients;
+    mLastOwner = clients - 1; // First round starts with client 0
+    return true;
+}
+
+void SpiBusScheduler::acquire(uint8_t client) {
+    if (!mLock || client >= mClients) return;
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    if (mOwner >= 0 && mOwnerTask == self) {
+        mDepth++;
+        xSemaphoreGive(mLock);
+        return;
+    }
+    if (mOwner < 0) {
+        grant(client);
+        mOwnerTask = self;
+        xSemaphoreGive(mLock);
+        return;
+    }
+    mWaiting[client]++;
+    xSemaphoreGive(mLock);
+
+    // release() of the current owner makes the client the owner before giving the semaphore, the task that takes
+    // it holds the bus
+    xSemaphoreTake(mGrant[client], portMAX_DELAY);
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    mOwnerTask = self;
+    xSemaphoreGive(mLock);
+}
+
+void SpiBusScheduler::release(uint8_t client) {
+    if (!mLock || client >= mClients) return;
+
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    if (mOwner == client && mDepth > 0) {
+        mDepth--;
+    } else if (mOwner == client) {
+        mOwner = -1;
+        mOwnerTask = nullptr;
+        int8_t next = selectNext();
+        if (next >= 0) {
+            mWaiting[next]--;
+            grant(next);
+            xSemaphoreGive(mGrant[next]);
+        }
+    }
+    xSemaphoreGive(mLock);
+}
+
+void IRAM_ATTR SpiBusScheduler::notifyFromISR(uint8_t client) {
+    if (client < SPI_BUS_MAX_CLIENTS) mIrqPending[client] = true;
+}
+
+// Called with mLock held
+void SpiBusScheduler::grant(uint8_t client) {
+    mOwner = client;
+    mLastOwner = client;
+    mSkipped[client] = 0;
+    mIrqPending[client] = false;
+    mGrants[client]++;
+}
+
+// Called with mLock held. Returns the waiting client to hand the bus to, -1 if nobody waits.
+int8_t SpiBusScheduler::selectNext() {
+    int8_t roundRobin = -1;
+    int8_t irq = -1;
+    int8_t overdue = -1;
+
+    for (uint8_t i = 1; i <= mClients; i++) {
+        uint8_t client = (mLastOwner + i) % mClients;
+        if (!mWaiting[client]) continue;
+        if (roundRobin < 0) roundRobin = client;
+        if (irq < 0 && mIrqPending[client]) irq = client;
+        if (overdue < 0 && mSkipped[client] >= SPI_BUS_MAX_SKIPS) overdue = client;
+    }
+
+    int8_t next = roundRobin;
+    if (overdue >= 0) {
+        next = overdue;
+    } else if (mPolicy == Policy::IRQ_PRIORITY && irq >= 0) {
+        next = irq;
+    }
+
+    for (uint8_t client = 0; client < mClients; client++) {
+        if (mWaiting[client] && client != next) mSkipped[client]++;
+    }
+    return next;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#define SPI_BUS_MAX_CLIENTS 8 // Max number of readers sharing the bus
+#define SPI_BUS_MAX_SKIPS 2   // A waiting reader is passed over at most this often before it gets the bus
+
+// Hands the SPI bus to one card reader at a time.
+//
+// Every reader task wraps its SPI work (a poll, a select, an authentication) in acquire()/release(), or a Guard.
+// A reader releasing the bus passes it on to a waiting reader instead of grabbing it again, so a reader with a card
+// in the field can not starve the others:
+//  - ROUND_ROBIN: waiting readers get the bus in turn, starting after the last owner.
+//  - IRQ_PRIORITY: readers whose IRQ pin fired (a PICC answered) go first, a waiting reader is never passed over
+//    more than SPI_BUS_MAX_SKIPS times.
+// Several tasks may share a client (a reader task and its presence task), they get the bus one after the other.
+// acquire() nests: the task holding the bus may acquire it again and keeps it until the matching release().
+class SpiBusScheduler {
+public:
+    enum class Policy : uint8_t {
+        ROUND_ROBIN,
+        IRQ_PRIORITY,
+    };
+
+    // Holds the bus for the lifetime of the guard, a null scheduler makes it a no-op
+    class Guard {
+    public:
+        Guard(SpiBusScheduler *bus, uint8_t client) : mBus(bus), mClient(client) {
+            if (mBus) mBus->acquire(mClient);
+        }
+        ~Guard() {
+            if (mBus) mBus->release(mClient);
+        }
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+    private:
+        SpiBusScheduler *mBus;
+        uint8_t mClient;
+    };
+
+    explicit SpiBusScheduler(Policy policy = Policy::ROUND_ROBIN);
+    bool begin(uint8_t clients);
+    void acquire(uint8_t client);
+    void release(uint8_t client);
+    void notifyFromISR(uint8_t client); // IRQ pin of the client fired
+    uint32_t grants(uint8_t client) const { return client < mClients ? mGrants[client] : 0; }
+
+private:
+    int8_t selectNext();
+    void grant(uint8_t client);
+
+private:
+    Policy mPolicy;
+    uint8_t mClients;
+    SemaphoreHandle_t mLock;                            // Protects the scheduler state, not held while using the bus
+    SemaphoreHandle_t mGrant[SPI_BUS_MAX_CLIENTS];      // Given to a waiting client when it becomes the owner
+    int8_t mOwner;                                      // -1 while the bus is free
+    TaskHandle_t mOwnerTask;                            // Task of mOwner holding the bus, null until it woke up
+    uint8_t mDepth;                                     // Nested acquire() calls of mOwnerTask
+    uint8_t mLastOwner;
+    uint8_t mWaiting[SPI_BUS_MAX_CLIENTS];              // Tasks of the client waiting for the bus
+    uint8_t mSkipped[SPI_BUS_MAX_CLIENTS];
+    volatile bool mIrqPending[SPI_BUS_MAX_CLIENTS];
+    uint32_t mGrants[SPI_BUS_MAX_CLIENTS];
+};
@@ -0,0 +1,224 @@
+#include "uid_cache.h"
+#include <Preferences.h>
+#include <nvs_flash.h>
+
+UidCache uidCache;
+
+bool cardStoreBegin() {
+    static bool mounted = nvs_flash_init_partition(CARD_STORE_PARTITION) == ESP_OK;
+    return mounted;
+}
+
+UidCache::UidCache() : mUsed(0), mDeleted(0), mVersion(0), mComplete(false), mOverflow(false), mLock(nullptr) {
+    memset(mTable, 0, sizeof(mTable));
+    memset(mDirty, 0, sizeof(mDirty));
+}
+
+bool UidCache::begin() {
+    if (!mLock) mLock = xSemaphoreCreateMutex();
+    if (!mLock) return false;
+
+    Preferences prefs;
+    if (!cardStoreBegin() || !prefs.begin(UID_CACHE_NAMESPACE, true, CARD_STORE_PARTITION)) return true; // Nothing stored yet
+
+    // A table of another layout or one whose commit() did not complete (version 0) is dropped, the next sync loads
+    // the whitelist again
+    bool valid = prefs.getUInt("layout", 0) == UID_CACHE_CAPACITY * sizeof(Entry) && prefs.getUInt("version", 0) != 0;
+    for (uint16_t chunk = 0; valid && chunk < CHUNKS; chunk++) {
+        char name[8];
+        snprintf(name, sizeof(name), "c%u", chunk);
+        Entry *slots = &mTable[chunk * UID_CACHE_CHUNK_SLOTS];
+        valid = prefs.getBytes(name, slots, UID_CACHE_CHUNK_SLOTS * sizeof(Entry)) == UID_CACHE_CHUNK_SLOTS * sizeof(Entry);
+    }
+    if (valid) {
+        mVersion = prefs.getUInt("version", 0);
+        mComplete = prefs.getBool("complete", false);
+        mOverflow = prefs.getBool("overflow", false);
+    }
+    prefs.end();
+
+    if (!valid) {
+        clear();
+        return true;
+    }
+    mUsed = 0;
+    mDeleted = 0;
+    for (uint32_t i = 0; i < UID_CACHE_CAPACITY; i++) {
+        if (mTable[i].key == KEY_DELETED) mDeleted++;
+        else if (mTable[i].key != KEY_EMPTY) mUsed++;
+    }
+    return true;
+}
+
+UidCache::Lookup UidCache::find(const byte *uid, byte size, Entry &entry) {
+    uint64_t key = keyOf(uid, size);
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    int32_t slot = slotOf(key);
+    Lookup lookup;
+    if (slot >= 0) {
+        entry = mTable[slot];
+        lookup = Lookup::FOUND;
+    } else {
+        lookup = (!mComplete || mOverflow) ? Lookup::NOT_SYNCED : Lookup::UNKNOWN;
+    }
+    xSemaphoreGive(mLock);
+    return lookup;
+}
+
+void UidCache::clear() {
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    memset(mTable, 0, sizeof(mTable));
+    memset(mDirty, 0xFF, sizeof(mDirty));
+    mUsed = 0;
+    mDeleted = 0;
+    mVersion = 0;
+    mComplete = false;
+    mOverflow = false;
+    xSemaphoreGive(mLock);
+}
+
+bool UidCache::put(const byte *uid, byte size, uint32_t token, uint8_t flags) {
+    uint64_t key = keyOf(uid, size);
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    int32_t slot = slotOf(key);
+    if (slot < 0) {
+        if ((mUsed + 1) * 4 > UID_CACHE_CAPACITY * 3) {
+            mOverflow = true;
+            xSemaphoreGive(mLock);
+            return false;
+        }
+        if ((mUsed + mDeleted + 1) * 4 > UID_CACHE_CAPACITY * 3) rehash();
+
+        // First free slot of the probe sequence, a tombstone is reused
+        uint32_t i = (key ^ (key >> 32)) & (UID_CACHE_CAPACITY - 1);
+        while (mTable[i].key != KEY_EMPTY && mTable[i].key != KEY_DELETED) {
+            i = (i + 1) & (UID_CACHE_CAPACITY - 1);
+        }
+        if (mTable[i].key == KEY_DELETED) mDeleted--;
+        mUsed++;
+        slot = i;
+    }
+    mTable[slot].key = key;
+    mTable[slot].token = token;
+    mTable[slot].flags = flags;
+    markDirty(slot);
+    xSemaphoreGive(mLock);
+    return true;
+}
+
+void UidCache::remove(const byte *uid, byte size) {
+    uint64_t key = keyOf(uid, size);
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    int32_t slot = slotOf(key);
+    if (slot >= 0) {
+        // A tombstone keeps the probe sequences of the other keys intact
+        memset(&mTable[slot], 0, sizeof(Entry));
+        mTable[slot].key = KEY_DELETED;
+        mUsed--;
+        mDeleted++;
+        markDirty(slot);
+    }
+    xSemaphoreGive(mLock);
+}
+
+bool UidCache::commit(uint32_t version, bool complete) {
+    Preferences prefs;
+    if (!cardStoreBegin()) {
+        xSemaphoreTake(mLock, portMAX_DELAY);
+        mVersion = version;
+        mComplete = complete;
+        xSemaphoreGive(mLock);
+        return true;
+    }
+    if (!prefs.begin(UID_CACHE_NAMESPACE, false, CARD_STORE_PARTITION)) return false;
+
+    // The stored version is invalidated before the first chunk is written, begin() drops a table with chunks of the
+    // old and the new version after a reset in between.
+    // Chunks are copied under the lock, the flash writes run without it so lookups are not blocked
+    bool ok = prefs.putUInt("version", 0) > 0 && prefs.putUInt("layout", UID_CACHE_CAPACITY * sizeof(Entry)) > 0;
+    Entry chunkCopy[UID_CACHE_CHUNK_SLOTS];
+    for (uint16_t chunk = 0; ok && chunk < CHUNKS; chunk++) {
+        xSemaphoreTake(mLock, portMAX_DELAY);
+        bool dirty = mDirty[chunk / 32] & (1u << (chunk % 32));
+        if (dirty) {
+            memcpy(chunkCopy, &mTable[chunk * UID_CACHE_CHUNK_SLOTS], sizeof(chunkCopy));
+            mDirty[chunk / 32] &= ~(1u << (chunk % 32));
+        }
+        xSemaphoreGive(mLock);
+        if (!dirty) continue;
+
+        char name[8];
+        snprintf(name, sizeof(name), "c%u", chunk);
+        ok = prefs.putBytes(name, chunkCopy, sizeof(chunkCopy)) == sizeof(chunkCopy);
+    }
+
+    // The version is written last, after a failed commit the next sync asks for the same changes again
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    bool overflow = mOverflow;
+    if (ok) {
+        mVersion = version;
+        mComplete = complete;
+    }
+    xSemaphoreGive(mLock);
+    if (ok) {
+        ok = prefs.putBool("overflow", overflow) && prefs.putBool("complete", complete) &&
+             prefs.putUInt("version", version) > 0;
+    }
+    prefs.end();
+    if (!ok) {
+        xSemaphoreTake(mLock, portMAX_DELAY);
+        memset(mDirty, 0xFF, sizeof(mDirty));
+        xSemaphoreGive(mLock);
+    }
+    return ok;
+}
+
+// FNV-1a over the UID bytes and the length, a 4 byte UID never hashes like the prefix of a 7 byte one
+uint64_t UidCache::keyOf(const byte *uid, byte size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (byte i = 0; i < size; i++) {
+        hash = (hash ^ uid[i]) * 0x100000001B3ULL;
+    }
+    hash = (hash ^ size) * 0x100000001B3ULL;
+    return hash > KEY_DELETED ? hash : hash + 2;
+}
+
+// Called with mLock held. Returns the slot of key, -1 if it is not in the table.
+int32_t UidCache::slotOf(uint64_t key) const {
+    uint32_t i = (key ^ (key >> 32)) & (UID_CACHE_CAPACITY - 1);
+    for (uint32_t n = 0; n < UID_CACHE_CAPACITY; n++) {
+        if (mTable[i].key == KEY_EMPTY) return -1;
+        if (mTable[i].key == key) return i;
+        i = (i + 1) & (UID_CACHE_CAPACITY - 1);
+    }
+    return -1;
+}
+
+// Called with mLock held. Drops the tombstones in place, without a second table: every entry not yet placed is
+// moved to the first free or not yet placed slot of its probe sequence, a displaced entry continues from there. Placed
+// entries are never moved again, so the slots between the home slot and the slot of an entry stay used.
+// Every chunk is written by the next commit.
+void UidCache::rehash() {
+    uint32_t placed[UID_CACHE_CAPACITY / 32];
+    memset(placed, 0, sizeof(placed));
+    for (uint32_t n = 0; n < UID_CACHE_CAPACITY; n++) {
+        if (mTable[n].key == KEY_DELETED) mTable[n].key = KEY_EMPTY;
+    }
+    for (uint32_t n = 0; n < UID_CACHE_CAPACITY; n++) {
+        if (mTable[n].key == KEY_EMPTY || (placed[n / 32] & (1u << (n % 32)))) continue;
+        Entry entry = mTable[n];
+        memset(&mTable[n], 0, sizeof(Entry));
+        while (entry.key != KEY_EMPTY) {
+            uint32_t i = (entry.key ^ (entry.key >> 32)) & (UID_CACHE_CAPACITY - 1);
+            while (mTable[i].key != KEY_EMPTY && (placed[i / 32] & (1u << (i % 32)))) {
+                i = (i + 1) & (UID_CACHE_CAPACITY - 1);
+            }
+            Entry displaced = mTable[i];
+            mTable[i] = entry;
+            placed[i / 32] |= 1u << (i % 32);
+            entry = displaced;
+        }
+    }
+    mDeleted = 0;
+    memset(mDirty, 0xFF, sizeof(mDirty));
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define UID_CACHE_CAPACITY 1024          // Slots, a power of two. At most 3/4 are used so probe sequences stay short
+#define UID_CACHE_CHUNK_SLOTS 64         // Slots per NVS blob, a sync only writes the chunks it changed
+#define UID_CACHE_NAMESPACE "uidcache"   // NVS namespace of the table
+#define CARD_STORE_PARTITION "cards"     // NVS partition of the UID cache and the blocklist, see partitions.csv
+
+#define UID_CACHE_FLAG_BLOCKED 0x01 // Card is rejected without asking the backend
+#define UID_CACHE_FLAG_STAFF   0x02 // Card of the operators
+
+// Known card UIDs with the account token and flags of the backend, persisted in NVS.
+//
+// The table uses open addressing with linear probing over a 64 bit FNV-1a hash of the UID, the UID itself is not
+// stored. A lookup takes a few microseconds, so reader_loop rejects blocked cards and, once the table holds the full
+// whitelist, unknown cards before any network request. The backend sends the changes since the version of the last
+// sync (syncUidCache()), commit() writes the changed chunks and the new version to the card store partition.
+class UidCache {
+public:
+    struct Entry {
+        uint64_t key;   // Hash of the UID, KEY_EMPTY and KEY_DELETED mark free slots
+        uint32_t token; // Account token of the backend
+        uint8_t flags;  // UID_CACHE_FLAG_*
+    };
+
+    enum class Lookup : uint8_t {
+        FOUND,
+        UNKNOWN,    // Not in the whitelist
+        NOT_SYNCED, // No complete whitelist yet, the backend has to decide
+    };
+
+    UidCache();
+    bool begin();                                          // Loads the table from NVS
+    Lookup find(const byte *uid, byte size, Entry &entry); // entry is set if FOUND
+
+    // Sync from the backend: clear() for a full resync, put() and remove() the changes, commit() the new version.
+    // complete is false while the backend has more pages of changes, unknown cards are not rejected until then.
+    void clear();
+    bool put(const byte *uid, byte size, uint32_t token, uint8_t flags);
+    void remove(const byte *uid, byte size);
+    bool commit(uint32_t version, bool complete);
+
+    uint32_t version() const { return mVersion; }
+    uint16_t entries() const { return mUsed; }
+    bool overflow() const { return mOverflow; }
+
+    static uint64_t keyOf(const byte *uid, byte size);
+
+private:
+    static const uint64_t KEY_EMPTY = 0;
+    static const uint64_t KEY_DELETED = 1;
+    static const uint16_t CHUNKS = UID_CACHE_CAPACITY / UID_CACHE_CHUNK_SLOTS;
+
+    int32_t slotOf(uint64_t key) const;
+    void rehash();
+    void markDirty(uint32_t slot) { mDirty[slot / UID_CACHE_CHUNK_SLOTS / 32] |= 1u << (slot / UID_CACHE_CHUNK_SLOTS % 32); }
+
+private:
+    Entry mTable[UID_CACHE_CAPACITY];
+    uint32_t mDirty[(CHUNKS + 31) / 32]; // Chunks changed since the last commit()
+    uint16_t mUsed;
+    uint16_t mDeleted;                   // Tombstones, removed by rehash()
+    uint32_t mVersion;                   // Backend version of the table, 0 until the first sync
+    bool mComplete;                      // All changes up to mVersion are applied
+    bool mOverflow;                      // A change did not fit, the table is not the full whitelist
+    SemaphoreHandle_t mLock;
+};
+
+// Mounts CARD_STORE_PARTITION. Devices updated over the air keep the partition table they were flashed with, without
+// the partition the UID cache and the blocklist only live in RAM and are synced again after every boot.
+bool cardStoreBegin();
+
+extern UidCache uidCache;
@@ -0,0 +1,29 @@
+// Host shims for the firmware modules tested in the native environment, see platformio.ini [env:native].
+// Only what the modules under test use, the clocks run in real time.
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+typedef uint8_t byte;
+
+inline unsigned long millis() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+    virtual int availableForWrite() { return 0; }
+};
@@ -0,0 +1,57 @@
+// NVS in memory: one store for all namespaces, kept until the process ends. hostPreferencesFailAfter makes the
+// writes fail after the given number of successful ones, like a full partition.
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+inline std::map<std::string, std::vector<uint8_t>> hostPreferences;
+inline int hostPreferencesWrites = 0;
+inline int hostPreferencesFailAfter = -1; // -1: writes never fail
+
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partition = nullptr) {
+        mPrefix = std::string(name) + "/";
+        if (!readOnly) return true;
+        // Like NVS a namespace without keys cannot be opened read only
+        auto it = hostPreferences.lower_bound(mPrefix);
+        return it != hostPreferences.end() && it->first.compare(0, mPrefix.size(), mPrefix) == 0;
+    }
+    void end() {}
+
+    size_t putBytes(const char *key, const void *value, size_t length) {
+        if (hostPreferencesFailAfter >= 0 && hostPreferencesWrites >= hostPreferencesFailAfter) return 0;
+        hostPreferencesWrites++;
+        const uint8_t *bytes = static_cast<const uint8_t *>(value);
+        hostPreferences[mPrefix + key].assign(bytes, bytes + length);
+        return length;
+    }
+    size_t getBytes(const char *key, void *value, size_t length) {
+        auto it = hostPreferences.find(mPrefix + key);
+        if (it == hostPreferences.end() || it->second.size() > length) return 0;
+        memcpy(value, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
+    size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0) {
+        uint32_t value;
+        return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+    }
+    size_t putUChar(const char *key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0) {
+        uint8_t value;
+        return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+    }
+    size_t putBool(const char *key, bool value) { return putBytes(key, &value, sizeof(value)); }
+    bool getBool(const char *key, bool defaultValue = false) {
+        bool value;
+        return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+    }
+
+private:
+    std::string mPrefix;
+};
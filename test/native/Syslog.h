@@ -0,0 +1,47 @@
+// Syslog of arcao/Syslog, sends "<priority>message" datagrams
+#pragma once
+#include <cstdarg>
+#include <cstdio>
+#include <WiFiUdp.h>
+
+#define SYSLOG_PROTO_IETF 0
+
+#define LOG_EMERG 0
+#define LOG_ALERT 1
+#define LOG_CRIT 2
+#define LOG_ERR 3
+#define LOG_WARNING 4
+#define LOG_NOTICE 5
+#define LOG_INFO 6
+#define LOG_DEBUG 7
+
+#define LOG_KERN (0 << 3)
+#define LOG_USER (1 << 3)
+#define LOG_LOCAL0 (16 << 3)
+
+class Syslog {
+public:
+    Syslog(WiFiUDP &client, uint8_t protocol) : mClient(client) {}
+    Syslog &server(const char *server, uint16_t port) { return *this; }
+    Syslog &deviceHostname(const char *deviceHostname) { return *this; }
+    Syslog &appName(const char *appName) { return *this; }
+    Syslog &defaultPriority(uint16_t priority) { return *this; }
+
+    bool log(uint16_t priority, const char *message) { return logf(priority, "%s", message); }
+    bool logf(uint16_t priority, const char *format, ...) {
+        char message[512];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+        char header[16];
+        int headerLength = snprintf(header, sizeof(header), "<%u>", priority);
+        mClient.beginPacket("", 0);
+        mClient.write(reinterpret_cast<const uint8_t *>(header), headerLength);
+        mClient.write(reinterpret_cast<const uint8_t *>(message), length);
+        return mClient.endPacket();
+    }
+
+private:
+    WiFiUDP &mClient;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#define WL_CONNECTED 3
+
+// Always connected unless a test changes status
+struct HostWiFi {
+    int state = WL_CONNECTED;
+    int status() const { return state; }
+};
+
+inline HostWiFi WiFi;
@@ -0,0 +1,41 @@
+// Datagrams are captured in memory instead of sent, see WiFiUDP::packets()
+#pragma once
+#include <Arduino.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class WiFiUDP {
+public:
+    // Every datagram sent by any WiFiUDP since the start or the last clear()
+    static std::vector<std::string> &packets() {
+        static std::vector<std::string> sent;
+        return sent;
+    }
+    static std::mutex &lock() {
+        static std::mutex packetsLock;
+        return packetsLock;
+    }
+
+    int beginPacket(const char *host, uint16_t port) {
+        mPacket.clear();
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size) {
+        mPacket.append(reinterpret_cast<const char *>(buffer), size);
+        return size;
+    }
+    size_t write(uint8_t value) {
+        mPacket.push_back(value);
+        return 1;
+    }
+    int endPacket() {
+        std::lock_guard<std::mutex> guard(lock());
+        packets().push_back(mPacket);
+        return 1;
+    }
+    void stop() {}
+
+private:
+    std::string mPacket;
+};
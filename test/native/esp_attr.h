@@ -0,0 +1,5 @@
+#pragma once
+
+// The crash log survives a reset on the ESP32, on the host it is a plain static
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
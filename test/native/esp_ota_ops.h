@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+
+typedef struct {
+    uint8_t app_elf_sha256[32];
+} esp_app_desc_t;
+
+inline esp_app_desc_t hostAppDescription = { { 0x48, 0x4F, 0x53, 0x54 } };
+inline const esp_app_desc_t *esp_ota_get_app_description() { return &hostAppDescription; }
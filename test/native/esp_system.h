@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <random>
+
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+inline esp_reset_reason_t hostResetReason = ESP_RST_POWERON;
+inline esp_reset_reason_t esp_reset_reason() { return hostResetReason; }
+
+// Seeded, so a test run is repeatable
+inline uint32_t esp_random() {
+    static std::mt19937 generator(0x5EED);
+    return generator();
+}
@@ -0,0 +1,79 @@
+// Tasks are detached std::threads, notifications a counter with a condition variable
+#pragma once
+#include "FreeRTOS.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct HostTask {
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifications = 0;
+    bool deleted = false;
+};
+
+typedef HostTask *TaskHandle_t;
+
+inline thread_local HostTask *hostCurrentTask = nullptr;
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*function)(void *), const char *name, uint32_t stackDepth,
+                                          void *parameter, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    HostTask *task = new HostTask;
+    if (handle) *handle = task;
+    std::thread([=]() {
+        hostCurrentTask = task;
+        function(parameter);
+    }).detach();
+    return pdPASS;
+}
+
+// A thread cannot be stopped from outside: a deleted task parks in its next vTaskDelay() or ulTaskNotifyTake()
+inline void hostParkIfDeleted(HostTask *task, std::unique_lock<std::mutex> &guard) {
+    if (task && task->deleted) task->notified.wait(guard, []() { return false; });
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->deleted = true;
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+    if (hostCurrentTask) {
+        std::unique_lock<std::mutex> guard(hostCurrentTask->lock);
+        hostParkIfDeleted(hostCurrentTask, guard);
+    }
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return hostCurrentTask; }
+
+inline TickType_t xTaskGetTickCount() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifications++;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    HostTask *task = hostCurrentTask;
+    std::unique_lock<std::mutex> guard(task->lock);
+    hostParkIfDeleted(task, guard);
+    auto pending = [task]() { return task->notifications > 0; };
+    if (ticks == portMAX_DELAY) {
+        task->notified.wait(guard, pending);
+    } else {
+        task->notified.wait_for(guard, std::chrono::milliseconds(ticks), pending);
+    }
+    hostParkIfDeleted(task, guard);
+    uint32_t value = task->notifications;
+    if (value) task->notifications = clearOnExit ? 0 : value - 1;
+    return value;
+}
@@ -0,0 +1,120 @@
+/*
+ * Blocklist cuckoo filter: lookups, a commit that fails halfway and the cost of add() and contains() with 100k
+ * blocked UIDs (BLOCKLIST_BUCKETS 32768 in [env:native]). Run with: pio test -e native -f test_blocklist
+ */
+
+#include <unity.h>
+#include <array>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <Preferences.h>
+#include "blocklist.h"
+
+typedef std::array<byte, 7> TestUid;
+
+static std::vector<TestUid> makeUids(size_t count, uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::vector<TestUid> uids(count);
+    for (TestUid &uid : uids) {
+        for (byte &b : uid) b = generator();
+    }
+    return uids;
+}
+
+// Every test starts without a stored filter
+void setUp(void) {
+    hostPreferences.clear();
+    hostPreferencesWrites = 0;
+    hostPreferencesFailAfter = -1;
+    blocklist.begin();
+}
+
+void tearDown(void) {
+    hostPreferencesFailAfter = -1;
+}
+
+void test_add_contains_remove(void) {
+    std::vector<TestUid> uids = makeUids(1000, 1);
+    for (TestUid &uid : uids) TEST_ASSERT_TRUE(blocklist.add(uid.data(), uid.size()));
+    TEST_ASSERT_EQUAL_UINT32(1000, blocklist.entries());
+    for (TestUid &uid : uids) TEST_ASSERT_TRUE(blocklist.contains(uid.data(), uid.size()));
+
+    for (size_t i = 0; i < uids.size(); i += 2) blocklist.remove(uids[i].data(), uids[i].size());
+    TEST_ASSERT_EQUAL_UINT32(500, blocklist.entries());
+    for (size_t i = 1; i < uids.size(); i += 2) TEST_ASSERT_TRUE(blocklist.contains(uids[i].data(), uids[i].size()));
+
+    TEST_ASSERT_TRUE(blocklist.commit(7));
+    Blocklist reloaded;
+    reloaded.begin();
+    TEST_ASSERT_EQUAL_UINT32(7, reloaded.version());
+    TEST_ASSERT_EQUAL_UINT32(500, reloaded.entries());
+    for (size_t i = 1; i < uids.size(); i += 2) TEST_ASSERT_TRUE(reloaded.contains(uids[i].data(), uids[i].size()));
+}
+
+void test_failed_commit_keeps_blocking(void) {
+    std::vector<TestUid> first = makeUids(2000, 2);
+    std::vector<TestUid> delta = makeUids(2000, 3);
+    for (TestUid &uid : first) blocklist.add(uid.data(), uid.size());
+    TEST_ASSERT_TRUE(blocklist.commit(1));
+
+    // The delta changes every chunk, the flash fills up after some of them. The filter in memory keeps every UID.
+    for (TestUid &uid : delta) blocklist.add(uid.data(), uid.size());
+    hostPreferencesFailAfter = hostPreferencesWrites + 4;
+    TEST_ASSERT_FALSE(blocklist.commit(2));
+    TEST_ASSERT_EQUAL_UINT32(2, blocklist.version());
+    TEST_ASSERT_EQUAL_UINT32(4000, blocklist.entries());
+    for (TestUid &uid : first) TEST_ASSERT_TRUE(blocklist.contains(uid.data(), uid.size()));
+    for (TestUid &uid : delta) TEST_ASSERT_TRUE(blocklist.contains(uid.data(), uid.size()));
+
+    // The mixed chunks in NVS are not loaded after a reset
+    hostPreferencesFailAfter = -1;
+    Blocklist reloaded;
+    reloaded.begin();
+    TEST_ASSERT_EQUAL_UINT32(0, reloaded.version());
+    TEST_ASSERT_EQUAL_UINT32(0, reloaded.entries());
+
+    // The next commit writes every chunk again, also those written before the failure
+    std::vector<TestUid> next = makeUids(10, 6);
+    for (TestUid &uid : next) blocklist.add(uid.data(), uid.size());
+    TEST_ASSERT_TRUE(blocklist.commit(3));
+    Blocklist retried;
+    retried.begin();
+    TEST_ASSERT_EQUAL_UINT32(3, retried.version());
+    TEST_ASSERT_EQUAL_UINT32(4010, retried.entries());
+    for (TestUid &uid : first) TEST_ASSERT_TRUE(retried.contains(uid.data(), uid.size()));
+    for (TestUid &uid : delta) TEST_ASSERT_TRUE(retried.contains(uid.data(), uid.size()));
+}
+
+void test_100k_entries(void) {
+    const size_t count = 100000;
+    std::vector<TestUid> blocked = makeUids(count, 4);
+    std::vector<TestUid> other = makeUids(count, 5);
+
+    auto start = std::chrono::steady_clock::now();
+    for (TestUid &uid : blocked) TEST_ASSERT_TRUE(blocklist.add(uid.data(), uid.size()));
+    double addNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+    TEST_ASSERT_FALSE(blocklist.overflow());
+    for (TestUid &uid : blocked) TEST_ASSERT_TRUE(blocklist.contains(uid.data(), uid.size()));
+
+    uint32_t falsePositives = 0;
+    start = std::chrono::steady_clock::now();
+    for (TestUid &uid : other) falsePositives += blocklist.contains(uid.data(), uid.size());
+    double containsNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+
+    char message[256];
+    snprintf(message, sizeof(message), "%u entries, load %.0f %%, %u bytes (%.1f bits per entry): add %.0f ns, contains %.0f ns, "
+        "false positives %.3f %%", (unsigned)blocklist.entries(), 100.0 * count / (BLOCKLIST_BUCKETS * 4),
+        (unsigned)Blocklist::memoryUse(), Blocklist::memoryUse() * 8.0 / count, addNs, containsNs, 100.0 * falsePositives / count);
+    TEST_MESSAGE(message);
+    // 8 fingerprints of 16 bits per lookup: 8 / 65536 = 0.012 %
+    TEST_ASSERT_LESS_THAN(count / 2000, falsePositives);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_add_contains_remove);
+    RUN_TEST(test_failed_commit_keeps_blocking);
+    RUN_TEST(test_100k_entries);
+    return UNITY_END();
+}
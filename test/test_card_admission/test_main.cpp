@@ -0,0 +1,66 @@
+/*
+ * Card admission in reader_loop: a card read without proof of its key, like an Ultralight C clone that fails the 3DES
+ * authentication with the diversified key, gets no session even if its UID is a valid account.
+ * Run with: pio test -e native -f test_card_admission
+ */
+
+#include <unity.h>
+#include <Preferences.h>
+#include "card_admission.h"
+
+static const byte accountUid[7] = { 0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x80 };
+static const byte blockedUid[7] = { 0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0x81 };
+static const byte otherUid[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+
+// The full whitelist with one account and one blocked card
+void setUp(void) {
+    hostPreferences.clear();
+    uidCache.begin();
+    blocklist.begin();
+    uidCache.clear();
+    blocklist.clear();
+    uidCache.put(accountUid, sizeof(accountUid), 4711, 0);
+    uidCache.put(blockedUid, sizeof(blockedUid), 4712, UID_CACHE_FLAG_BLOCKED);
+    uidCache.commit(1, true);
+}
+
+void tearDown(void) {
+}
+
+void test_wrong_key_gets_no_session(void) {
+    UidCache::Lookup lookup;
+    UidCache::Entry account;
+    TEST_ASSERT_EQUAL(CardAdmission::UNAUTHENTICATED, admitCard(accountUid, sizeof(accountUid), false, lookup, account));
+    TEST_ASSERT_TRUE(lookup != UidCache::Lookup::FOUND);
+    TEST_ASSERT_EQUAL_STRING("unauthenticated", cardAdmissionName(CardAdmission::UNAUTHENTICATED));
+}
+
+void test_authenticated_cards(void) {
+    UidCache::Lookup lookup;
+    UidCache::Entry account;
+    TEST_ASSERT_EQUAL(CardAdmission::ACCEPTED, admitCard(accountUid, sizeof(accountUid), true, lookup, account));
+    TEST_ASSERT_EQUAL(UidCache::Lookup::FOUND, lookup);
+    TEST_ASSERT_EQUAL_UINT32(4711, account.token);
+
+    TEST_ASSERT_EQUAL(CardAdmission::BLOCKED, admitCard(blockedUid, sizeof(blockedUid), true, lookup, account));
+    TEST_ASSERT_EQUAL(CardAdmission::UNKNOWN, admitCard(otherUid, sizeof(otherUid), true, lookup, account));
+}
+
+void test_blocklist_before_the_whitelist_is_synced(void) {
+    UidCache::Lookup lookup;
+    UidCache::Entry account;
+    uidCache.clear();
+    TEST_ASSERT_EQUAL(CardAdmission::ACCEPTED, admitCard(otherUid, sizeof(otherUid), true, lookup, account));
+    TEST_ASSERT_EQUAL(UidCache::Lookup::NOT_SYNCED, lookup);
+    blocklist.add(otherUid, sizeof(otherUid));
+    TEST_ASSERT_EQUAL(CardAdmission::BLOCKED, admitCard(otherUid, sizeof(otherUid), true, lookup, account));
+    TEST_ASSERT_EQUAL(CardAdmission::UNAUTHENTICATED, admitCard(otherUid, sizeof(otherUid), false, lookup, account));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_wrong_key_gets_no_session);
+    RUN_TEST(test_authenticated_cards);
+    RUN_TEST(test_blocklist_before_the_whitelist_is_synced);
+    return UNITY_END();
+}
@@ -0,0 +1,103 @@
+/*
+ * Arena bytes per FastSyslog record for log lines of this firmware, against the 140 byte slots of the fixed ring.
+ * Sizes are those of the ESP32 layout: 16 byte header with 32 bit pointers, 8 byte alignment.
+ * Run with: pio test -e native -f test_fastsyslog_bytes
+ */
+
+#include <unity.h>
+#include <vector>
+#include "FastSyslog.h"
+
+static const size_t ESP32_HEADER = 16;                  // sizeof(FastLogRecord) on the ESP32, 24 on a 64 bit host
+static const size_t OLD_SLOT = 4 + 1 + 1 + 2 + 4 + 128; // Slot of the fixed ring: sequence, header and 128 byte text
+static const size_t OLD_SLOTS = 64;
+
+struct Line {
+    const char* what;
+    size_t length;  // Bytes of message: packed arguments or text with terminator
+};
+
+static std::vector<Line> lines;
+
+static size_t recordSize(size_t length) {
+    return (ESP32_HEADER + length + FAST_SYSLOG_RECORD_ALIGN - 1) & ~(size_t)(FAST_SYSLOG_RECORD_ALIGN - 1);
+}
+
+// FAST_LOGD: the record holds the packed arguments
+template <typename... Args>
+static void deferred(const char* what, const Args&... args) {
+    char packed[FAST_SYSLOG_MESSAGE_SIZE];
+    size_t length = 0;
+    TEST_ASSERT_TRUE(FastLogArgs::packAll(packed, length, args...));
+    lines.push_back({ what, length });
+}
+
+// FAST_LOGF: the record holds the formatted text
+template <typename... Args>
+static void text(const char* what, const char* format, const Args&... args) {
+    char message[FAST_SYSLOG_MESSAGE_SIZE];
+    snprintf(message, sizeof(message), format, args...);
+    lines.push_back({ what, strlen(message) + 1 });
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_bytes_per_line(void) {
+    lines.clear();
+    deferred("mdb POLL");
+    deferred("mdb VEND_REQUEST", 150, 12);
+    deferred("mdb VEND_SUCCESS");
+    deferred("mdb SETUP", 3, 1, 2);
+    deferred("mdb CHK invalid", 0x1A, 0x1B, 6, 0x13);
+    text("reader card detected", "card detected on reader %u", 0u);
+    text("reader uid", "uid: %s", "04A1B2C3D4E5F6");
+    text("reader account", "reader %u: account %lu%s", 1u, 4711ul, "");
+    text("api getBalance", "getBalance took %lums, code: %d", 183ul, 200);
+    text("api uid cache", "UID cache version %lu: %u changes, %u entries (took %lums)", 42ul, 3u, 517u, 240ul);
+    text("reader rf stats", "reader %u rf: ok=%u timeout=%u crc=%u collision=%u other=%u steps=%u reverts=%u "
+         "gain=%udB modwidth=0x%02X timeout=%ums", 0u, 1523u, 12u, 3u, 0u, 1u, 4u, 1u, 43u, 0x26u, 25u);
+    text("ota check", "Checking for firmware updates");
+
+    char message[256];
+    size_t total = 0;
+    for (const Line& line : lines) {
+        total += recordSize(line.length);
+        snprintf(message, sizeof(message), "%-22s %3u payload bytes, %3u record bytes", line.what, (unsigned)line.length,
+                 (unsigned)recordSize(line.length));
+        TEST_MESSAGE(message);
+    }
+    double average = (double)total / lines.size();
+    snprintf(message, sizeof(message), "average %.1f bytes per line: the %u byte arena holds %.0f lines, the old ring %u "
+             "in %u bytes", average, FAST_SYSLOG_ARENA_SIZE, FAST_SYSLOG_ARENA_SIZE / average, (unsigned)OLD_SLOTS,
+             (unsigned)(OLD_SLOTS * OLD_SLOT));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(OLD_SLOT / 2, average);
+    TEST_ASSERT_GREATER_THAN(2 * OLD_SLOTS, FAST_SYSLOG_ARENA_SIZE / average);
+}
+
+// The MDB task with DEBUG enabled: 20 polls per vend request
+void test_mdb_debug_mix(void) {
+    char packed[FAST_SYSLOG_MESSAGE_SIZE];
+    size_t pollLength = 0;
+    size_t vendLength = 0;
+    FastLogArgs::packAll(packed, pollLength);
+    FastLogArgs::packAll(packed, vendLength, 150, 12);
+    double average = (20.0 * recordSize(pollLength) + recordSize(vendLength)) / 21;
+
+    char message[256];
+    snprintf(message, sizeof(message), "MDB debug mix (20 POLL + VEND_REQUEST): %.1f bytes per line, %.0f lines", average,
+             FAST_SYSLOG_ARENA_SIZE / average);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_THAN(4 * OLD_SLOTS, FAST_SYSLOG_ARENA_SIZE / average);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bytes_per_line);
+    RUN_TEST(test_mdb_debug_mix);
+    return UNITY_END();
+}
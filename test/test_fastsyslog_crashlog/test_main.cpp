@@ -0,0 +1,152 @@
+/*
+ * FastSyslog crash log across simulated resets: end() and begin() with the reset reason of hostResetReason. After a
+ * panic or a watchdog the last FAST_SYSLOG_CRASH_RECORDS records of the previous boot follow the reset reason in
+ * order, after power-on the RTC memory is discarded, and deferred records of another firmware image are shown as a
+ * placeholder. Run with: pio test -e native -f test_fastsyslog_crashlog
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <esp_ota_ops.h>
+#include <esp_system.h>
+#include "FastSyslog.h"
+
+struct Message {
+    int severity;
+    std::string text;
+};
+
+// MSG of every record sent since the last call, in order. The PRI of an RFC 5424 record is facility * 8 + severity.
+static std::vector<Message> sentMessages() {
+    while (fastSyslog.getBufferUsage() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(FAST_SYSLOG_FLUSH_MS + 100));
+
+    std::vector<Message> messages;
+    std::lock_guard<std::mutex> guard(WiFiUDP::lock());
+    for (const std::string &datagram : WiFiUDP::packets()) {
+        size_t at = 0;
+        while (at < datagram.size()) {
+            size_t space = datagram.find(' ', at);
+            size_t length = strtoul(datagram.c_str() + at, nullptr, 10);
+            std::string record = datagram.substr(space + 1, length);
+            at = space + 1 + length;
+
+            size_t message = 0;
+            for (int field = 0; field < 7 && message != std::string::npos; field++) {
+                message = record.find(' ', message);
+                if (message != std::string::npos) message++;
+            }
+            if (message == std::string::npos) continue;
+            messages.push_back({ atoi(record.c_str() + 1) % 8, record.substr(message) });
+        }
+    }
+    WiFiUDP::packets().clear();
+    return messages;
+}
+
+// Everything logged so far is sent, then the device resets for reason
+static std::vector<Message> reset(esp_reset_reason_t reason) {
+    sentMessages();
+    fastSyslog.end();
+    hostResetReason = reason;
+    TEST_ASSERT_TRUE(fastSyslog.begin("localhost", 514, "crashlog", "test"));
+    return sentMessages();
+}
+
+static void logNumbered(int count) {
+    for (int number = 0; number < count; number++) {
+        if (number % 2 == 0) {
+            fastSyslog.logf(FAST_SYSLOG_WARNING, "crash n%d", number);
+        } else {
+            fastSyslog.logDeferred(FAST_SYSLOG_WARNING, "crash n%d", number);
+        }
+    }
+}
+
+// Every test starts with the crash log of a clean boot
+void setUp(void) {
+    reset(ESP_RST_POWERON);
+}
+
+void tearDown(void) {
+    hostAppDescription.app_elf_sha256[0] = 0x48;
+}
+
+void test_panic_keeps_the_last_records(void) {
+    const int count = FAST_SYSLOG_CRASH_RECORDS + 8;
+    logNumbered(count);
+    std::vector<Message> messages = reset(ESP_RST_PANIC);
+
+    TEST_ASSERT_EQUAL(1 + FAST_SYSLOG_CRASH_RECORDS, messages.size());
+    char expected[FAST_SYSLOG_MESSAGE_SIZE];
+    snprintf(expected, sizeof(expected), "FastSyslog: reset reason panic (4), %d records of the previous boot follow",
+             FAST_SYSLOG_CRASH_RECORDS);
+    TEST_ASSERT_EQUAL_STRING(expected, messages[0].text.c_str());
+    TEST_ASSERT_EQUAL(FAST_SYSLOG_ERR, messages[0].severity);
+    for (int i = 0; i < FAST_SYSLOG_CRASH_RECORDS; i++) {
+        snprintf(expected, sizeof(expected), "[previous boot] crash n%d", count - FAST_SYSLOG_CRASH_RECORDS + i);
+        TEST_ASSERT_EQUAL_STRING(expected, messages[1 + i].text.c_str());
+        TEST_ASSERT_EQUAL(FAST_SYSLOG_WARNING, messages[1 + i].severity);
+    }
+
+    // The shipped records are not persisted again
+    messages = reset(ESP_RST_PANIC);
+    TEST_ASSERT_EQUAL(1, messages.size());
+    TEST_ASSERT_EQUAL_STRING("FastSyslog: reset reason panic (4), 0 records of the previous boot follow",
+                             messages[0].text.c_str());
+}
+
+void test_task_watchdog(void) {
+    logNumbered(3);
+    std::vector<Message> messages = reset(ESP_RST_TASK_WDT);
+    TEST_ASSERT_EQUAL(4, messages.size());
+    TEST_ASSERT_EQUAL_STRING("FastSyslog: reset reason task watchdog (6), 3 records of the previous boot follow",
+                             messages[0].text.c_str());
+    TEST_ASSERT_EQUAL(FAST_SYSLOG_ERR, messages[0].severity);
+    TEST_ASSERT_EQUAL_STRING("[previous boot] crash n0", messages[1].text.c_str());
+    TEST_ASSERT_EQUAL_STRING("[previous boot] crash n1", messages[2].text.c_str());
+    TEST_ASSERT_EQUAL_STRING("[previous boot] crash n2", messages[3].text.c_str());
+}
+
+void test_power_on_discards(void) {
+    logNumbered(5);
+    std::vector<Message> messages = reset(ESP_RST_POWERON);
+    TEST_ASSERT_EQUAL(1, messages.size());
+    TEST_ASSERT_EQUAL_STRING("FastSyslog: reset reason power-on (1), 0 records of the previous boot follow",
+                             messages[0].text.c_str());
+    TEST_ASSERT_EQUAL(FAST_SYSLOG_NOTICE, messages[0].severity);
+}
+
+void test_another_firmware(void) {
+    fastSyslog.log("crash text", FAST_SYSLOG_WARNING);
+    fastSyslog.logDeferred(FAST_SYSLOG_WARNING, "crash deferred %d", 1);
+    fastSyslog.logEvent(FastLogEvent_vend_success{ 3 });
+
+    // Updated over the air, the format pointers of the old image point to anything
+    hostAppDescription.app_elf_sha256[0] ^= 0xFF;
+    std::vector<Message> messages = reset(ESP_RST_PANIC);
+    TEST_ASSERT_EQUAL(4, messages.size());
+    TEST_ASSERT_EQUAL_STRING("[previous boot] crash text", messages[1].text.c_str());
+    TEST_ASSERT_EQUAL_STRING("[previous boot] (deferred record of another firmware)", messages[2].text.c_str());
+    TEST_ASSERT_EQUAL_STRING("[previous boot] (event record of another firmware)", messages[3].text.c_str());
+
+    // The same image formats them
+    fastSyslog.logDeferred(FAST_SYSLOG_WARNING, "crash deferred %d", 2);
+    messages = reset(ESP_RST_PANIC);
+    TEST_ASSERT_EQUAL(2, messages.size());
+    TEST_ASSERT_EQUAL_STRING("[previous boot] crash deferred 2", messages[1].text.c_str());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_panic_keeps_the_last_records);
+    RUN_TEST(test_task_watchdog);
+    RUN_TEST(test_power_on_discards);
+    RUN_TEST(test_another_firmware);
+    return UNITY_END();
+}
@@ -0,0 +1,125 @@
+/*
+ * FastSyslog drop policies: a thread floods the ring with DEBUG messages while ERRORS errors are logged every
+ * ERROR_INTERVAL_MS. Per priority every message sent is either delivered or counted as dropped, and RESERVE_ERRORS
+ * loses no ERR: the reserve takes the errors logged while the consumer works through the flood ahead of them.
+ * Run with: pio test -e native -f test_fastsyslog_drops
+ */
+
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "FastSyslog.h"
+
+static const int ERRORS = 20;
+static const int ERROR_INTERVAL_MS = 2;
+
+struct Count {
+    uint32_t sent;
+    uint32_t delivered;
+    uint32_t dropped;
+};
+
+static void waitUntilSent() {
+    while (fastSyslog.getBufferUsage() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(FAST_SYSLOG_FLUSH_MS + 100));
+}
+
+// Records of the flood by severity, the PRI of an RFC 5424 record is facility * 8 + severity
+static void countDelivered(Count counts[8]) {
+    std::lock_guard<std::mutex> guard(WiFiUDP::lock());
+    for (const std::string &datagram : WiFiUDP::packets()) {
+        size_t at = 0;
+        while (at < datagram.size()) {
+            size_t space = datagram.find(' ', at);
+            size_t length = strtoul(datagram.c_str() + at, nullptr, 10);
+            std::string record = datagram.substr(space + 1, length);
+            at = space + 1 + length;
+            if (record.find(" flood ") == std::string::npos) continue; // Drop reports
+            counts[atoi(record.c_str() + 1) % 8].delivered++;
+        }
+    }
+    WiFiUDP::packets().clear();
+}
+
+static void runFlood(FastSyslog::DropPolicy policy, const char *name) {
+    waitUntilSent();
+    {
+        std::lock_guard<std::mutex> guard(WiFiUDP::lock());
+        WiFiUDP::packets().clear();
+    }
+    fastSyslog.setDropPolicy(policy);
+
+    Count counts[8] = {};
+    for (uint8_t priority = 0; priority < 8; priority++) {
+        counts[priority].dropped = fastSyslog.getDroppedMessages(priority);
+    }
+    std::atomic<bool> flooding(true);
+    std::thread flood([&]() {
+        for (int number = 0; flooding; number++) {
+            if (number % 2 == 0) {
+                fastSyslog.logf(FAST_SYSLOG_DEBUG, "flood n%d", number);
+            } else {
+                fastSyslog.logDeferred(FAST_SYSLOG_DEBUG, "flood n%d", number);
+            }
+            counts[FAST_SYSLOG_DEBUG].sent++;
+        }
+    });
+    for (int number = 0; number < ERRORS; number++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ERROR_INTERVAL_MS));
+        fastSyslog.logDeferred(FAST_SYSLOG_ERR, "flood error n%d", number);
+        counts[FAST_SYSLOG_ERR].sent++;
+    }
+    flooding = false;
+    flood.join();
+    waitUntilSent();
+    for (uint8_t priority = 0; priority < 8; priority++) {
+        counts[priority].dropped = fastSyslog.getDroppedMessages(priority) - counts[priority].dropped;
+    }
+    countDelivered(counts);
+    fastSyslog.setDropPolicy(FastSyslog::DropPolicy::DROP_NEWEST);
+
+    const Count &err = counts[FAST_SYSLOG_ERR];
+    const Count &debug = counts[FAST_SYSLOG_DEBUG];
+    char message[256];
+    snprintf(message, sizeof(message), "%s: err %u sent, %u delivered, %u dropped; debug %u sent, %u delivered, %u dropped",
+             name, err.sent, err.delivered, err.dropped, debug.sent, debug.delivered, debug.dropped);
+    TEST_MESSAGE(message);
+    for (uint8_t priority = 0; priority < 8; priority++) {
+        TEST_ASSERT_EQUAL_UINT32(counts[priority].sent, counts[priority].delivered + counts[priority].dropped);
+    }
+    // The flood has to overrun the ring for the policy to matter
+    TEST_ASSERT_TRUE(debug.dropped > 0);
+    if (policy == FastSyslog::DropPolicy::RESERVE_ERRORS) TEST_ASSERT_EQUAL_UINT32(0, err.dropped);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_drop_newest(void) {
+    runFlood(FastSyslog::DropPolicy::DROP_NEWEST, "drop newest");
+}
+
+void test_overwrite_oldest(void) {
+    runFlood(FastSyslog::DropPolicy::OVERWRITE_OLDEST, "overwrite oldest");
+}
+
+void test_reserve_errors(void) {
+    runFlood(FastSyslog::DropPolicy::RESERVE_ERRORS, "reserve errors");
+}
+
+int main(int argc, char **argv) {
+    fastSyslog.begin("localhost", 514, "drops", "test");
+    UNITY_BEGIN();
+    RUN_TEST(test_drop_newest);
+    RUN_TEST(test_overwrite_oldest);
+    RUN_TEST(test_reserve_errors);
+    waitUntilSent();
+    return UNITY_END();
+}
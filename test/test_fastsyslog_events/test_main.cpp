@@ -0,0 +1,74 @@
+/*
+ * FAST_LOG_EVENT from a module at the default level: events have a runtime level of their own and are sent while the
+ * module only logs errors. Run with: pio test -e native -f test_fastsyslog_events
+ */
+
+#define FAST_SYSLOG_MODULE FAST_LOG_MODULE_MDB
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <Preferences.h>
+#include "FastSyslog.h"
+
+// Datagrams sent since the last call that contain text
+static int sentWith(const char* text) {
+    while (fastSyslog.getBufferUsage() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(FAST_SYSLOG_FLUSH_MS + 100));
+
+    std::lock_guard<std::mutex> guard(WiFiUDP::lock());
+    int count = 0;
+    for (const std::string& datagram : WiFiUDP::packets()) {
+        count += datagram.find(text) != std::string::npos;
+    }
+    WiFiUDP::packets().clear();
+    return count;
+}
+
+// Every test starts with the levels of a device that never synced them
+void setUp(void) {
+    for (uint8_t module = 0; module < FAST_LOG_MODULE_COUNT; module++) {
+        fastSyslog.setLevel(module, FastSyslog::defaultLevel(module));
+    }
+    hostPreferences.clear();
+    sentWith("");
+}
+
+void tearDown(void) {
+}
+
+void test_events_at_default_levels(void) {
+    TEST_ASSERT_EQUAL_UINT8(FAST_SYSLOG_DEFAULT_LEVEL, fastSyslog.level(FAST_LOG_MODULE_MDB));
+    TEST_ASSERT_EQUAL_UINT8(FAST_SYSLOG_EVENT_LEVEL, fastSyslog.level(FAST_LOG_MODULE_EVENTS));
+
+    FAST_LOGF(LOG_INFO, "MDB: VEND_REQUEST price=%d num=%d", 150, 3);
+    FAST_LOG_EVENT(vend_request, 150, 3);
+    TEST_ASSERT_EQUAL(0, sentWith("MDB: VEND_REQUEST"));
+    FAST_LOG_EVENT(vend_success, 3);
+    TEST_ASSERT_EQUAL(1, sentWith("[vend_success@32473 "));
+}
+
+void test_events_level_of_its_own(void) {
+    TEST_ASSERT_TRUE(fastSyslog.setLevel(FAST_LOG_MODULE_EVENTS, FAST_SYSLOG_WARNING));
+    sentWith("");
+    FAST_LOG_EVENT(vend_request, 150, 3);
+    TEST_ASSERT_EQUAL(0, sentWith("vend_request"));
+
+    // The stored level is restored at boot, a module without one gets its own default
+    fastSyslog.setLevel(FAST_LOG_MODULE_EVENTS, FAST_SYSLOG_DEBUG);
+    fastSyslog.setLevel(FAST_LOG_MODULE_MDB, FAST_SYSLOG_DEBUG);
+    hostPreferences.erase("loglevels/mdb");
+    TEST_ASSERT_TRUE(fastSyslog.loadLevels());
+    TEST_ASSERT_EQUAL_UINT8(FAST_SYSLOG_DEBUG, fastSyslog.level(FAST_LOG_MODULE_EVENTS));
+    TEST_ASSERT_EQUAL_UINT8(FAST_SYSLOG_DEFAULT_LEVEL, fastSyslog.level(FAST_LOG_MODULE_MDB));
+}
+
+int main(int argc, char **argv) {
+    fastSyslog.begin("localhost", 514, "events", "test");
+    UNITY_BEGIN();
+    RUN_TEST(test_events_at_default_levels);
+    RUN_TEST(test_events_level_of_its_own);
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+/*
+ * FastSyslog::formatDeferred() against snprintf(): every packed tag with the conversions, flags and length modifiers
+ * FAST_LOGD accepts prints the same text, also when the output is cut. Arguments that do not fit a record are sent as
+ * the placeholder. Run with: pio test -e native -f test_fastsyslog_format
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "FastSyslog.h"
+
+// Packs the arguments like logDeferred() and formats them into size bytes
+template <typename... Args>
+static void checkIn(size_t size, const char* format, const Args&... args) {
+    char packed[FAST_SYSLOG_MESSAGE_SIZE];
+    size_t length = 0;
+    TEST_ASSERT_TRUE_MESSAGE(FastLogArgs::packAll(packed, length, args...), format);
+
+    char expected[FAST_SYSLOG_MESSAGE_SIZE];
+    char actual[FAST_SYSLOG_MESSAGE_SIZE];
+    snprintf(expected, size, format, args...);
+    size_t written = FastSyslog::formatDeferred(actual, size, format, packed, length);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, actual, format);
+    TEST_ASSERT_EQUAL_MESSAGE(strlen(expected), written, format);
+}
+
+template <typename... Args>
+static void check(const char* format, const Args&... args) {
+    checkIn(FAST_SYSLOG_MESSAGE_SIZE, format, args...);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_int32_and_uint32(void) {
+    check("%d %i %u", 42, -42, 42u);
+    check("%u", -5);
+    check("%x %X %o", -5, -5, -5);
+    check("%02X", (uint8_t)0x0A);
+    check("%02x:%02x", (uint8_t)0xA1, (uint8_t)0x04);
+    check("%d", (int8_t)-128);
+    check("%hu %hd", (uint16_t)65535, (int16_t)-32768);
+    check("%c%c%c", 'a', (uint8_t)'b', 'c');
+    check("[%-5c|%3c]", 'x', 'y');
+    check("%+d % d %-6d| %06d %.3d", 7, 7, 7, -7, 7);
+    check("%#x %#o %#X", 255u, 8u, 0xABCu);
+    check("%d %u", INT32_MIN, UINT32_MAX);
+    check("%u%%", 100u);
+}
+
+void test_64_bit_integers(void) {
+    check("%lu %ld", 4000000000ul, -4000000000l);
+    check("%lu", (unsigned long)UINT32_MAX);
+    check("%lld %llu", (long long)INT64_MIN, (unsigned long long)UINT64_MAX);
+    check("%llx %llX %llo", -5ll, -5ll, -5ll);
+    check("%lx", -5l);
+    check("%zu", sizeof(FastLogRecord));
+    check("%016llx", 0x0123456789ABCDEFull);
+}
+
+void test_floating_point(void) {
+    check("%f %e %g", 3.14159, -2.5e-7, 1e20);
+    check("%5.2f|%-8.3f|%08.1f", 3.14159f, 2.0, -1.25);
+    check("%.0f %E %G %a", 0.5, 12345.678, 0.0001, 1.0);
+    check("%f", 1e300);
+}
+
+void test_strings_and_pointers(void) {
+    check("uid: %s", "04A1B2C3D4E5F6");
+    check("[%10s|%-10s|%.3s]", "right", "left", "truncated");
+    char mutableString[] = "mutable";
+    check("%s", mutableString);
+    check("%p", (const void*)&checkIn<int>);
+    int value = 0;
+    check("%p", &value);
+    check("%s=%d %s=%lu %s=%.1f", "a", 1, "b", 2ul, "c", 3.0);
+}
+
+// A char* is packed as a string, the address is gone
+void test_pointer_of_a_string(void) {
+    char packed[FAST_SYSLOG_MESSAGE_SIZE];
+    size_t length = 0;
+    TEST_ASSERT_TRUE(FastLogArgs::packAll(packed, length, (const char*)"literal"));
+    char text[FAST_SYSLOG_MESSAGE_SIZE];
+    FastSyslog::formatDeferred(text, sizeof(text), "%p", packed, length);
+    TEST_ASSERT_EQUAL_STRING("literal", text);
+}
+
+void test_cut_output(void) {
+    // Cut within a literal, a number, a string and a floating point number
+    checkIn(8, "literal text %s", "is longer");
+    checkIn(8, "abc %d", 123456789);
+    checkIn(8, "abc %s", "a long string");
+    checkIn(8, "%f", 3.14159);
+    checkIn(1, "%d", 1);
+
+    // The longest string that fits a record
+    std::string longest(FAST_SYSLOG_MESSAGE_SIZE - 2, 's');
+    check("%s", longest.c_str());
+    checkIn(64, "%s", longest.c_str());
+}
+
+void test_arguments_too_long(void) {
+    std::string half(FAST_SYSLOG_MESSAGE_SIZE / 2, 'h');
+    char packed[FAST_SYSLOG_MESSAGE_SIZE];
+    size_t length = 0;
+    TEST_ASSERT_FALSE(FastLogArgs::packAll(packed, length, half.c_str(), half.c_str()));
+    length = 0;
+    TEST_ASSERT_FALSE(FastLogArgs::packAll(packed, length, std::string(FAST_SYSLOG_MESSAGE_SIZE - 1, 's').c_str()));
+
+    // The record holds the placeholder instead of a cut message
+    fastSyslog.begin("localhost", 514, "format", "test");
+    FAST_LOGD(LOG_ERR, "too long %s %s", half.c_str(), half.c_str());
+    while (fastSyslog.getBufferUsage() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(FAST_SYSLOG_FLUSH_MS + 100));
+
+    std::lock_guard<std::mutex> guard(WiFiUDP::lock());
+    int placeholders = 0;
+    for (const std::string& datagram : WiFiUDP::packets()) {
+        placeholders += datagram.find("(deferred record too long)") != std::string::npos;
+        TEST_ASSERT_TRUE(datagram.find(half) == std::string::npos);
+    }
+    TEST_ASSERT_EQUAL(1, placeholders);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_int32_and_uint32);
+    RUN_TEST(test_64_bit_integers);
+    RUN_TEST(test_floating_point);
+    RUN_TEST(test_strings_and_pointers);
+    RUN_TEST(test_pointer_of_a_string);
+    RUN_TEST(test_cut_output);
+    RUN_TEST(test_arguments_too_long);
+    return UNITY_END();
+}
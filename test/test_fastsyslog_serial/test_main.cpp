@@ -0,0 +1,102 @@
+/*
+ * FastLogSerialSink frames: the first write of a deferred record with the longest format and arguments sends BOOT,
+ * FORMAT and DEFERRED at once, each frame is checked for its length and CRC. Run with:
+ * pio test -e native -f test_fastsyslog_serial
+ */
+
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "FastSyslog.h"
+
+class CapturePrint : public Print {
+public:
+    size_t write(const uint8_t *buffer, size_t size) override {
+        writes.push_back(std::vector<uint8_t>(buffer, buffer + size));
+        return size;
+    }
+    int availableForWrite() override { return 4096; }
+
+    std::vector<std::vector<uint8_t>> writes;
+};
+
+struct Frame {
+    uint8_t kind;
+    size_t length;  // Bytes of payload
+};
+
+// Frames of one write, fails the test on a broken frame
+static std::vector<Frame> parseFrames(const std::vector<uint8_t> &bytes) {
+    std::vector<Frame> frames;
+    size_t at = 0;
+    while (at < bytes.size()) {
+        TEST_ASSERT_EQUAL_HEX8(0xFE, bytes[at]);
+        TEST_ASSERT_EQUAL_HEX8(0xFA, bytes[at + 1]);
+        size_t start = at + 2;
+        size_t length = bytes[start + 1];
+        size_t header = 2;
+        if (length & 0x80) {
+            length = (length & 0x7F) << 8 | bytes[start + 2];
+            header = 3;
+        }
+        size_t end = start + header + length;
+        TEST_ASSERT_TRUE(end + 2 <= bytes.size());
+
+        uint16_t crc = 0xFFFF;
+        for (size_t i = start; i < end; i++) {
+            crc ^= (uint16_t)bytes[i] << 8;
+            for (uint8_t bit = 0; bit < 8; bit++) {
+                crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+            }
+        }
+        TEST_ASSERT_EQUAL_HEX16(crc, bytes[end] | bytes[end + 1] << 8);
+        frames.push_back({ (uint8_t)(bytes[start] >> 4), length });
+        at = end + 2;
+    }
+    return frames;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_longest_first_write(void) {
+    CapturePrint port;
+    FastLogSerialSink sink(port, "an-app-name-longer-than-32-bytes-is-cut");
+    static const std::string format(FAST_SYSLOG_MESSAGE_SIZE + 10, 'f');
+    char packed[FAST_SYSLOG_MESSAGE_SIZE];
+    memset(packed, 'a', sizeof(packed));
+
+    FastLogEntry entry = {};
+    entry.priority = FAST_SYSLOG_ERR;
+    entry.format = format.c_str();
+    entry.message = packed;
+    entry.length = sizeof(packed);
+    TEST_ASSERT_TRUE(sink.write(entry));
+    TEST_ASSERT_EQUAL(1, port.writes.size());
+
+    std::vector<Frame> frames = parseFrames(port.writes[0]);
+    TEST_ASSERT_EQUAL(3, frames.size());
+    TEST_ASSERT_EQUAL_UINT8(FastLogSerialSink::BOOT, frames[0].kind);
+    TEST_ASSERT_EQUAL(2 + 32, frames[0].length);
+    TEST_ASSERT_EQUAL_UINT8(FastLogSerialSink::FORMAT, frames[1].kind);
+    TEST_ASSERT_EQUAL(4 + FAST_SYSLOG_MESSAGE_SIZE, frames[1].length);
+    TEST_ASSERT_EQUAL_UINT8(FastLogSerialSink::DEFERRED, frames[2].kind);
+    TEST_ASSERT_EQUAL(6 + 4 + FAST_SYSLOG_MESSAGE_SIZE, frames[2].length);
+
+    char message[256];
+    snprintf(message, sizeof(message), "longest first write: %u bytes in 3 frames", (unsigned)port.writes[0].size());
+    TEST_MESSAGE(message);
+
+    // The format is announced, the next record is one frame
+    TEST_ASSERT_TRUE(sink.write(entry));
+    TEST_ASSERT_EQUAL(1, parseFrames(port.writes[1]).size());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_longest_first_write);
+    return UNITY_END();
+}
@@ -0,0 +1,176 @@
+/*
+ * FastSyslog under contention: threads log numbered messages through logf() and logDeferred() at once, the records
+ * are parsed back from the captured datagrams. Every message arrives whole, in order per thread, or is counted as
+ * dropped. Prints the cost per log call, and checks that an idle consumer does not wake up.
+ * Run with: pio test -e native -f test_fastsyslog_stress
+ */
+
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FastSyslog.h"
+
+static const char PADDING[] = "padpadpadpadpadpadpadpadpad";
+
+struct Delivery {
+    uint32_t delivered; // Complete messages of the threads
+    uint32_t torn;      // Messages of the threads with a wrong checksum or cut off
+    uint32_t reordered; // Messages older than the previous one of their thread
+};
+
+static uint32_t checksum(int thread, int number) {
+    return (thread * 7919u + number) % 1000;
+}
+
+// Octet-counted RFC 5424 records, the MSG follows the 7 header fields
+static Delivery parseDatagrams(int threads) {
+    Delivery result = {};
+    std::vector<int> last(threads, -1);
+    std::lock_guard<std::mutex> guard(WiFiUDP::lock());
+    for (const std::string &datagram : WiFiUDP::packets()) {
+        size_t at = 0;
+        while (at < datagram.size()) {
+            size_t space = datagram.find(' ', at);
+            size_t length = strtoul(datagram.c_str() + at, nullptr, 10);
+            std::string record = datagram.substr(space + 1, length);
+            at = space + 1 + length;
+
+            size_t message = 0;
+            for (int field = 0; field < 7 && message != std::string::npos; field++) {
+                message = record.find(' ', message);
+                if (message != std::string::npos) message++;
+            }
+            if (message == std::string::npos || record.compare(message, 7, "stress ") != 0) continue; // Drop reports
+
+            int thread, number;
+            unsigned check;
+            if (sscanf(record.c_str() + message, "stress t%d n%d chk%u", &thread, &number, &check) != 3 ||
+                thread < 0 || thread >= threads || check != checksum(thread, number) ||
+                record.find(PADDING, message) == std::string::npos) {
+                result.torn++;
+                continue;
+            }
+            if (number <= last[thread]) result.reordered++;
+            last[thread] = number;
+            result.delivered++;
+        }
+    }
+    return result;
+}
+
+static void waitUntilSent() {
+    while (fastSyslog.getBufferUsage() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(FAST_SYSLOG_FLUSH_MS + 100));
+}
+
+// Even threads format with logf(), odd ones pack the arguments for the syslog task. Returns the time per log call,
+// without the waits for room.
+static double logFromThreads(int threads, int perThread, bool waitForRoom) {
+    std::atomic<bool> go(false);
+    std::atomic<uint64_t> totalNs(0);
+    std::vector<std::thread> producers;
+    for (int thread = 0; thread < threads; thread++) {
+        producers.emplace_back([&, thread]() {
+            while (!go) {
+            }
+            uint64_t ns = 0;
+            for (int number = 0; number < perThread; number++) {
+                while (waitForRoom && fastSyslog.isBufferFull()) {
+                    std::this_thread::yield();
+                }
+                auto start = std::chrono::steady_clock::now();
+                if (thread % 2 == 0) {
+                    fastSyslog.logf(FAST_SYSLOG_ERR, "stress t%d n%d chk%u %s", thread, number, checksum(thread, number), PADDING);
+                } else {
+                    fastSyslog.logDeferred(FAST_SYSLOG_ERR, "stress t%d n%d chk%u %s", thread, number, checksum(thread, number), PADDING);
+                }
+                ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            }
+            totalNs += ns;
+        });
+    }
+    go = true;
+    for (std::thread &producer : producers) producer.join();
+    return (double)totalNs / ((double)threads * perThread);
+}
+
+static void runStress(int threads, int perThread, bool waitForRoom) {
+    waitUntilSent();
+    {
+        std::lock_guard<std::mutex> guard(WiFiUDP::lock());
+        WiFiUDP::packets().clear();
+    }
+    uint32_t droppedBefore = fastSyslog.getDroppedMessages(FAST_SYSLOG_ERR);
+    double nsPerLog = logFromThreads(threads, perThread, waitForRoom);
+    waitUntilSent();
+    uint32_t dropped = fastSyslog.getDroppedMessages(FAST_SYSLOG_ERR) - droppedBefore;
+    Delivery delivery = parseDatagrams(threads);
+    uint32_t sent = threads * perThread;
+
+    char message[256];
+    snprintf(message, sizeof(message), "%d threads%s: %u sent, %u delivered, %u dropped, %u torn, %u reordered, %.0f ns per log",
+             threads, waitForRoom ? " waiting for room" : "", sent, delivery.delivered, dropped, delivery.torn,
+             delivery.reordered, nsPerLog);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_UINT32(0, delivery.torn);
+    TEST_ASSERT_EQUAL_UINT32(0, delivery.reordered);
+    TEST_ASSERT_EQUAL_UINT32(sent, delivery.delivered + dropped);
+    if (waitForRoom) TEST_ASSERT_EQUAL_UINT32(0, dropped);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Runs first, later tests leave drops to report and the report is a timed wakeup
+void test_idle_consumer_sleeps(void) {
+    fastSyslog.logf(FAST_SYSLOG_ERR, "stress idle");
+    waitUntilSent();
+    uint32_t wakeups = fastSyslog.getConsumerWakeups();
+    uint32_t awakeUs = fastSyslog.getConsumerAwakeUs();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    wakeups = fastSyslog.getConsumerWakeups() - wakeups;
+    awakeUs = fastSyslog.getConsumerAwakeUs() - awakeUs;
+
+    char message[256];
+    snprintf(message, sizeof(message), "idle for 1 s: %u wakeups, %u us awake (the 1 ms poll woke 1000 times)", wakeups,
+             awakeUs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_UINT32(0, wakeups);
+    TEST_ASSERT_EQUAL_UINT32(0, awakeUs);
+}
+
+void test_single_thread(void) {
+    runStress(1, 20000, true);
+}
+
+void test_threads_waiting_for_room(void) {
+    runStress(4, 20000, true);
+}
+
+void test_threads_overrunning_the_ring(void) {
+    runStress(4, 50000, false);
+}
+
+void test_eight_threads_overrunning_the_ring(void) {
+    runStress(8, 20000, false);
+}
+
+int main(int argc, char **argv) {
+    fastSyslog.begin("localhost", 514, "stress", "test");
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_consumer_sleeps);
+    RUN_TEST(test_single_thread);
+    RUN_TEST(test_threads_waiting_for_room);
+    RUN_TEST(test_threads_overrunning_the_ring);
+    RUN_TEST(test_eight_threads_overrunning_the_ring);
+    waitUntilSent();
+    return UNITY_END();
+}
@@ -0,0 +1,155 @@
+/*
+ * The card paths of the library must not touch the heap: no Arduino String from debug output, at any
+ * MFRC522_LOG_LEVEL. Counts operator new and, with glibc, malloc during authentication, key write and page reads.
+ * Run with: pio test -e native-mfrc522 -f test_mfrc522_alloc
+ */
+
+#include <unity.h>
+#include <new>
+#include <MFRC522.h>
+#include "MFRC522Emulator.h"
+#include "VirtualPicc.h"
+
+static const byte CS_PIN = 10;
+
+static MFRC522Emulator emulator(CS_PIN);
+static MFRC522 mfrc522(CS_PIN, MFRC522::UNUSED_PIN);
+
+static const byte ulcUid[7] = { 0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x80 };
+static const byte ntagUid[7] = { 0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0x81 };
+static VirtualUltralightC ulc(ulcUid);
+static VirtualNtag216 ntag(ntagUid);
+
+static volatile bool counting = false;
+static volatile unsigned allocations = 0;
+
+void *operator new(size_t size) {
+	if (counting) {
+		allocations++;
+	}
+	void *p = malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept {
+	(void)size;
+	free(p);
+}
+
+#ifdef __GLIBC__
+// String of the ESP32 core allocates with malloc/realloc, not with new
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+
+extern "C" void *malloc(size_t size) {
+	if (counting) {
+		allocations++;
+	}
+	return __libc_malloc(size);
+}
+
+extern "C" void *realloc(void *p, size_t size) {
+	if (counting) {
+		allocations++;
+	}
+	return __libc_realloc(p, size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+	if (counting) {
+		allocations++;
+	}
+	return __libc_calloc(count, size);
+}
+#endif
+
+// Allocations of operation, operator new inside it counts twice with glibc
+template <typename Operation>
+static unsigned countAllocations(Operation operation) {
+	allocations = 0;
+	counting = true;
+	operation();
+	counting = false;
+	return allocations;
+}
+
+static bool activate() {
+	byte atqa[2];
+	byte atqaSize = sizeof(atqa);
+	return mfrc522.PICC_WakeupA(atqa, &atqaSize) == MFRC522::STATUS_OK && mfrc522.PICC_Select(&mfrc522.uid) == MFRC522::STATUS_OK;
+}
+
+void setUp(void) {
+	mfrc522.PCD_Init();
+}
+
+void tearDown(void) {
+	counting = false;
+	emulator.removePicc(&ulc);
+	emulator.removePicc(&ntag);
+}
+
+void test_counter_sees_allocations(void) {
+	TEST_ASSERT_GREATER_THAN(0, countAllocations([]() {
+		int *volatile p = new int(1);
+		delete p;
+	}));
+}
+
+void test_ultralight_c_without_allocation(void) {
+	byte key[16] = {	0x49, 0x45, 0x4D, 0x4B, 0x41, 0x45, 0x52, 0x42,
+						0x21, 0x4E, 0x41, 0x43, 0x55, 0x4F, 0x59, 0x46 };
+	byte wrongKey[16] = { 0 };
+	byte buffer[64];
+	emulator.addPicc(&ulc);
+
+	TEST_ASSERT_EQUAL_UINT(0, countAllocations([&]() {
+		TEST_ASSERT_TRUE(activate());
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.MIFARE_UL_C_Auth(key));
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.MIFARE_Ultralight_ReadPages(0x04, 8, buffer, sizeof(buffer)));
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.MIFARE_UL_C_WriteKey(key));
+		mfrc522.PICC_HaltA();
+		// The error paths log too
+		TEST_ASSERT_TRUE(activate());
+		TEST_ASSERT_TRUE(mfrc522.MIFARE_UL_C_Auth(wrongKey) != MFRC522::STATUS_OK);
+	}));
+}
+
+void test_ntag_without_allocation(void) {
+	byte password[4] = { 0x12, 0x34, 0x56, 0x78 };
+	byte wrongPassword[4] = { 0 };
+	const byte pack[2] = { 0xAB, 0xCD };
+	byte buffer[64];
+	byte bufferSize;
+	ntag.setPassword(password, pack, 0x04, true);
+	emulator.addPicc(&ntag);
+
+	TEST_ASSERT_EQUAL_UINT(0, countAllocations([&]() {
+		byte pACK[2];
+		TEST_ASSERT_TRUE(activate());
+		bufferSize = sizeof(buffer);
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.MIFARE_Ultralight_GetVersion(buffer, &bufferSize));
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.PCD_NTAG216_AUTH(password, pACK));
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.MIFARE_Ultralight_ReadPages(0x04, 8, buffer, sizeof(buffer)));
+		mfrc522.PICC_HaltA();
+		TEST_ASSERT_TRUE(activate());
+		TEST_ASSERT_TRUE(mfrc522.PCD_NTAG216_AUTH(wrongPassword, pACK) != MFRC522::STATUS_OK);
+	}));
+}
+
+int main(int argc, char **argv) {
+	Serial.output = nullptr;	// Log statements still run at MFRC522_LOG_LEVEL > NONE, only the output is dropped
+	UNITY_BEGIN();
+	RUN_TEST(test_counter_sees_allocations);
+	RUN_TEST(test_ultralight_c_without_allocation);
+	RUN_TEST(test_ntag_without_allocation);
+	return UNITY_END();
+}
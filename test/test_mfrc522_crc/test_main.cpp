@@ -0,0 +1,134 @@
+/*
+ * CRC_A of PCD_CalculateCRC() against frames captured from real PICC traffic and against the CRC coprocessor of the
+ * MFRC522Emulator, plus the cost of both. Run with: pio test -e native-mfrc522 -f test_mfrc522_crc
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <MFRC522.h>
+#include "MFRC522Emulator.h"
+
+static const byte CS_PIN = 10;
+
+static MFRC522Emulator emulator(CS_PIN);
+static MFRC522 mfrc522(CS_PIN, MFRC522::UNUSED_PIN);
+
+// Command frames with the CRC_A the chip appended on air
+struct Vector {
+	byte data[8];
+	byte length;
+	byte crc[2];
+};
+
+static const Vector vectors[] = {
+	{ { 0x00, 0x00 },								2, { 0xA0, 0x1E } },	// ISO/IEC 14443-3 Annex B
+	{ { 0x12, 0x34 },								2, { 0x26, 0xCF } },	// ISO/IEC 14443-3 Annex B
+	{ { 0x50, 0x00 },								2, { 0x57, 0xCD } },	// HLTA
+	{ { 0x30, 0x00 },								2, { 0x02, 0xA8 } },	// READ page 0
+	{ { 0x30, 0x04 },								2, { 0x26, 0xEE } },	// READ page 4
+	{ { 0x60 },										1, { 0xF8, 0x32 } },	// GET_VERSION
+	{ { 0x1A, 0x00 },								2, { 0x41, 0x76 } },	// Ultralight C AUTHENTICATE
+	{ { 0x1B, 0xFF, 0xFF, 0xFF, 0xFF },				5, { 0x63, 0x00 } },	// PWD_AUTH with the default password
+	{ { 0xE0, 0x50 },								2, { 0xBC, 0xA5 } },	// RATS, FSDI 5
+	{ { 0xE0, 0x80 },								2, { 0x31, 0x73 } },	// RATS, FSDI 8
+};
+
+// Bit by bit CRC_A (ISO/IEC 14443-3 Annex B), independent of the library
+static uint16_t referenceCRC(const byte *data, byte length) {
+	uint16_t crc = 0x6363;
+	for (byte i = 0; i < length; i++) {
+		crc ^= data[i];
+		for (byte bit = 0; bit < 8; bit++) {
+			crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+		}
+	}
+	return crc;
+}
+
+// The coprocessor sequence of MFRC522_CRC_HARDWARE
+static void coprocessorCRC(const byte *data, byte length, byte *result) {
+	mfrc522.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Idle);
+	mfrc522.PCD_WriteRegister(MFRC522::DivIrqReg, 0x04);
+	mfrc522.PCD_WriteRegister(MFRC522::FIFOLevelReg, 0x80);
+	mfrc522.PCD_WriteRegister(MFRC522::FIFODataReg, length, (byte *)data);
+	mfrc522.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_CalcCRC);
+	while (!(mfrc522.PCD_ReadRegister(MFRC522::DivIrqReg) & 0x04)) {
+	}
+	mfrc522.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Idle);
+	result[0] = mfrc522.PCD_ReadRegister(MFRC522::CRCResultRegL);
+	result[1] = mfrc522.PCD_ReadRegister(MFRC522::CRCResultRegH);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_crc_matches_captured_frames(void) {
+	for (const Vector &vector : vectors) {
+		byte result[2] = { 0, 0 };
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.PCD_CalculateCRC((byte *)vector.data, vector.length, result));
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(vector.crc, result, 2);
+	}
+}
+
+void test_crc_matches_coprocessor(void) {
+	byte data[MFRC522Emulator::FIFO_SIZE];
+	uint32_t seed = 1;
+	for (byte length = 0; length <= sizeof(data); length++) {
+		for (byte i = 0; i < length; i++) {
+			seed = seed * 1103515245 + 12345;
+			data[i] = seed >> 16;
+		}
+		byte expected[2];
+		byte result[2];
+		coprocessorCRC(data, length, expected);
+		mfrc522.PCD_CalculateCRC(data, length, result);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, result, 2);
+		TEST_ASSERT_EQUAL_HEX16(referenceCRC(data, length), result[0] | (result[1] << 8));
+	}
+}
+
+void test_crc_cost(void) {
+	byte frame[18] = { 0xA2, 0x04, 0x01, 0x02, 0x03, 0x04 };	// Up to a READ response: 16 bytes and the CRC_A
+	byte result[2];
+
+	MFRC522Emulator::Stats software = emulator.measure([&]() { mfrc522.PCD_CalculateCRC(frame, 16, result); });
+	MFRC522Emulator::Stats coprocessor = emulator.measure([&]() { coprocessorCRC(frame, 16, result); });
+#if MFRC522_CRC_MODE != MFRC522_CRC_HARDWARE
+	TEST_ASSERT_EQUAL_UINT32(0, software.transactions);
+#endif
+
+	const int rounds = 1000000;
+	uint32_t sink = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		frame[0] = i;
+		mfrc522.PCD_CalculateCRC(frame, 16, result);
+		sink += result[0];
+	}
+	double library = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		frame[0] = i;
+		sink += referenceCRC(frame, 16);
+	}
+	double bitwise = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+	char message[256];
+	snprintf(message, sizeof(message), "16 bytes: PCD_CalculateCRC %.1f ns on the host, %u SPI transactions; bit by bit %.1f ns; "
+		"coprocessor %u SPI transactions, %.1f us (checksum %u)", library, software.transactions, bitwise,
+		coprocessor.transactions, coprocessor.elapsedNs / 1000.0, sink & 1);
+	TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+	Serial.output = nullptr;
+	mfrc522.PCD_Init();
+	UNITY_BEGIN();
+	RUN_TEST(test_crc_matches_captured_frames);
+	RUN_TEST(test_crc_matches_coprocessor);
+	RUN_TEST(test_crc_cost);
+	return UNITY_END();
+}
@@ -0,0 +1,180 @@
+/*
+ * 3DES key schedule cache of MIFARE_UL_C_Auth(): the cached schedules against mbedtls_des3_set2key_enc/dec(), known
+ * answers, the LRU replacement and the cost of a hit and a miss. Run with: pio test -e native-mfrc522 -f test_mfrc522_des
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <MFRC522.h>
+#include "MFRC522Emulator.h"
+#include "VirtualPicc.h"
+
+static const byte CS_PIN = 10;
+
+// Opens the cache of MFRC522 for the test
+class CacheProbe : public MFRC522 {
+public:
+	CacheProbe() : MFRC522(CS_PIN, UNUSED_PIN) {}
+	MIFARE_UL_C_KeySchedule *schedule(const byte *key) { return MIFARE_UL_C_GetKeySchedule(key); }
+};
+
+static MFRC522Emulator emulator(CS_PIN);
+static CacheProbe mfrc522;
+
+static byte factoryKey[16] = {	0x49, 0x45, 0x4D, 0x4B, 0x41, 0x45, 0x52, 0x42,
+								0x21, 0x4E, 0x41, 0x43, 0x55, 0x4F, 0x59, 0x46 };
+
+static void makeKey(byte *key, byte seed) {
+	for (byte i = 0; i < 16; i++) {
+		key[i] = seed * 31 + i * 7;
+	}
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_schedules_match_mbedtls(void) {
+	byte key[16];
+	for (byte seed = 0; seed < 20; seed++) {
+		makeKey(key, seed);
+		mbedtls_des3_context enc;
+		mbedtls_des3_context dec;
+		mbedtls_des3_init(&enc);
+		mbedtls_des3_init(&dec);
+		mbedtls_des3_set2key_enc(&enc, key);
+		mbedtls_des3_set2key_dec(&dec, key);
+
+		MFRC522::MIFARE_UL_C_KeySchedule *schedule = mfrc522.schedule(key);
+		TEST_ASSERT_EQUAL_MEMORY(enc.sk, schedule->enc.sk, sizeof(enc.sk));
+		TEST_ASSERT_EQUAL_MEMORY(dec.sk, schedule->dec.sk, sizeof(dec.sk));
+
+		// A hit returns the same schedules
+		TEST_ASSERT_TRUE(mfrc522.schedule(key) == schedule);
+		TEST_ASSERT_EQUAL_MEMORY(dec.sk, schedule->dec.sk, sizeof(dec.sk));
+		mbedtls_des3_free(&enc);
+		mbedtls_des3_free(&dec);
+	}
+}
+
+void test_known_answer(void) {
+	// With both halves equal 2-key 3DES is single DES: FIPS 81 key 0123456789ABCDEF, "Now is t"
+	byte key[16] = {	0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+						0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF };
+	const byte plain[8] = { 0x4E, 0x6F, 0x77, 0x20, 0x69, 0x73, 0x20, 0x74 };
+	const byte cipher[8] = { 0x3F, 0xA4, 0x0E, 0x8A, 0x98, 0x4D, 0x48, 0x15 };
+	byte out[8];
+
+	MFRC522::MIFARE_UL_C_KeySchedule *schedule = mfrc522.schedule(key);
+	mbedtls_des3_crypt_ecb(&schedule->enc, plain, out);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(cipher, out, 8);
+	mbedtls_des3_crypt_ecb(&schedule->dec, cipher, out);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(plain, out, 8);
+
+	// CBC round trip with the factory key, as MIFARE_UL_C_Auth() uses it
+	byte block[16] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+	byte encrypted[16];
+	byte decrypted[16];
+	byte iv[8] = { 0 };
+	schedule = mfrc522.schedule(factoryKey);
+	mbedtls_des3_crypt_cbc(&schedule->enc, MBEDTLS_DES_ENCRYPT, 16, iv, block, encrypted);
+	memset(iv, 0, sizeof(iv));
+	mbedtls_des3_crypt_cbc(&schedule->dec, MBEDTLS_DES_DECRYPT, 16, iv, encrypted, decrypted);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(block, decrypted, 16);
+}
+
+void test_least_recently_used_is_replaced(void) {
+	byte keys[MFRC522_UL_C_KEY_CACHE_SIZE + 1][16];
+	MFRC522::MIFARE_UL_C_KeySchedule *schedules[MFRC522_UL_C_KEY_CACHE_SIZE + 1];
+	for (byte i = 0; i <= MFRC522_UL_C_KEY_CACHE_SIZE; i++) {
+		makeKey(keys[i], 100 + i);
+	}
+	for (byte i = 0; i < MFRC522_UL_C_KEY_CACHE_SIZE; i++) {
+		schedules[i] = mfrc522.schedule(keys[i]);
+	}
+	// Key 0 is used again, so key 1 is the least recently used one
+	TEST_ASSERT_TRUE(mfrc522.schedule(keys[0]) == schedules[0]);
+	schedules[MFRC522_UL_C_KEY_CACHE_SIZE] = mfrc522.schedule(keys[MFRC522_UL_C_KEY_CACHE_SIZE]);
+	TEST_ASSERT_TRUE(schedules[MFRC522_UL_C_KEY_CACHE_SIZE] == schedules[MFRC522_UL_C_KEY_CACHE_SIZE > 1 ? 1 : 0]);
+	TEST_ASSERT_EQUAL_MEMORY(keys[MFRC522_UL_C_KEY_CACHE_SIZE], schedules[MFRC522_UL_C_KEY_CACHE_SIZE]->key, 16);
+	if (MFRC522_UL_C_KEY_CACHE_SIZE > 1) {
+		TEST_ASSERT_TRUE(mfrc522.schedule(keys[0]) == schedules[0]);
+	}
+}
+
+void test_auth_with_cached_key(void) {
+	static const byte uid[7] = { 0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x80 };
+	VirtualUltralightC ulc(uid);
+	emulator.addPicc(&ulc);
+	mfrc522.PCD_Init();
+	for (int i = 0; i < 3; i++) {
+		byte atqa[2];
+		byte atqaSize = sizeof(atqa);
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.PICC_WakeupA(atqa, &atqaSize));
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.PICC_Select(&mfrc522.uid));
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.MIFARE_UL_C_Auth(factoryKey));
+		TEST_ASSERT_TRUE(ulc.authenticated());
+		mfrc522.PICC_HaltA();
+	}
+	emulator.removePicc(&ulc);
+}
+
+void test_schedule_cost(void) {
+	const int rounds = 20000;
+	byte key[16];
+	makeKey(key, 7);
+	byte keys[MFRC522_UL_C_KEY_CACHE_SIZE + 1][16];
+	for (byte i = 0; i <= MFRC522_UL_C_KEY_CACHE_SIZE; i++) {
+		makeKey(keys[i], 200 + i);
+	}
+	mbedtls_des3_context enc;
+	mbedtls_des3_context dec;
+	mbedtls_des3_init(&enc);
+	mbedtls_des3_init(&dec);
+	uint32_t sink = 0;
+
+	// Before the cache every auth derived the schedules for each of its three cipher operations
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		key[0] = i;
+		mbedtls_des3_set2key_dec(&dec, key);
+		mbedtls_des3_set2key_enc(&enc, key);
+		mbedtls_des3_set2key_dec(&dec, key);
+		sink += enc.sk[i % 96] + dec.sk[i % 96];
+	}
+	double uncached = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+	// Cycling through more keys than the cache holds misses every time
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		sink += mfrc522.schedule(keys[i % (MFRC522_UL_C_KEY_CACHE_SIZE + 1)])->dec.sk[i % 96];
+	}
+	double miss = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		sink += mfrc522.schedule(key)->dec.sk[i % 96];
+	}
+	double hit = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+	char message[256];
+	snprintf(message, sizeof(message), "key setup per auth: uncached %.0f ns, cache miss %.0f ns, cache hit %.0f ns on the host "
+		"(checksum %u)", uncached, miss, hit, sink & 1);
+	TEST_MESSAGE(message);
+	TEST_ASSERT_LESS_THAN(uncached, hit);
+	mbedtls_des3_free(&enc);
+	mbedtls_des3_free(&dec);
+}
+
+int main(int argc, char **argv) {
+	Serial.output = nullptr;
+	UNITY_BEGIN();
+	RUN_TEST(test_schedules_match_mbedtls);
+	RUN_TEST(test_known_answer);
+	RUN_TEST(test_least_recently_used_is_replaced);
+	RUN_TEST(test_auth_with_cached_key);
+	RUN_TEST(test_schedule_cost);
+	return UNITY_END();
+}
@@ -0,0 +1,174 @@
+/*
+ * PICC_Enumerate(): one to three PICCs in the field, a halted PICC next to a new one, and the time a single card tap
+ * spends in it, also with a long PCD_SetTimeout(). Plus the SPI traffic of a REQA nobody answers.
+ * Run with: pio test -e native-mfrc522 -f test_mfrc522_enumerate
+ */
+
+#include <unity.h>
+#include <MFRC522.h>
+#include "MFRC522Emulator.h"
+#include "VirtualPicc.h"
+
+static const byte CS_PIN = 10;
+
+static MFRC522Emulator emulator(CS_PIN);
+static MFRC522 mfrc522(CS_PIN, MFRC522::UNUSED_PIN);
+
+static const byte ulcUid[7] = { 0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x80 };
+static const byte ntagUid[7] = { 0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0x81 };
+static const byte classicUid[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+static VirtualUltralightC ulc(ulcUid);
+static VirtualNtag216 ntag(ntagUid);
+static VirtualClassic1K classic(classicUid);
+
+static bool found(const MFRC522::Uid *uids, byte count, const VirtualPicc &picc) {
+	for (byte i = 0; i < count; i++) {
+		if (uids[i].size == picc.uidSize() && memcmp(uids[i].uidByte, picc.uid(), picc.uidSize()) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Like CardReader: PICC_IsNewCardPresent() leaves the PICCs in state READY before the enumeration
+static MFRC522::StatusCode tap(MFRC522::Uid *uids, byte *count, bool *active = nullptr) {
+	mfrc522.PICC_IsNewCardPresent();
+	return mfrc522.PICC_Enumerate(uids, count, active);
+}
+
+void setUp(void) {
+	mfrc522.PCD_Init();
+}
+
+void tearDown(void) {
+	emulator.removePicc(&ulc);
+	emulator.removePicc(&ntag);
+	emulator.removePicc(&classic);
+	mfrc522.PCD_SetTimeout(25);
+}
+
+void test_no_picc(void) {
+	MFRC522::Uid uids[4];
+	byte count = 4;
+	TEST_ASSERT_EQUAL(MFRC522::STATUS_TIMEOUT, tap(uids, &count));
+	TEST_ASSERT_EQUAL_UINT8(0, count);
+}
+
+void test_single_picc(void) {
+	MFRC522::Uid uids[4];
+	byte count = 4;
+	emulator.addPicc(&ulc);
+	TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, tap(uids, &count));
+	TEST_ASSERT_EQUAL_UINT8(1, count);
+	TEST_ASSERT_TRUE(found(uids, count, ulc));
+	TEST_ASSERT_EQUAL(VirtualPicc::HALT, ulc.state());
+
+	// Left in state ACTIVE it answers right away
+	bool active = false;
+	byte buffer[16];
+	count = 4;
+	TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, tap(uids, &count, &active));
+	TEST_ASSERT_EQUAL_UINT8(1, count);
+	TEST_ASSERT_TRUE(active);
+	TEST_ASSERT_EQUAL(VirtualPicc::ACTIVE, ulc.state());
+	TEST_ASSERT_EQUAL_MEMORY(ulcUid, mfrc522.uid.uidByte, sizeof(ulcUid));
+	TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, mfrc522.MIFARE_Ultralight_ReadPages(0x00, 4, buffer, sizeof(buffer)));
+	TEST_ASSERT_EQUAL_MEMORY(ulcUid, buffer, 3);
+}
+
+void test_several_piccs(void) {
+	MFRC522::Uid uids[4];
+	byte count = 4;
+	bool active = true;
+	emulator.addPicc(&ulc);
+	emulator.addPicc(&ntag);
+	emulator.addPicc(&classic);
+	TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, tap(uids, &count, &active));
+	TEST_ASSERT_EQUAL_UINT8(3, count);
+	TEST_ASSERT_FALSE(active);
+	TEST_ASSERT_TRUE(found(uids, count, ulc));
+	TEST_ASSERT_TRUE(found(uids, count, ntag));
+	TEST_ASSERT_TRUE(found(uids, count, classic));
+
+	count = 2;
+	TEST_ASSERT_EQUAL(MFRC522::STATUS_NO_ROOM, tap(uids, &count));
+	TEST_ASSERT_EQUAL_UINT8(2, count);
+}
+
+void test_halted_picc_next_to_new_one(void) {
+	MFRC522::Uid uids[4];
+	byte count = 4;
+	emulator.addPicc(&ulc);
+	TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, tap(uids, &count));
+	TEST_ASSERT_EQUAL(VirtualPicc::HALT, ulc.state());
+
+	// Only the new PICC answers the REQA of PICC_IsNewCardPresent()
+	emulator.addPicc(&ntag);
+	count = 4;
+	TEST_ASSERT_EQUAL(MFRC522::STATUS_OK, tap(uids, &count));
+	TEST_ASSERT_EQUAL_UINT8(2, count);
+	TEST_ASSERT_TRUE(found(uids, count, ulc));
+	TEST_ASSERT_TRUE(found(uids, count, ntag));
+}
+
+void test_enumerate_time(void) {
+	char message[256];
+	for (uint16_t timeoutMs : { 25, 100 }) {
+		MFRC522::Uid uids[4];
+		byte count;
+		bool active;
+		mfrc522.PCD_SetTimeout(timeoutMs);
+
+		count = 4;
+		mfrc522.PICC_IsNewCardPresent();
+		MFRC522Emulator::Stats none = emulator.measure([&]() { mfrc522.PICC_Enumerate(uids, &count); });
+		emulator.addPicc(&ulc);
+		count = 4;
+		mfrc522.PICC_IsNewCardPresent();
+		MFRC522Emulator::Stats single = emulator.measure([&]() { mfrc522.PICC_Enumerate(uids, &count, &active); });
+		TEST_ASSERT_EQUAL_UINT8(1, count);
+		emulator.addPicc(&ntag);
+		count = 4;
+		mfrc522.PICC_IsNewCardPresent();
+		MFRC522Emulator::Stats two = emulator.measure([&]() { mfrc522.PICC_Enumerate(uids, &count, &active); });
+		TEST_ASSERT_EQUAL_UINT8(2, count);
+		emulator.removePicc(&ulc);
+		emulator.removePicc(&ntag);
+
+		snprintf(message, sizeof(message), "timeout %u ms: no PICC %.1f ms, one PICC %.1f ms (%u SPI transactions), "
+			"two PICCs %.1f ms", timeoutMs, none.elapsedNs / 1e6, single.elapsedNs / 1e6, single.transactions,
+			two.elapsedNs / 1e6);
+		TEST_MESSAGE(message);
+		// No power cycle and no HLTA waiting for the full timeout
+		TEST_ASSERT_LESS_THAN(10e6, single.elapsedNs);
+		TEST_ASSERT_LESS_THAN(5e6, none.elapsedNs);
+	}
+}
+
+void test_unanswered_request_sleeps(void) {
+	byte atqa[2];
+	byte atqaSize = sizeof(atqa);
+	mfrc522.PCD_SetTimeout(100);
+	MFRC522Emulator::Stats idle = emulator.measure([&]() {
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_TIMEOUT, mfrc522.PICC_RequestA(atqa, &atqaSize));
+	});
+
+	char message[256];
+	snprintf(message, sizeof(message), "unanswered REQA, timeout 100 ms: %u SPI transactions in %.1f ms", idle.transactions,
+		idle.elapsedNs / 1e6);
+	TEST_MESSAGE(message);
+	// Back to back polls for MFRC522_POLL_SPIN_US, then one per ms
+	TEST_ASSERT_LESS_THAN(1000, idle.transactions);
+}
+
+int main(int argc, char **argv) {
+	Serial.output = nullptr;
+	UNITY_BEGIN();
+	RUN_TEST(test_no_picc);
+	RUN_TEST(test_single_picc);
+	RUN_TEST(test_several_piccs);
+	RUN_TEST(test_halted_picc_next_to_new_one);
+	RUN_TEST(test_enumerate_time);
+	RUN_TEST(test_unanswered_request_sleeps);
+	return UNITY_END();
+}
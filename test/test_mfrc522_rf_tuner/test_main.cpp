@@ -0,0 +1,81 @@
+/*
+ * RfTuner against the emulator: taps of an Ultralight C with a key the reader does not know fail with STATUS_ERROR
+ * from the protocol, not from the RF link, and must not move gain or ModWidth.
+ * Run with: pio test -e native-mfrc522 -f test_mfrc522_rf_tuner
+ */
+
+#include <unity.h>
+#include <MFRC522.h>
+#include "MFRC522Emulator.h"
+#include "VirtualPicc.h"
+#include "rf_tuner.h"
+
+static const byte CS_PIN = 10;
+
+static MFRC522Emulator emulator(CS_PIN);
+static MFRC522 mfrc522(CS_PIN, MFRC522::UNUSED_PIN);
+
+static const byte ulcUid[7] = { 0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x80 };
+static VirtualUltralightC ulc(ulcUid);
+
+// Like CardReader::recordAttempt()
+static void record(RfTuner &tuner, MFRC522::StatusCode status) {
+	byte errorReg = status == MFRC522::STATUS_ERROR ? mfrc522.PCD_ReadRegister(MFRC522::ErrorReg) : 0;
+	tuner.record(status, errorReg);
+}
+
+void setUp(void) {
+	mfrc522.PCD_Init();
+}
+
+void tearDown(void) {
+	emulator.removePicc(&ulc);
+}
+
+void test_wrong_key_taps_are_no_rf_failures(void) {
+	byte wrongKey[16] = { 0 };
+	RfTuner tuner;
+	emulator.addPicc(&ulc);
+	for (int tap = 0; tap < 8 * RF_TUNER_WINDOW; tap++) {
+		byte atqa[2];
+		byte atqaSize = sizeof(atqa);
+		record(tuner, mfrc522.PICC_WakeupA(atqa, &atqaSize));
+		record(tuner, mfrc522.PICC_Select(&mfrc522.uid));
+		MFRC522::StatusCode status = mfrc522.MIFARE_UL_C_Auth(wrongKey);
+		TEST_ASSERT_EQUAL(MFRC522::STATUS_ERROR, status);
+		record(tuner, status);
+		mfrc522.PICC_HaltA();
+	}
+
+	const RfTuner::Stats &stats = tuner.stats();
+	char message[256];
+	snprintf(message, sizeof(message), "wrong key taps: ok=%u crc=%u other=%u steps=%u",
+		stats.outcomes[RfTuner::OUTCOME_OK], stats.outcomes[RfTuner::OUTCOME_CRC],
+		stats.outcomes[RfTuner::OUTCOME_OTHER], stats.steps);
+	TEST_MESSAGE(message);
+	TEST_ASSERT_EQUAL_UINT32(8 * RF_TUNER_WINDOW, stats.outcomes[RfTuner::OUTCOME_OTHER]);
+	TEST_ASSERT_EQUAL_UINT32(0, stats.outcomes[RfTuner::OUTCOME_CRC]);
+	TEST_ASSERT_EQUAL_UINT32(0, stats.steps);
+}
+
+void test_frame_errors_are_rf_failures(void) {
+	TEST_ASSERT_EQUAL(RfTuner::OUTCOME_CRC, RfTuner::outcomeOf(MFRC522::STATUS_CRC_WRONG));
+	TEST_ASSERT_EQUAL(RfTuner::OUTCOME_CRC, RfTuner::outcomeOf(MFRC522::STATUS_ERROR, 0x02));	// ParityErr
+	TEST_ASSERT_EQUAL(RfTuner::OUTCOME_CRC, RfTuner::outcomeOf(MFRC522::STATUS_ERROR, 0x01));	// ProtocolErr
+	TEST_ASSERT_EQUAL(RfTuner::OUTCOME_OTHER, RfTuner::outcomeOf(MFRC522::STATUS_ERROR, 0x00));
+
+	// A window of parity errors still tunes
+	RfTuner tuner;
+	for (int i = 0; i < RF_TUNER_WINDOW; i++) {
+		tuner.record(MFRC522::STATUS_ERROR, 0x02);
+	}
+	TEST_ASSERT_EQUAL_UINT32(1, tuner.stats().steps);
+}
+
+int main(int argc, char **argv) {
+	Serial.output = nullptr;
+	UNITY_BEGIN();
+	RUN_TEST(test_wrong_key_taps_are_no_rf_failures);
+	RUN_TEST(test_frame_errors_are_rf_failures);
+	return UNITY_END();
+}
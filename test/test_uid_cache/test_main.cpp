@@ -0,0 +1,94 @@
+/*
+ * UidCache: a commit that fails halfway is not loaded after a reset, and the in-place rehash of put() keeps every
+ * entry reachable while it drops the tombstones of removed cards. Run with: pio test -e native -f test_uid_cache
+ */
+
+#include <unity.h>
+#include <array>
+#include <random>
+#include <vector>
+#include <Preferences.h>
+#include "uid_cache.h"
+
+typedef std::array<byte, 7> TestUid;
+
+static std::vector<TestUid> makeUids(size_t count, uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::vector<TestUid> uids(count);
+    for (TestUid &uid : uids) {
+        for (byte &b : uid) b = generator();
+    }
+    return uids;
+}
+
+// Every test starts without a stored table
+void setUp(void) {
+    hostPreferences.clear();
+    hostPreferencesWrites = 0;
+    hostPreferencesFailAfter = -1;
+    uidCache.begin();
+    uidCache.clear();
+}
+
+void tearDown(void) {
+    hostPreferencesFailAfter = -1;
+}
+
+void test_failed_commit_is_not_loaded(void) {
+    std::vector<TestUid> first = makeUids(300, 1);
+    std::vector<TestUid> delta = makeUids(300, 2);
+    for (size_t i = 0; i < first.size(); i++) uidCache.put(first[i].data(), first[i].size(), i, 0);
+    TEST_ASSERT_TRUE(uidCache.commit(1, true));
+
+    // The delta changes every chunk, the flash fills up after some of them
+    for (size_t i = 0; i < delta.size(); i++) uidCache.put(delta[i].data(), delta[i].size(), i, 0);
+    hostPreferencesFailAfter = hostPreferencesWrites + 4;
+    TEST_ASSERT_FALSE(uidCache.commit(2, true));
+    TEST_ASSERT_EQUAL_UINT32(1, uidCache.version());
+
+    hostPreferencesFailAfter = -1;
+    UidCache reloaded;
+    reloaded.begin();
+    TEST_ASSERT_EQUAL_UINT32(0, reloaded.version());
+    TEST_ASSERT_EQUAL_UINT16(0, reloaded.entries());
+
+    // The retry writes every chunk again
+    TEST_ASSERT_TRUE(uidCache.commit(2, true));
+    UidCache retried;
+    retried.begin();
+    TEST_ASSERT_EQUAL_UINT32(2, retried.version());
+    TEST_ASSERT_EQUAL_UINT16(600, retried.entries());
+    UidCache::Entry entry;
+    for (TestUid &uid : delta) TEST_ASSERT_EQUAL(UidCache::Lookup::FOUND, retried.find(uid.data(), uid.size(), entry));
+}
+
+void test_rehash_keeps_entries(void) {
+    // Rounds of removes and puts fill the table with tombstones until put() rehashes
+    std::vector<TestUid> uids = makeUids(6000, 3);
+    const size_t live = 600;
+    for (size_t i = 0; i < live; i++) TEST_ASSERT_TRUE(uidCache.put(uids[i].data(), uids[i].size(), i, 0));
+    for (size_t i = live; i < uids.size(); i++) {
+        uidCache.remove(uids[i - live].data(), uids[i - live].size());
+        TEST_ASSERT_TRUE(uidCache.put(uids[i].data(), uids[i].size(), i, 0));
+    }
+    TEST_ASSERT_TRUE(uidCache.commit(1, true));
+    TEST_ASSERT_EQUAL_UINT16(live, uidCache.entries());
+
+    UidCache::Entry entry;
+    for (size_t i = 0; i < uids.size(); i++) {
+        UidCache::Lookup lookup = uidCache.find(uids[i].data(), uids[i].size(), entry);
+        if (i < uids.size() - live) {
+            TEST_ASSERT_EQUAL(UidCache::Lookup::UNKNOWN, lookup);
+        } else {
+            TEST_ASSERT_EQUAL(UidCache::Lookup::FOUND, lookup);
+            TEST_ASSERT_EQUAL_UINT32(i, entry.token);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_failed_commit_is_not_loaded);
+    RUN_TEST(test_rehash_keeps_entries);
+    return UNITY_END();
+}